@@ -0,0 +1,113 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "backtrace.h"
+#include "zc_defs.h"
+
+void zlog_backtrace_profile(zlog_backtrace_t * a_bt, int flag)
+{
+	zc_assert(a_bt,);
+	zc_profile(flag, "--backtrace[%p][%ld/%ld][next:%ld]--",
+		a_bt,
+		(long)a_bt->len,
+		(long)a_bt->count,
+		(long)a_bt->next);
+	return;
+}
+
+/*******************************************************************************/
+void zlog_backtrace_del(zlog_backtrace_t * a_bt)
+{
+	size_t i;
+
+	zc_assert(a_bt,);
+	for (i = 0; i < a_bt->count; i++) {
+		free(a_bt->slots[i].str);
+	}
+	pthread_mutex_destroy(&(a_bt->lock_mutex));
+	zc_debug("zlog_backtrace_del[%p]", a_bt);
+	free(a_bt);
+	return;
+}
+
+zlog_backtrace_t *zlog_backtrace_new(size_t count)
+{
+	zlog_backtrace_t *a_bt;
+
+	zc_assert(count > 0, NULL);
+
+	a_bt = calloc(1, sizeof(zlog_backtrace_t) + count * sizeof(zlog_backtrace_slot_t));
+	if (!a_bt) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	a_bt->count = count;
+
+	if (pthread_mutex_init(&(a_bt->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_bt);
+		return NULL;
+	}
+
+	zlog_backtrace_profile(a_bt, ZC_DEBUG);
+	return a_bt;
+}
+
+/*******************************************************************************/
+int zlog_backtrace_keep(zlog_backtrace_t * a_bt, const char *str, size_t len)
+{
+	char *p;
+	zlog_backtrace_slot_t *a_slot;
+
+	pthread_mutex_lock(&(a_bt->lock_mutex));
+	a_slot = &(a_bt->slots[a_bt->next]);
+
+	/* a slot keeps its memory, so it is allocated only while records grow */
+	if (len > a_slot->size) {
+		p = realloc(a_slot->str, len);
+		if (!p) {
+			pthread_mutex_unlock(&(a_bt->lock_mutex));
+			zc_error("realloc fail, errno[%d]", errno);
+			return -1;
+		}
+		a_slot->str = p;
+		a_slot->size = len;
+	}
+	memcpy(a_slot->str, str, len);
+	a_slot->len = len;
+
+	a_bt->next = (a_bt->next + 1) % a_bt->count;
+	if (a_bt->len < a_bt->count) a_bt->len++;
+	pthread_mutex_unlock(&(a_bt->lock_mutex));
+	return 0;
+}
+
+int zlog_backtrace_flush(zlog_backtrace_t * a_bt, zlog_backtrace_fn fn, void *arg)
+{
+	int rc = 0;
+	size_t i;
+	zlog_backtrace_slot_t *a_slot;
+
+	pthread_mutex_lock(&(a_bt->lock_mutex));
+	for (i = a_bt->count - a_bt->len; i < a_bt->count; i++) {
+		a_slot = &(a_bt->slots[(a_bt->next + i) % a_bt->count]);
+		if (fn(a_slot->str, a_slot->len, arg)) {
+			rc = -1;
+			break;
+		}
+	}
+	a_bt->len = 0;
+	pthread_mutex_unlock(&(a_bt->lock_mutex));
+	return rc;
+}
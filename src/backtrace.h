@@ -0,0 +1,45 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_backtrace_h
+#define __zlog_backtrace_h
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* the last records of a rule below its trigger level, formatted,
+ * kept in memory only, and written ahead of a record at the trigger level
+ */
+typedef struct zlog_backtrace_slot_s {
+	char *str;
+	size_t len;
+	size_t size;
+} zlog_backtrace_slot_t;
+
+typedef struct zlog_backtrace_s {
+	pthread_mutex_t lock_mutex;
+	size_t count;			/* of slots */
+	size_t next;			/* slot to fill */
+	size_t len;			/* slots kept */
+	zlog_backtrace_slot_t slots[];
+} zlog_backtrace_t;
+
+/* for the callback of zlog_backtrace_flush, return 0 to go on */
+typedef int (*zlog_backtrace_fn) (const char *str, size_t len, void *arg);
+
+/* records come from msg_buf, so each is no larger than buffer max */
+zlog_backtrace_t *zlog_backtrace_new(size_t count);
+void zlog_backtrace_del(zlog_backtrace_t * a_bt);
+void zlog_backtrace_profile(zlog_backtrace_t * a_bt, int flag);
+
+/* keep a copy of str, the oldest one is dropped when all slots are kept */
+int zlog_backtrace_keep(zlog_backtrace_t * a_bt, const char *str, size_t len);
+/* pass each kept record to fn, oldest first, then forget them all */
+int zlog_backtrace_flush(zlog_backtrace_t * a_bt, zlog_backtrace_fn fn, void *arg);
+
+#endif
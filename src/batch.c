@@ -0,0 +1,302 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "batch.h"
+#include "zc_defs.h"
+
+#define ZLOG_BATCH_NO_PATH	((size_t)-1)
+
+void zlog_batch_profile(zlog_batch_t * a_batch, int flag)
+{
+	zc_assert(a_batch,);
+	zc_profile(flag, "--batch[%p][%p][%lu][%ld][batches:%lu][failed:%lu]--",
+		a_batch,
+		a_batch->output,
+		(unsigned long)a_batch->batch_size,
+		a_batch->latency,
+		a_batch->nbatches,
+		a_batch->nfailed);
+	return;
+}
+
+/*******************************************************************************/
+static void zlog_batch_after(struct timespec *ts, long ms)
+{
+	clock_gettime(CLOCK_REALTIME, ts);
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+static int zlog_batch_slab_init(zlog_batch_slab_t * a_slab, size_t batch_size)
+{
+	a_slab->offs = calloc(batch_size * 2, sizeof(size_t));
+	a_slab->msgs = calloc(batch_size, sizeof(zlog_msg_t));
+	if (!a_slab->offs || !a_slab->msgs) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return -1;
+	}
+	return 0;
+}
+
+static void zlog_batch_slab_fini(zlog_batch_slab_t * a_slab)
+{
+	free(a_slab->data);
+	free(a_slab->offs);
+	free(a_slab->msgs);
+}
+
+static int zlog_batch_slab_put(zlog_batch_slab_t * a_slab, zlog_msg_t * msg)
+{
+	size_t need;
+	size_t path_len;
+	size_t size;
+	char *data;
+
+	path_len = msg->path ? strlen(msg->path) + 1 : 0;
+	need = msg->len + 1 + path_len;
+	if (a_slab->len + need > a_slab->size) {
+		size = a_slab->size ? a_slab->size : 4096;
+		while (size < a_slab->len + need) size *= 2;
+		data = realloc(a_slab->data, size);
+		if (!data) {
+			zc_error("realloc fail, errno[%d]", errno);
+			return -1;
+		}
+		a_slab->data = data;
+		a_slab->size = size;
+	}
+
+	a_slab->offs[a_slab->count * 2] = a_slab->len;
+	memcpy(a_slab->data + a_slab->len, msg->buf, msg->len);
+	a_slab->data[a_slab->len + msg->len] = '\0';
+	a_slab->len += msg->len + 1;
+
+	if (msg->path) {
+		a_slab->offs[a_slab->count * 2 + 1] = a_slab->len;
+		memcpy(a_slab->data + a_slab->len, msg->path, path_len);
+		a_slab->len += path_len;
+	} else {
+		a_slab->offs[a_slab->count * 2 + 1] = ZLOG_BATCH_NO_PATH;
+	}
+	a_slab->msgs[a_slab->count].len = msg->len;
+	a_slab->count++;
+	return 0;
+}
+
+/* data is not moved any more, point msgs into it */
+static void zlog_batch_slab_seal(zlog_batch_slab_t * a_slab)
+{
+	size_t i;
+
+	for (i = 0; i < a_slab->count; i++) {
+		a_slab->msgs[i].buf = a_slab->data + a_slab->offs[i * 2];
+		a_slab->msgs[i].path = (a_slab->offs[i * 2 + 1] == ZLOG_BATCH_NO_PATH)
+			? NULL : a_slab->data + a_slab->offs[i * 2 + 1];
+	}
+}
+
+/*******************************************************************************/
+static void *zlog_batch_loop(void *arg)
+{
+	int rc;
+	zlog_batch_t *a_batch = arg;
+	zlog_batch_slab_t *a_slab;
+
+	pthread_mutex_lock(&(a_batch->lock_mutex));
+	for (;;) {
+		a_slab = &(a_batch->slabs[a_batch->fill]);
+		if (a_slab->count == 0) {
+			if (a_batch->stopping) break;
+			pthread_cond_wait(&(a_batch->cond), &(a_batch->lock_mutex));
+			continue;
+		}
+		if (a_slab->count < a_batch->batch_size && !a_batch->stopping) {
+			rc = pthread_cond_timedwait(&(a_batch->cond),
+				&(a_batch->lock_mutex), &(a_batch->due_at));
+			if (rc != ETIMEDOUT) continue;
+		}
+
+		/* writers go on in the other slab meanwhile */
+		a_batch->fill ^= 1;
+		pthread_cond_broadcast(&(a_batch->room));
+		pthread_mutex_unlock(&(a_batch->lock_mutex));
+
+		zlog_batch_slab_seal(a_slab);
+		rc = a_batch->output(a_slab->msgs, a_slab->count);
+
+		pthread_mutex_lock(&(a_batch->lock_mutex));
+		a_batch->nbatches++;
+		if (rc) {
+			zc_error("batch record fail, [%lu] records lost", (unsigned long)a_slab->count);
+			a_batch->nfailed++;
+		}
+		a_slab->count = 0;
+		a_slab->len = 0;
+		pthread_cond_broadcast(&(a_batch->room));
+	}
+	pthread_mutex_unlock(&(a_batch->lock_mutex));
+	return NULL;
+}
+
+static int zlog_batch_start(zlog_batch_t * a_batch)
+{
+	int rc;
+
+	rc = pthread_create(&(a_batch->tid), NULL, zlog_batch_loop, a_batch);
+	if (rc) {
+		zc_error("pthread_create fail, rc[%d]", rc);
+		return -1;
+	}
+	a_batch->started = 1;
+	return 0;
+}
+
+/* the records of the parent are given by the parent, start over empty */
+static int zlog_batch_atfork_reset(void *arg)
+{
+	zlog_batch_t *a_batch = arg;
+
+	if (pthread_mutex_init(&(a_batch->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		return -1;
+	}
+	if (pthread_cond_init(&(a_batch->cond), NULL)
+		|| pthread_cond_init(&(a_batch->room), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		return -1;
+	}
+	a_batch->slabs[0].count = a_batch->slabs[0].len = 0;
+	a_batch->slabs[1].count = a_batch->slabs[1].len = 0;
+	a_batch->fill = 0;
+	a_batch->started = 0;
+	a_batch->stopping = 0;
+	return zlog_batch_start(a_batch);
+}
+
+int zlog_batch_write(zlog_batch_t * a_batch, zlog_msg_t * msg)
+{
+	int rc;
+	zlog_batch_slab_t *a_slab;
+
+	if (zc_forked(a_batch->forks)
+		&& zc_fork_reset(&(a_batch->forks), zlog_batch_atfork_reset, a_batch)) {
+		zc_error("zlog_batch_atfork_reset fail");
+		return -1;
+	}
+
+	pthread_mutex_lock(&(a_batch->lock_mutex));
+	while (a_batch->slabs[a_batch->fill].count >= a_batch->batch_size) {
+		pthread_cond_wait(&(a_batch->room), &(a_batch->lock_mutex));
+	}
+	a_slab = &(a_batch->slabs[a_batch->fill]);
+	rc = zlog_batch_slab_put(a_slab, msg);
+	if (rc == 0) {
+		if (a_slab->count == 1) {
+			zlog_batch_after(&(a_batch->due_at), a_batch->latency);
+			pthread_cond_signal(&(a_batch->cond));
+		} else if (a_slab->count == a_batch->batch_size) {
+			pthread_cond_signal(&(a_batch->cond));
+		}
+	}
+	pthread_mutex_unlock(&(a_batch->lock_mutex));
+	return rc;
+}
+
+/*******************************************************************************/
+void zlog_batch_del(zlog_batch_t * a_batch)
+{
+	zc_assert(a_batch,);
+
+	if (a_batch->started && !zc_forked(a_batch->forks)) {
+		pthread_mutex_lock(&(a_batch->lock_mutex));
+		a_batch->stopping = 1;
+		pthread_cond_signal(&(a_batch->cond));
+		pthread_mutex_unlock(&(a_batch->lock_mutex));
+		pthread_join(a_batch->tid, NULL);
+	}
+
+	pthread_cond_destroy(&(a_batch->room));
+	pthread_cond_destroy(&(a_batch->cond));
+	pthread_mutex_destroy(&(a_batch->lock_mutex));
+	zlog_batch_slab_fini(&(a_batch->slabs[0]));
+	zlog_batch_slab_fini(&(a_batch->slabs[1]));
+	zc_debug("zlog_batch_del[%p]", a_batch);
+	free(a_batch);
+	return;
+}
+
+zlog_batch_t *zlog_batch_new(zlog_record_batch_fn output, size_t batch_size, long latency)
+{
+	zlog_batch_t *a_batch;
+
+	zc_assert(output, NULL);
+
+	if (batch_size == 0 || latency < 0) {
+		zc_error("batch size[%lu] should be above 0, latency[%ld] not below 0",
+			(unsigned long)batch_size, latency);
+		return NULL;
+	}
+
+	a_batch = calloc(1, sizeof(zlog_batch_t));
+	if (!a_batch) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	a_batch->output = output;
+	a_batch->batch_size = batch_size;
+	a_batch->latency = latency;
+	zc_fork_watch();
+	a_batch->forks = zc_forks;
+
+	if (pthread_mutex_init(&(a_batch->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_batch);
+		return NULL;
+	}
+	if (pthread_cond_init(&(a_batch->cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		pthread_mutex_destroy(&(a_batch->lock_mutex));
+		free(a_batch);
+		return NULL;
+	}
+	if (pthread_cond_init(&(a_batch->room), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		pthread_cond_destroy(&(a_batch->cond));
+		pthread_mutex_destroy(&(a_batch->lock_mutex));
+		free(a_batch);
+		return NULL;
+	}
+
+	if (zlog_batch_slab_init(&(a_batch->slabs[0]), batch_size)
+		|| zlog_batch_slab_init(&(a_batch->slabs[1]), batch_size)) {
+		zc_error("zlog_batch_slab_init fail");
+		goto err;
+	}
+
+	if (zlog_batch_start(a_batch)) {
+		zc_error("zlog_batch_start fail");
+		goto err;
+	}
+
+	zlog_batch_profile(a_batch, ZC_DEBUG);
+	return a_batch;
+err:
+	zlog_batch_del(a_batch);
+	return NULL;
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_batch_h
+#define __zlog_batch_h
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "record.h"
+
+/* records of a batch, copied one after another in data, so the buffers
+ * are reused batch after batch
+ */
+typedef struct zlog_batch_slab_s {
+	char *data;
+	size_t len;
+	size_t size;
+	size_t *offs;			/* of buf and path of each msg in data */
+	zlog_msg_t *msgs;
+	size_t count;
+} zlog_batch_slab_t;
+
+/* writers fill one slab while a thread gives the other to the callback
+ * a slab goes when it has batch_size records, or latency after its
+ * first one came, writers wait when both slabs are taken
+ */
+typedef struct zlog_batch_s {
+	zlog_record_batch_fn output;
+	size_t batch_size;
+	long latency;			/* ms */
+
+	pthread_mutex_t lock_mutex;
+	pthread_cond_t cond;		/* the thread waits here */
+	pthread_cond_t room;		/* writers wait here */
+	pthread_t tid;
+	unsigned long forks;		/* of zc_forks, the thread runs in this process only */
+	int started;
+	int stopping;
+
+	zlog_batch_slab_t slabs[2];
+	int fill;			/* slab writers fill */
+	struct timespec due_at;		/* the filled slab goes then */
+
+	unsigned long nbatches;
+	unsigned long nfailed;
+} zlog_batch_t;
+
+zlog_batch_t *zlog_batch_new(zlog_record_batch_fn output, size_t batch_size, long latency);
+/* all records go to the callback before it returns */
+void zlog_batch_del(zlog_batch_t * a_batch);
+void zlog_batch_profile(zlog_batch_t * a_batch, int flag);
+
+/* msg is copied, a forked child starts over with a thread of its own */
+int zlog_batch_write(zlog_batch_t * a_batch, zlog_msg_t * msg);
+
+#endif
@@ -11,6 +11,10 @@
 #include <pthread.h>
 #include <errno.h>
 #include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#endif
 
 #include "zc_defs.h"
 #include "buf.h"
@@ -634,4 +638,92 @@ int zlog_buf_adjust_append(zlog_buf_t * a_buf, const char *str, size_t str_len,
 	return 0;
 }
 /*******************************************************************************/
+/* bytes from str which go into a json string as they are, that is all but
+ * '"', '\\' and control chars, utf-8 goes as it is
+ * 16 bytes are looked at once by sse2, else 8 by a word, most records are
+ * all clean and are copied by one append then
+ */
+#define ZLOG_JSON_ONES	((uint64_t)0x0101010101010101ULL)
+#define ZLOG_JSON_HIGHS	((uint64_t)0x8080808080808080ULL)
+#define zlog_json_has_zero(v)	(((v) - ZLOG_JSON_ONES) & ~(v) & ZLOG_JSON_HIGHS)
+
+static size_t zlog_buf_json_clean_len(const char *str, size_t len)
+{
+	size_t i = 0;
+	uint64_t v;
+	unsigned char c;
+
+#if defined(__SSE2__) && defined(__GNUC__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i ctrl = _mm_set1_epi8(0x1F);
+	__m128i x;
+	int mask;
+
+	for (; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(str + i));
+		mask = _mm_movemask_epi8(_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(x, ctrl), ctrl)));
+		if (mask) return i + __builtin_ctz(mask);
+	}
+#endif
 
+	for (; i + 8 <= len; i += 8) {
+		memcpy(&v, str + i, 8);
+		/* a byte below 0x20, or equal to '"' or '\\' */
+		if ((((v - ZLOG_JSON_ONES * 0x20) & ~v) & ZLOG_JSON_HIGHS)
+			|| zlog_json_has_zero(v ^ (ZLOG_JSON_ONES * '"'))
+			|| zlog_json_has_zero(v ^ (ZLOG_JSON_ONES * '\\'))) {
+			break;
+		}
+	}
+
+	for (; i < len; i++) {
+		c = (unsigned char)str[i];
+		if (c < 0x20 || c == '"' || c == '\\') break;
+	}
+	return i;
+}
+
+int zlog_buf_append_json(zlog_buf_t * a_buf, const char *str, size_t str_len)
+{
+	int rc;
+	size_t n;
+	unsigned char c;
+	char esc[6 + 1];
+	static const char hex[] = "0123456789abcdef";
+
+	while (str_len) {
+		n = zlog_buf_json_clean_len(str, str_len);
+		if (n) {
+			rc = zlog_buf_append(a_buf, str, n);
+			if (rc) return rc;
+			str += n;
+			str_len -= n;
+			if (!str_len) break;
+		}
+
+		c = (unsigned char)*str;
+		esc[0] = '\\';
+		switch (c) {
+		case '"': esc[1] = '"'; n = 2; break;
+		case '\\': esc[1] = '\\'; n = 2; break;
+		case '\n': esc[1] = 'n'; n = 2; break;
+		case '\r': esc[1] = 'r'; n = 2; break;
+		case '\t': esc[1] = 't'; n = 2; break;
+		case '\b': esc[1] = 'b'; n = 2; break;
+		case '\f': esc[1] = 'f'; n = 2; break;
+		default:
+			memcpy(esc + 1, "u00", 3);
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xF];
+			n = 6;
+		}
+		rc = zlog_buf_append(a_buf, esc, n);
+		if (rc) return rc;
+		str++;
+		str_len--;
+	}
+	return 0;
+}
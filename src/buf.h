@@ -44,6 +44,8 @@ int zlog_buf_adjust_append(zlog_buf_t * a_buf, const char *str, size_t str_len,
 int zlog_buf_printf_dec32(zlog_buf_t * a_buf, uint32_t ui32, int width);
 int zlog_buf_printf_dec64(zlog_buf_t * a_buf, uint64_t ui64, int width);
 int zlog_buf_printf_hex(zlog_buf_t * a_buf, uint32_t ui32, int width);
+/* str escaped as the inside of a json string, quotes are not added */
+int zlog_buf_append_json(zlog_buf_t * a_buf, const char *str, size_t str_len);
 
 #define zlog_buf_restart(a_buf) do { \
 	a_buf->tail = a_buf->start; \
@@ -20,10 +20,11 @@ void zlog_category_profile(zlog_category_t *a_category, int flag)
 	zlog_rule_t *a_rule;
 
 	zc_assert(a_category,);
-	zc_profile(flag, "--category[%p][%s][%p]--",
+	zc_profile(flag, "--category[%p][%s][%p][level:%d]--",
 			a_category,
 			a_category->name,
-			a_category->fit_rules);
+			a_category->fit_rules,
+			a_category->level);
 	if (a_category->fit_rules) {
 		zc_arraylist_foreach(a_category->fit_rules, i, a_rule) {
 			zlog_rule_profile(a_rule, flag);
@@ -54,45 +55,62 @@ static void zlog_cateogry_overlap_bitmap(zlog_category_t * a_category, zlog_rule
 	}
 }
 
+/* a rule which takes the level of category instead of its own */
+#define zlog_category_lowers_rule(a_category, a_rule) \
+	((a_rule)->compare_char == '.' && (a_rule)->level == (a_category)->rules_level)
+
+/* levels the rules take with the level of category, none below it */
+static void zlog_category_level_bitmap(zlog_category_t * a_category, unsigned char *bitmap)
+{
+	int i;
+	int j;
+	int level = a_category->level;
+	unsigned char above[sizeof(a_category->level_bitmap)];
+	zlog_rule_t *a_rule;
+
+	memset(above, 0x00, sizeof(above));
+	above[level / 8] = 0xFF >> (level % 8);
+	memset(above + level / 8 + 1, 0xFF, sizeof(above) - level / 8 - 1);
+
+	memset(bitmap, 0x00, sizeof(above));
+	zc_arraylist_foreach(a_category->fit_rules, i, a_rule) {
+		for (j = 0; j < sizeof(above); j++) {
+			bitmap[j] |= zlog_category_lowers_rule(a_category, a_rule)
+				? above[j] : a_rule->level_bitmap[j];
+		}
+	}
+	for (j = 0; j < sizeof(above); j++) bitmap[j] &= above[j];
+}
+
 static int zlog_category_obtain_rules(zlog_category_t * a_category,
 	const char* name,
-	zc_arraylist_t * rules)
+	zlog_rule_trie_t * rules)
 {
 	int i;
-	int count = 0;
-	int fit = 0;
 	zlog_rule_t *a_rule;
-	zlog_rule_t *wastebin_rule = NULL;
+	zlog_rule_t *wastebin_rule = rules->wastebin;
 
 	/* before set, clean last fit rules first */
 	if (a_category->fit_rules) zc_arraylist_del(a_category->fit_rules);
 
 	memset(a_category->level_bitmap, 0x00, sizeof(a_category->level_bitmap));
 
-	a_category->fit_rules = zc_arraylist_new(NULL, zc_arraylist_len(rules));
+	a_category->fit_rules = zc_arraylist_new(NULL, ARRAY_LIST_DEFAULT_SIZE);
 	if (!(a_category->fit_rules)) {
 		zc_error("zc_arraylist_new fail");
 		return -1;
 	}
 
-	/* get match rules from all rules */
-	zc_arraylist_foreach(rules, i, a_rule) {
-		fit = zlog_rule_match_category(a_rule, (char *)name);
-		if (fit) {
-			if (zc_arraylist_add(a_category->fit_rules, a_rule)) {
-				zc_error("zc_arrylist_add fail");
-				goto err;
-			}
-			zlog_cateogry_overlap_bitmap(a_category, a_rule);
-			count++;
-		}
-
-		if (zlog_rule_is_wastebin(a_rule)) {
-			wastebin_rule = a_rule;
-		}
+	/* get match rules in one walk of name */
+	if (zlog_rule_trie_match(rules, name, a_category->fit_rules)) {
+		zc_error("zlog_rule_trie_match fail");
+		goto err;
+	}
+	zc_arraylist_foreach(a_category->fit_rules, i, a_rule) {
+		zlog_cateogry_overlap_bitmap(a_category, a_rule);
 	}
 
-	if (count == 0) {
+	if (zc_arraylist_len(a_category->fit_rules) == 0) {
 		if (wastebin_rule) {
 			zc_debug("category[%s], no match rules, use wastebin_rule", name);
 			if (zc_arraylist_add(a_category->fit_rules, wastebin_rule)) {
@@ -100,7 +118,6 @@ static int zlog_category_obtain_rules(zlog_category_t * a_category,
 				goto err;
 			}
 			zlog_cateogry_overlap_bitmap(a_category, wastebin_rule);
-			count++;
 		} else {
 			zc_debug("category[%s], no match rules & no wastebin_rule", name);
 		}
@@ -108,6 +125,18 @@ static int zlog_category_obtain_rules(zlog_category_t * a_category,
 
 	zc_arraylist_reduce_size(a_category->fit_rules);
 
+	a_category->rules_level = -1;
+	zc_arraylist_foreach(a_category->fit_rules, i, a_rule) {
+		if (a_rule->compare_char != '.') continue;
+		if (a_category->rules_level < 0 || a_rule->level < a_category->rules_level) {
+			a_category->rules_level = a_rule->level;
+		}
+	}
+
+	if (a_category->level >= 0) {
+		zlog_category_level_bitmap(a_category, a_category->level_bitmap);
+	}
+
 	return 0;
 err:
 	zc_arraylist_del(a_category->fit_rules);
@@ -115,7 +144,7 @@ err:
 	return -1;
 }
 
-zlog_category_t *zlog_category_new(const char *name, zc_arraylist_t * rules)
+zlog_category_t *zlog_category_new(const char *name, zlog_rule_trie_t * rules)
 {
 	size_t len;
 	zlog_category_t *a_category;
@@ -133,6 +162,8 @@ zlog_category_t *zlog_category_new(const char *name, zc_arraylist_t * rules)
 		zc_error("calloc fail, errno[%d]", errno);
 		return NULL;
 	}
+	a_category->level = -1;
+	a_category->rules_level_backup = -1;
 
 	if (zlog_category_obtain_rules(a_category, name, rules)) {
 		zc_error("zlog_category_fit_rules fail");
@@ -151,7 +182,7 @@ err:
 /*******************************************************************************/
 /* update success: fit_rules 1, fit_rules_backup 1 */
 /* update fail: fit_rules 0, fit_rules_backup 1 */
-int zlog_category_update_rules(zlog_category_t * a_category, zc_arraylist_t * new_rules)
+int zlog_category_update_rules(zlog_category_t * a_category, zlog_rule_trie_t * new_rules)
 {
 	zc_assert(a_category, -1);
 	zc_assert(new_rules, -1);
@@ -163,6 +194,7 @@ int zlog_category_update_rules(zlog_category_t * a_category, zc_arraylist_t * ne
 
 	memcpy(a_category->level_bitmap_backup, a_category->level_bitmap,
 			sizeof(a_category->level_bitmap));
+	a_category->rules_level_backup = a_category->rules_level;
 
 	/* 2nd, obtain new_rules to fit_rules */
 	if (zlog_category_obtain_rules(a_category, a_category->name, new_rules)) {
@@ -189,6 +221,7 @@ void zlog_category_commit_rules(zlog_category_t * a_category)
 	a_category->fit_rules_backup = NULL;
 	memset(a_category->level_bitmap_backup, 0x00,
 			sizeof(a_category->level_bitmap_backup));
+	a_category->rules_level_backup = -1;
 	return;
 }
 
@@ -218,6 +251,8 @@ void zlog_category_rollback_rules(zlog_category_t * a_category)
 			sizeof(a_category->level_bitmap));
 	memset(a_category->level_bitmap_backup, 0x00,
 			sizeof(a_category->level_bitmap_backup));
+	a_category->rules_level = a_category->rules_level_backup;
+	a_category->rules_level_backup = -1;
 
 	return; /* always success */
 }
@@ -228,8 +263,25 @@ int zlog_category_output(zlog_category_t * a_category, zlog_thread_t * a_thread)
 {
 	int i;
 	int rc = 0;
+	int level;
 	zlog_rule_t *a_rule;
 
+	/* a new event, %m is not rendered yet */
+	a_thread->usr_msg_ready = 0;
+
+	level = a_category->level;
+	if (level >= 0) {
+		if (a_thread->event->level < level) return 0;
+		zc_arraylist_foreach(a_category->fit_rules, i, a_rule) {
+			if (zlog_category_lowers_rule(a_category, a_rule)) {
+				rc = zlog_rule_output_any_level(a_rule, a_thread);
+			} else {
+				rc = zlog_rule_output(a_rule, a_thread);
+			}
+		}
+		return rc;
+	}
+
 	/* go through all match rules to output */
 	zc_arraylist_foreach(a_category->fit_rules, i, a_rule) {
 		rc = zlog_rule_output(a_rule, a_thread);
@@ -237,3 +289,27 @@ int zlog_category_output(zlog_category_t * a_category, zlog_thread_t * a_thread)
 
 	return rc;
 }
+
+/*******************************************************************************/
+void zlog_category_set_level(zlog_category_t * a_category, int level)
+{
+	int i;
+	int j;
+	unsigned char bitmap[sizeof(a_category->level_bitmap)];
+	zlog_rule_t *a_rule;
+
+	zc_assert(a_category,);
+
+	/* level first, a record the new bitmap lets in sees it */
+	a_category->level = level;
+	if (level >= 0) {
+		zlog_category_level_bitmap(a_category, bitmap);
+	} else {
+		memset(bitmap, 0x00, sizeof(bitmap));
+		zc_arraylist_foreach(a_category->fit_rules, i, a_rule) {
+			for (j = 0; j < sizeof(bitmap); j++) bitmap[j] |= a_rule->level_bitmap[j];
+		}
+	}
+	memcpy(a_category->level_bitmap, bitmap, sizeof(bitmap));
+	return;
+}
@@ -11,24 +11,34 @@
 
 #include "zc_defs.h"
 #include "thread.h"
+#include "rule_trie.h"
 
 typedef struct zlog_category_s {
 	char name[MAXLEN_CFG_NAME + 1];
 	size_t name_len;
 	unsigned char level_bitmap[32];
 	unsigned char level_bitmap_backup[32];
+	int level;			/* of zlog_set_category_level, -1 for none */
+	int rules_level;		/* lowest of its rules of '.', -1 for none */
+	int rules_level_backup;
 	zc_arraylist_t *fit_rules;
 	zc_arraylist_t *fit_rules_backup;
 } zlog_category_t;
 
-zlog_category_t *zlog_category_new(const char *name, zc_arraylist_t * rules);
+zlog_category_t *zlog_category_new(const char *name, zlog_rule_trie_t * rules);
 void zlog_category_del(zlog_category_t * a_category);
 void zlog_category_profile(zlog_category_t *a_category, int flag);
 
-int zlog_category_update_rules(zlog_category_t * a_category, zc_arraylist_t * new_rules);
+int zlog_category_update_rules(zlog_category_t * a_category, zlog_rule_trie_t * new_rules);
 void zlog_category_commit_rules(zlog_category_t * a_category);
 void zlog_category_rollback_rules(zlog_category_t * a_category);
 
+/* nothing below level goes, and the rules of '.' at the lowest level of
+ * the category take all at level and above, other rules keep their own
+ * levels, -1 goes back to the levels of rules, it stays over reload
+ */
+void zlog_category_set_level(zlog_category_t * a_category, int level);
+
 int zlog_category_output(zlog_category_t * a_category, zlog_thread_t * a_thread);
 
 #define zlog_category_needless_level(a_category, lv) \
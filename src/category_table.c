@@ -54,7 +54,7 @@ zc_hashtable_t *zlog_category_table_new(void)
 	}
 }
 /*******************************************************************************/
-int zlog_category_table_update_rules(zc_hashtable_t * categories, zc_arraylist_t * new_rules)
+int zlog_category_table_update_rules(zc_hashtable_t * categories, zlog_rule_trie_t * new_rules)
 {
 	zc_hashtable_entry_t *a_entry;
 	zlog_category_t *a_category;
@@ -96,9 +96,25 @@ void zlog_category_table_rollback_rules(zc_hashtable_t * categories)
 	return;
 }
 
+void zlog_category_table_set_level(zc_hashtable_t * categories, const char *pattern, int level)
+{
+	zc_hashtable_entry_t *a_entry;
+	zlog_category_t *a_category;
+
+	zc_assert(categories,);
+	zc_assert(pattern,);
+	zc_hashtable_foreach(categories, a_entry) {
+		a_category = (zlog_category_t *) a_entry->value;
+		if (zlog_rule_trie_fit(pattern, a_category->name)) {
+			zlog_category_set_level(a_category, level);
+		}
+	}
+	return;
+}
+
 /*******************************************************************************/
 zlog_category_t *zlog_category_table_fetch_category(zc_hashtable_t * categories,
-			const char *category_name, zc_arraylist_t * rules)
+			const char *category_name, zlog_rule_trie_t * rules)
 {
 	zlog_category_t *a_category;
 
@@ -19,10 +19,13 @@ void zlog_category_table_profile(zc_hashtable_t * categories, int flag);
 /* if none, create new and return */
 zlog_category_t *zlog_category_table_fetch_category(
 			zc_hashtable_t * categories,
-		 	const char *category_name, zc_arraylist_t * rules);
+		 	const char *category_name, zlog_rule_trie_t * rules);
 
-int zlog_category_table_update_rules(zc_hashtable_t * categories, zc_arraylist_t * new_rules);
+int zlog_category_table_update_rules(zc_hashtable_t * categories, zlog_rule_trie_t * new_rules);
 void zlog_category_table_commit_rules(zc_hashtable_t * categories);
 void zlog_category_table_rollback_rules(zc_hashtable_t * categories);
 
+/* for the categories whose name fits pattern, as a category of rule */
+void zlog_category_table_set_level(zc_hashtable_t * categories, const char *pattern, int level);
+
 #endif
@@ -0,0 +1,929 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef ZLOG_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "compress.h"
+#include "zc_defs.h"
+
+#define ZLOG_COMPRESS_CHUNK (64 * 1024)
+
+size_t zlog_compress_suffix_len(const char *tail)
+{
+	if (STRCMP(tail, ==, ".gz")) return sizeof(".gz") - 1;
+	if (STRCMP(tail, ==, ".lz4")) return sizeof(".lz4") - 1;
+	return 0;
+}
+
+static int zlog_compress_write(int fd, const unsigned char *buf, size_t len)
+{
+	ssize_t nwrite;
+
+	while (len > 0) {
+		nwrite = write(fd, buf, len);
+		if (nwrite < 0) {
+			if (errno == EINTR) continue;
+			zc_error("write fail, errno[%d]", errno);
+			return -1;
+		}
+		buf += nwrite;
+		len -= nwrite;
+	}
+	return 0;
+}
+
+static ssize_t zlog_compress_read(int fd, unsigned char *buf, size_t len)
+{
+	ssize_t nread;
+	size_t total = 0;
+
+	/* fill the whole chunk, so blocks have the same size unless at eof */
+	while (total < len) {
+		nread = read(fd, buf + total, len - total);
+		if (nread < 0) {
+			if (errno == EINTR) continue;
+			zc_error("read fail, errno[%d]", errno);
+			return -1;
+		}
+		if (nread == 0) break;
+		total += nread;
+	}
+	return total;
+}
+
+/*******************************************************************************/
+/* lz4 frame with independent 64KB blocks, readable by the lz4 tool.
+ * only the fast greedy matcher of the block format is implemented,
+ * which is enough for log text, the decoder reads any lz4 frame
+ */
+
+#define LZ4_MAGIC		0x184D2204U
+#define LZ4_FLG			0x60	/* version 01, independent blocks */
+#define LZ4_BD			0x40	/* 64KB max block size */
+#define LZ4_BLOCK_MAX		(64 * 1024)
+#define LZ4_BLOCK_BOUND		(LZ4_BLOCK_MAX + LZ4_BLOCK_MAX / 255 + 16)
+#define LZ4_UNCOMPRESSED	0x80000000U
+
+#define LZ4_HASH_LOG		12
+#define LZ4_MIN_MATCH		4
+#define LZ4_MFLIMIT		12	/* last match starts 12 bytes before end */
+#define LZ4_LASTLITERALS	5	/* last 5 bytes are always literals */
+
+#define XXH_PRIME32_1		2654435761U
+#define XXH_PRIME32_2		2246822519U
+#define XXH_PRIME32_3		3266489917U
+#define XXH_PRIME32_4		668265263U
+#define XXH_PRIME32_5		374761393U
+
+#define zlog_rotl32(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+
+static uint32_t zlog_read_le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void zlog_write_le32(unsigned char *p, uint32_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = (v >> 8) & 0xFF;
+	p[2] = (v >> 16) & 0xFF;
+	p[3] = (v >> 24) & 0xFF;
+}
+
+#ifndef ZLOG_HAVE_ZLIB
+static uint32_t zlog_read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* xxh32 for inputs shorter than 16 bytes, only the frame header is hashed */
+static uint32_t zlog_xxh32_short(const unsigned char *p, size_t len, uint32_t seed)
+{
+	uint32_t h32 = seed + XXH_PRIME32_5 + (uint32_t)len;
+
+	for (; len >= 4; len -= 4, p += 4) {
+		h32 += (uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) * XXH_PRIME32_3;
+		h32 = zlog_rotl32(h32, 17) * XXH_PRIME32_4;
+	}
+	for (; len > 0; len--, p++) {
+		h32 += (*p) * XXH_PRIME32_5;
+		h32 = zlog_rotl32(h32, 11) * XXH_PRIME32_1;
+	}
+
+	h32 ^= h32 >> 15;
+	h32 *= XXH_PRIME32_2;
+	h32 ^= h32 >> 13;
+	h32 *= XXH_PRIME32_3;
+	h32 ^= h32 >> 16;
+	return h32;
+}
+
+static unsigned char *zlog_lz4_put_len(unsigned char *op, size_t len)
+{
+	for (; len >= 255; len -= 255) *op++ = 255;
+	*op++ = (unsigned char)len;
+	return op;
+}
+
+/* src_len <= LZ4_BLOCK_MAX, dst has at least LZ4_BLOCK_BOUND bytes
+ * return compressed length
+ */
+static size_t zlog_lz4_compress_block(const unsigned char *src, size_t src_len,
+		unsigned char *dst, uint16_t *table)
+{
+	const unsigned char *ip = src;
+	const unsigned char *anchor = src;
+	const unsigned char *iend = src + src_len;
+	const unsigned char *mflimit = iend - LZ4_MFLIMIT;
+	const unsigned char *matchlimit = iend - LZ4_LASTLITERALS;
+	const unsigned char *ref;
+	unsigned char *op = dst;
+	unsigned char *token;
+	uint32_t seq;
+	uint32_t h;
+	size_t lit_len;
+	size_t match_len;
+
+	if (src_len < LZ4_MFLIMIT + 1) goto last_literals;
+
+	memset(table, 0x00, sizeof(uint16_t) << LZ4_HASH_LOG);
+	ip++;
+
+	while (ip < mflimit) {
+		seq = zlog_read32(ip);
+		h = (seq * XXH_PRIME32_1) >> (32 - LZ4_HASH_LOG);
+		ref = src + table[h];
+		table[h] = (uint16_t)(ip - src);
+
+		if (ref >= ip || zlog_read32(ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		/* extend backwards into pending literals */
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		lit_len = ip - anchor;
+		token = op++;
+		if (lit_len >= 15) {
+			*token = 15 << 4;
+			op = zlog_lz4_put_len(op, lit_len - 15);
+		} else {
+			*token = (unsigned char)(lit_len << 4);
+		}
+		memcpy(op, anchor, lit_len);
+		op += lit_len;
+
+		/* block is at most 64KB, so is the offset */
+		*op++ = (unsigned char)((ip - ref) & 0xFF);
+		*op++ = (unsigned char)((ip - ref) >> 8);
+
+		anchor = ip;
+		ip += LZ4_MIN_MATCH;
+		ref += LZ4_MIN_MATCH;
+		while (ip < matchlimit && *ip == *ref) {
+			ip++;
+			ref++;
+		}
+		match_len = ip - anchor - LZ4_MIN_MATCH;
+
+		if (match_len >= 15) {
+			*token |= 15;
+			op = zlog_lz4_put_len(op, match_len - 15);
+		} else {
+			*token |= (unsigned char)match_len;
+		}
+
+		anchor = ip;
+	}
+
+last_literals:
+	lit_len = iend - anchor;
+	token = op++;
+	if (lit_len >= 15) {
+		*token = 15 << 4;
+		op = zlog_lz4_put_len(op, lit_len - 15);
+	} else {
+		*token = (unsigned char)(lit_len << 4);
+	}
+	memcpy(op, anchor, lit_len);
+	op += lit_len;
+
+	return op - dst;
+}
+
+static int zlog_lz4_compress_fd(int in_fd, int out_fd, volatile int *stop)
+{
+	ssize_t nread;
+	size_t nzip;
+	unsigned char header[7];
+	unsigned char *in;
+	unsigned char *out;
+	uint16_t *table;
+
+	in = malloc(LZ4_BLOCK_MAX + 4 + LZ4_BLOCK_BOUND + (sizeof(uint16_t) << LZ4_HASH_LOG));
+	if (!in) {
+		zc_error("malloc fail, errno[%d]", errno);
+		return -1;
+	}
+	out = in + LZ4_BLOCK_MAX;
+	table = (uint16_t *)(out + 4 + LZ4_BLOCK_BOUND);
+
+	zlog_write_le32(header, LZ4_MAGIC);
+	header[4] = LZ4_FLG;
+	header[5] = LZ4_BD;
+	header[6] = (zlog_xxh32_short(header + 4, 2, 0) >> 8) & 0xFF;
+	if (zlog_compress_write(out_fd, header, sizeof(header))) goto err;
+
+	for (;;) {
+		if (stop && *stop) {
+			zc_debug("compress stopped");
+			goto err;
+		}
+
+		nread = zlog_compress_read(in_fd, in, LZ4_BLOCK_MAX);
+		if (nread < 0) goto err;
+		if (nread == 0) break;
+
+		nzip = zlog_lz4_compress_block(in, nread, out + 4, table);
+		if (nzip >= (size_t)nread) {
+			/* incompressible, keep it raw */
+			zlog_write_le32(out, (uint32_t)nread | LZ4_UNCOMPRESSED);
+			memcpy(out + 4, in, nread);
+			nzip = nread;
+		} else {
+			zlog_write_le32(out, (uint32_t)nzip);
+		}
+		if (zlog_compress_write(out_fd, out, nzip + 4)) goto err;
+	}
+
+	/* end mark */
+	zlog_write_le32(header, 0);
+	if (zlog_compress_write(out_fd, header, 4)) goto err;
+
+	free(in);
+	return 0;
+err:
+	free(in);
+	return -1;
+}
+#endif
+
+#ifdef ZLOG_HAVE_ZLIB
+/*******************************************************************************/
+/* gzip member, by zlib */
+
+static int zlog_gzip_compress_fd(int in_fd, int out_fd, volatile int *stop)
+{
+	int rc;
+	int flush;
+	ssize_t nread;
+	z_stream strm;
+	unsigned char *in;
+	unsigned char *out;
+
+	in = malloc(ZLOG_COMPRESS_CHUNK * 2);
+	if (!in) {
+		zc_error("malloc fail, errno[%d]", errno);
+		return -1;
+	}
+	out = in + ZLOG_COMPRESS_CHUNK;
+
+	memset(&strm, 0x00, sizeof(strm));
+	/* 15 + 16, window of 32K with gzip header and trailer */
+	rc = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+	if (rc != Z_OK) {
+		zc_error("deflateInit2 fail, rc[%d]", rc);
+		free(in);
+		return -1;
+	}
+
+	do {
+		if (stop && *stop) {
+			zc_debug("compress stopped");
+			goto err;
+		}
+
+		nread = zlog_compress_read(in_fd, in, ZLOG_COMPRESS_CHUNK);
+		if (nread < 0) goto err;
+
+		flush = (nread < ZLOG_COMPRESS_CHUNK) ? Z_FINISH : Z_NO_FLUSH;
+		strm.next_in = in;
+		strm.avail_in = nread;
+
+		do {
+			strm.next_out = out;
+			strm.avail_out = ZLOG_COMPRESS_CHUNK;
+			rc = deflate(&strm, flush);
+			if (rc == Z_STREAM_ERROR) {
+				zc_error("deflate fail, rc[%d]", rc);
+				goto err;
+			}
+			if (zlog_compress_write(out_fd, out, ZLOG_COMPRESS_CHUNK - strm.avail_out)) {
+				goto err;
+			}
+		} while (strm.avail_out == 0);
+	} while (flush != Z_FINISH);
+
+	deflateEnd(&strm);
+	free(in);
+	return 0;
+err:
+	deflateEnd(&strm);
+	free(in);
+	return -1;
+}
+#endif
+
+int zlog_compress_fd(int in_fd, int out_fd, volatile int *stop)
+{
+#ifdef ZLOG_HAVE_ZLIB
+	return zlog_gzip_compress_fd(in_fd, out_fd, stop);
+#else
+	return zlog_lz4_compress_fd(in_fd, out_fd, stop);
+#endif
+}
+
+/*******************************************************************************/
+/* one self-contained frame per call, used by the streaming rule output */
+
+#ifdef ZLOG_HAVE_ZLIB
+static long zlog_gzip_compress_frame(const char *in, size_t len,
+		unsigned char **out, size_t *out_size)
+{
+	int rc;
+	size_t bound;
+	z_stream strm;
+
+	memset(&strm, 0x00, sizeof(strm));
+	rc = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+	if (rc != Z_OK) {
+		zc_error("deflateInit2 fail, rc[%d]", rc);
+		return -1;
+	}
+
+	bound = deflateBound(&strm, len);
+	if (bound > *out_size) {
+		unsigned char *p;
+		p = realloc(*out, bound);
+		if (!p) {
+			zc_error("realloc fail, errno[%d]", errno);
+			deflateEnd(&strm);
+			return -1;
+		}
+		*out = p;
+		*out_size = bound;
+	}
+
+	strm.next_in = (unsigned char *)in;
+	strm.avail_in = len;
+	strm.next_out = *out;
+	strm.avail_out = *out_size;
+	rc = deflate(&strm, Z_FINISH);
+	if (rc != Z_STREAM_END) {
+		zc_error("deflate fail, rc[%d]", rc);
+		deflateEnd(&strm);
+		return -1;
+	}
+
+	deflateEnd(&strm);
+	return *out_size - strm.avail_out;
+}
+#else
+static long zlog_lz4_compress_frame(const char *in, size_t len,
+		unsigned char **out, size_t *out_size)
+{
+	size_t bound;
+	size_t nblock;
+	size_t nzip;
+	unsigned char *op;
+	uint16_t table[1 << LZ4_HASH_LOG];
+
+	/* header, blocks with their sizes, end mark */
+	bound = 7 + (len / LZ4_BLOCK_MAX + 1) * (4 + LZ4_BLOCK_BOUND) + 4;
+	if (bound > *out_size) {
+		unsigned char *p;
+		p = realloc(*out, bound);
+		if (!p) {
+			zc_error("realloc fail, errno[%d]", errno);
+			return -1;
+		}
+		*out = p;
+		*out_size = bound;
+	}
+
+	op = *out;
+	zlog_write_le32(op, LZ4_MAGIC);
+	op[4] = LZ4_FLG;
+	op[5] = LZ4_BD;
+	op[6] = (zlog_xxh32_short(op + 4, 2, 0) >> 8) & 0xFF;
+	op += 7;
+
+	while (len > 0) {
+		nblock = len < LZ4_BLOCK_MAX ? len : LZ4_BLOCK_MAX;
+		nzip = zlog_lz4_compress_block((const unsigned char *)in, nblock, op + 4, table);
+		if (nzip >= nblock) {
+			zlog_write_le32(op, (uint32_t)nblock | LZ4_UNCOMPRESSED);
+			memcpy(op + 4, in, nblock);
+			nzip = nblock;
+		} else {
+			zlog_write_le32(op, (uint32_t)nzip);
+		}
+		op += 4 + nzip;
+		in += nblock;
+		len -= nblock;
+	}
+
+	zlog_write_le32(op, 0);
+	op += 4;
+	return op - *out;
+}
+#endif
+
+long zlog_compress_frame(const char *in, size_t len,
+		unsigned char **out, size_t *out_size)
+{
+	zc_assert(in, -1);
+	zc_assert(out, -1);
+	zc_assert(out_size, -1);
+
+#ifdef ZLOG_HAVE_ZLIB
+	return zlog_gzip_compress_frame(in, len, out, out_size);
+#else
+	return zlog_lz4_compress_frame(in, len, out, out_size);
+#endif
+}
+
+/*******************************************************************************/
+/* a frame of stored blocks, written piece by piece without malloc or locks,
+ * so it can be called from a signal handler, nothing is logged
+ */
+
+/* write all, or give up at the first error */
+static int zlog_compress_write_quiet(int fd, const unsigned char *buf, size_t len)
+{
+	ssize_t nwrite;
+
+	while (len > 0) {
+		nwrite = write(fd, buf, len);
+		if (nwrite < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		buf += nwrite;
+		len -= nwrite;
+	}
+	return 0;
+}
+
+#ifdef ZLOG_HAVE_ZLIB
+int zlog_compress_stored_fd(int fd, const char *in, size_t len)
+{
+	size_t nblock;
+	size_t total = len;
+	unsigned char hdr[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+	unsigned char trailer[8];
+	uLong crc;
+
+	crc = crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, (const Bytef *)in, len);
+
+	if (zlog_compress_write_quiet(fd, hdr, sizeof(hdr))) return -1;
+
+	/* deflate stored blocks, [final] [len] [~len] [data] */
+	do {
+		nblock = len < 0xFFFF ? len : 0xFFFF;
+		hdr[0] = (nblock == len) ? 1 : 0;
+		hdr[1] = nblock & 0xFF;
+		hdr[2] = (nblock >> 8) & 0xFF;
+		hdr[3] = ~hdr[1];
+		hdr[4] = ~hdr[2];
+		if (zlog_compress_write_quiet(fd, hdr, 5)
+			|| zlog_compress_write_quiet(fd, (const unsigned char *)in, nblock)) {
+			return -1;
+		}
+		in += nblock;
+		len -= nblock;
+	} while (len > 0);
+
+	/* crc32 and size mod 2^32 */
+	zlog_write_le32(trailer, (uint32_t)crc);
+	zlog_write_le32(trailer + 4, (uint32_t)total);
+	return zlog_compress_write_quiet(fd, trailer, sizeof(trailer));
+}
+#else
+int zlog_compress_stored_fd(int fd, const char *in, size_t len)
+{
+	size_t nblock;
+	unsigned char hdr[7];
+
+	zlog_write_le32(hdr, LZ4_MAGIC);
+	hdr[4] = LZ4_FLG;
+	hdr[5] = LZ4_BD;
+	hdr[6] = (zlog_xxh32_short(hdr + 4, 2, 0) >> 8) & 0xFF;
+	if (zlog_compress_write_quiet(fd, hdr, sizeof(hdr))) return -1;
+
+	while (len > 0) {
+		nblock = len < LZ4_BLOCK_MAX ? len : LZ4_BLOCK_MAX;
+		zlog_write_le32(hdr, (uint32_t)nblock | LZ4_UNCOMPRESSED);
+		if (zlog_compress_write_quiet(fd, hdr, 4)
+			|| zlog_compress_write_quiet(fd, (const unsigned char *)in, nblock)) {
+			return -1;
+		}
+		in += nblock;
+		len -= nblock;
+	}
+
+	zlog_write_le32(hdr, 0);
+	return zlog_compress_write_quiet(fd, hdr, 4);
+}
+#endif
+
+/*******************************************************************************/
+/* decoder, for zlog-cat. a file is any mix of gzip members and lz4 frames,
+ * as written by archive compression or by streaming rules, text before the
+ * first frame is copied as it is
+ */
+
+#define ZLOG_DECOMPRESS_BUF	(64 * 1024)
+#define LZ4_SKIPPABLE_MASK	0xFFFFFFF0U
+#define LZ4_SKIPPABLE_MAGIC	0x184D2A50U
+#define LZ4_HISTORY		(64 * 1024)
+
+typedef struct {
+	int fd;
+	unsigned char *buf;
+	size_t pos;
+	size_t len;
+	int eof;
+} zlog_decompress_in_t;
+
+/* keep at least want bytes in buffer, unless eof, return bytes available */
+static ssize_t zlog_decompress_fill(zlog_decompress_in_t *a_in, size_t want)
+{
+	ssize_t nread;
+
+	if (a_in->len - a_in->pos >= want || a_in->eof) return a_in->len - a_in->pos;
+
+	memmove(a_in->buf, a_in->buf + a_in->pos, a_in->len - a_in->pos);
+	a_in->len -= a_in->pos;
+	a_in->pos = 0;
+
+	while (a_in->len < want) {
+		nread = read(a_in->fd, a_in->buf + a_in->len, ZLOG_DECOMPRESS_BUF - a_in->len);
+		if (nread < 0) {
+			if (errno == EINTR) continue;
+			zc_error("read fail, errno[%d]", errno);
+			return -1;
+		}
+		if (nread == 0) {
+			a_in->eof = 1;
+			break;
+		}
+		a_in->len += nread;
+	}
+	return a_in->len;
+}
+
+/* read exactly len bytes, which may be larger than the buffer */
+static int zlog_decompress_take(zlog_decompress_in_t *a_in, unsigned char *dst, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		if (zlog_decompress_fill(a_in, 1) <= 0) {
+			zc_error("unexpected end of input");
+			return -1;
+		}
+		n = a_in->len - a_in->pos;
+		if (n > len) n = len;
+		memcpy(dst, a_in->buf + a_in->pos, n);
+		a_in->pos += n;
+		dst += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int zlog_decompress_skip(zlog_decompress_in_t *a_in, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		if (zlog_decompress_fill(a_in, 1) <= 0) {
+			zc_error("unexpected end of input");
+			return -1;
+		}
+		n = a_in->len - a_in->pos;
+		if (n > len) n = len;
+		a_in->pos += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* decode one lz4 block after the history already in dst[0, dst_pos)
+ * return new dst_pos, or -1 on corrupted input
+ */
+static long zlog_lz4_decompress_block(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t dst_pos, size_t dst_size)
+{
+	const unsigned char *ip = src;
+	const unsigned char *iend = src + src_len;
+	unsigned char *op = dst + dst_pos;
+	unsigned char *oend = dst + dst_size;
+	const unsigned char *ref;
+	size_t len;
+	size_t offset;
+	unsigned char token;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		len = token >> 4;
+		if (len == 15) {
+			do {
+				if (ip >= iend) return -1;
+				len += *ip;
+			} while (*ip++ == 255);
+		}
+		if (len > (size_t)(iend - ip) || len > (size_t)(oend - op)) return -1;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* last sequence has literals only */
+		if (ip == iend) break;
+
+		if (iend - ip < 2) return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst)) return -1;
+		ref = op - offset;
+
+		len = token & 15;
+		if (len == 15) {
+			do {
+				if (ip >= iend) return -1;
+				len += *ip;
+			} while (*ip++ == 255);
+		}
+		len += LZ4_MIN_MATCH;
+		if (len > (size_t)(oend - op)) return -1;
+
+		/* byte by byte, source and destination may overlap */
+		while (len--) *op++ = *ref++;
+	}
+
+	return op - dst;
+}
+
+static int zlog_lz4_decompress_frame(zlog_decompress_in_t *a_in, int out_fd)
+{
+	int rc = -1;
+	unsigned char flg;
+	unsigned char bd;
+	unsigned char hdr[8];
+	size_t block_max;
+	size_t hdr_len;
+	size_t history;
+	uint32_t bsize;
+	unsigned char *zbuf = NULL;
+	unsigned char *obuf = NULL;
+	long n;
+
+	/* magic already consumed */
+	if (zlog_decompress_take(a_in, hdr, 2)) return -1;
+	flg = hdr[0];
+	bd = hdr[1];
+	if ((flg >> 6) != 1) {
+		zc_error("lz4 frame version[%d] unknown", flg >> 6);
+		return -1;
+	}
+	if (((bd >> 4) & 7) < 4) {
+		zc_error("lz4 block max size id[%d] unknown", (bd >> 4) & 7);
+		return -1;
+	}
+	block_max = (size_t)1 << (8 + 2 * ((bd >> 4) & 7));
+
+	/* content size, dict id, header checksum are not needed to decode */
+	hdr_len = 1 + ((flg & 0x08) ? 8 : 0) + ((flg & 0x01) ? 4 : 0);
+	if (zlog_decompress_skip(a_in, hdr_len)) return -1;
+
+	zbuf = malloc(block_max);
+	obuf = malloc(LZ4_HISTORY + block_max);
+	if (!zbuf || !obuf) {
+		zc_error("malloc fail, errno[%d]", errno);
+		goto exit;
+	}
+
+	history = 0;
+	for (;;) {
+		if (zlog_decompress_take(a_in, hdr, 4)) goto exit;
+		bsize = zlog_read_le32(hdr);
+		if (bsize == 0) break;
+
+		if ((bsize & ~LZ4_UNCOMPRESSED) > block_max) {
+			zc_error("lz4 block size[%lu] too large", (unsigned long)(bsize & ~LZ4_UNCOMPRESSED));
+			goto exit;
+		}
+
+		/* independent blocks need no history */
+		if (flg & 0x20) history = 0;
+
+		if (bsize & LZ4_UNCOMPRESSED) {
+			bsize &= ~LZ4_UNCOMPRESSED;
+			if (zlog_decompress_take(a_in, obuf + history, bsize)) goto exit;
+			n = history + bsize;
+		} else {
+			if (zlog_decompress_take(a_in, zbuf, bsize)) goto exit;
+			n = zlog_lz4_decompress_block(zbuf, bsize, obuf, history, LZ4_HISTORY + block_max);
+			if (n < 0) {
+				zc_error("lz4 block corrupted");
+				goto exit;
+			}
+		}
+		if (zlog_compress_write(out_fd, obuf + history, n - history)) goto exit;
+
+		/* keep last 64KB for linked blocks */
+		if ((size_t)n > LZ4_HISTORY) {
+			memmove(obuf, obuf + n - LZ4_HISTORY, LZ4_HISTORY);
+			history = LZ4_HISTORY;
+		} else {
+			history = n;
+		}
+
+		if ((flg & 0x10) && zlog_decompress_skip(a_in, 4)) goto exit;
+	}
+
+	if ((flg & 0x04) && zlog_decompress_skip(a_in, 4)) goto exit;
+	rc = 0;
+exit:
+	free(zbuf);
+	free(obuf);
+	return rc;
+}
+
+#ifdef ZLOG_HAVE_ZLIB
+static int zlog_gzip_decompress_member(zlog_decompress_in_t *a_in, int out_fd)
+{
+	int rc;
+	z_stream strm;
+	unsigned char out[ZLOG_DECOMPRESS_BUF];
+
+	memset(&strm, 0x00, sizeof(strm));
+	rc = inflateInit2(&strm, 15 + 16);
+	if (rc != Z_OK) {
+		zc_error("inflateInit2 fail, rc[%d]", rc);
+		return -1;
+	}
+
+	do {
+		if (zlog_decompress_fill(a_in, 1) <= 0) {
+			zc_error("unexpected end of gzip member");
+			goto err;
+		}
+		strm.next_in = a_in->buf + a_in->pos;
+		strm.avail_in = a_in->len - a_in->pos;
+
+		do {
+			strm.next_out = out;
+			strm.avail_out = sizeof(out);
+			rc = inflate(&strm, Z_NO_FLUSH);
+			if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+				zc_error("inflate fail, rc[%d]", rc);
+				goto err;
+			}
+			if (zlog_compress_write(out_fd, out, sizeof(out) - strm.avail_out)) goto err;
+		} while (strm.avail_out == 0 && rc != Z_STREAM_END);
+
+		/* the rest may be the next member */
+		a_in->pos = a_in->len - strm.avail_in;
+	} while (rc != Z_STREAM_END);
+
+	inflateEnd(&strm);
+	return 0;
+err:
+	inflateEnd(&strm);
+	return -1;
+}
+#endif
+
+/* could a frame start at p, gzip 1F 8B, lz4 04 22 4D 18 or skippable 5x 2A 4D 18,
+ * a magic cut by the end of the buffer counts, it is looked at again whole
+ */
+static int zlog_decompress_is_magic(const unsigned char *p, size_t left)
+{
+	static const unsigned char gz[] = { 0x1F, 0x8B };
+	static const unsigned char lz4[] = { 0x04, 0x22, 0x4D, 0x18 };
+	static const unsigned char skip[] = { 0x2A, 0x4D, 0x18 };
+
+	switch (p[0]) {
+	case 0x1F:
+		return !memcmp(p, gz, left < 2 ? left : 2);
+	case 0x04:
+		return !memcmp(p, lz4, left < 4 ? left : 4);
+	default:
+		if ((p[0] & 0xF0) != 0x50) return 0;
+		return left == 1 || !memcmp(p + 1, skip, left < 4 ? left - 1 : 3);
+	}
+}
+
+/* plain text up to where the next frame may start */
+static size_t zlog_decompress_plain_len(zlog_decompress_in_t *a_in)
+{
+	size_t i;
+
+	for (i = a_in->pos + 1; i < a_in->len; i++) {
+		if (zlog_decompress_is_magic(a_in->buf + i, a_in->len - i)) break;
+	}
+	return i - a_in->pos;
+}
+
+int zlog_decompress_fd(int in_fd, int out_fd)
+{
+	int rc = -1;
+	int nframes = 0;
+	ssize_t avail;
+	uint32_t magic;
+	size_t plain_len;
+	zlog_decompress_in_t a_in;
+
+	memset(&a_in, 0x00, sizeof(a_in));
+	a_in.fd = in_fd;
+	a_in.buf = malloc(ZLOG_DECOMPRESS_BUF);
+	if (!a_in.buf) {
+		zc_error("malloc fail, errno[%d]", errno);
+		return -1;
+	}
+
+	for (;;) {
+		avail = zlog_decompress_fill(&a_in, 4);
+		if (avail < 0) goto exit;
+		if (avail == 0) break;
+
+		if (avail >= 2 && a_in.buf[a_in.pos] == 0x1F && a_in.buf[a_in.pos + 1] == 0x8B) {
+#ifdef ZLOG_HAVE_ZLIB
+			if (zlog_gzip_decompress_member(&a_in, out_fd)) goto exit;
+			nframes++;
+			continue;
+#else
+			zc_error("gzip input, but built without zlib");
+			goto exit;
+#endif
+		}
+
+		if (avail >= 4) {
+			magic = zlog_read_le32(a_in.buf + a_in.pos);
+			if (magic == LZ4_MAGIC) {
+				a_in.pos += 4;
+				if (zlog_lz4_decompress_frame(&a_in, out_fd)) goto exit;
+				nframes++;
+				continue;
+			}
+			if ((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+				unsigned char len[4];
+				a_in.pos += 4;
+				if (zlog_decompress_take(&a_in, len, 4)) goto exit;
+				if (zlog_decompress_skip(&a_in, zlog_read_le32(len))) goto exit;
+				continue;
+			}
+		}
+
+		/* plain text is only expected before any frame, e.g. a file
+		 * which was a normal log before the rule turned to compress
+		 */
+		if (nframes) {
+			zc_error("garbage after frame %d", nframes);
+			goto exit;
+		}
+		plain_len = zlog_decompress_plain_len(&a_in);
+		if (zlog_compress_write(out_fd, a_in.buf + a_in.pos, plain_len)) goto exit;
+		a_in.pos += plain_len;
+	}
+
+	rc = 0;
+exit:
+	free(a_in.buf);
+	return rc;
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_compress_h
+#define __zlog_compress_h
+
+#include <stddef.h>
+
+/* archives are compressed as gzip when zlib is found at build time,
+ * or else by the built-in codec which writes lz4 frames
+ */
+#ifdef ZLOG_HAVE_ZLIB
+#define ZLOG_COMPRESS_SUFFIX ".gz"
+#else
+#define ZLOG_COMPRESS_SUFFIX ".lz4"
+#endif
+
+/* return length of the compressed suffix which tail is, or 0
+ * both suffixes are known, whichever codec was built in
+ */
+size_t zlog_compress_suffix_len(const char *tail);
+
+/* compress all of in_fd into out_fd, *stop is checked between chunks
+ * return 0 on success, -1 on fail or when stopped
+ */
+int zlog_compress_fd(int in_fd, int out_fd, volatile int *stop);
+
+/* compress in as one complete gzip member or lz4 frame, which can be
+ * decoded without anything before it, *out is grown as needed
+ * return length of the frame in *out, -1 on fail
+ */
+long zlog_compress_frame(const char *in, size_t len,
+		unsigned char **out, size_t *out_size);
+
+/* write in as one gzip member or lz4 frame of stored blocks, not compressed,
+ * with write only, so it is safe in a signal handler, nothing is logged
+ * return 0 on success, -1 on fail
+ */
+int zlog_compress_stored_fd(int fd, const char *in, size_t len);
+
+/* decode all gzip members and lz4 frames of in_fd into out_fd
+ * return 0 on success, -1 on corrupted input or io fail
+ */
+int zlog_decompress_fd(int in_fd, int out_fd);
+
+#endif
@@ -34,6 +34,9 @@
 #define ZLOG_CONF_DEFAULT_FSYNC_PERIOD 0
 #define ZLOG_CONF_DEFAULT_ARCHIVE_MAX_SIZE (50 * 1024 * 1024)
 #define ZLOG_CONF_DEFAULT_ARCHIVE_MAX_COUNT 10
+#define ZLOG_CONF_DEFAULT_ARCHIVE_COMPRESS_JOBS 1
+#define ZLOG_CONF_ARCHIVE_WORKER_NICE 10
+#define ZLOG_CONF_ARCHIVE_PRUNE_PERIOD (60 * 1000)
 
 #define ZLOG_CONF_BACKUP_ROTATE_LOCK_FILE "/tmp/zlog.lock"
 /*******************************************************************************/
@@ -60,6 +63,14 @@ void zlog_conf_profile(zlog_conf_t * a_conf, int flag)
 	zc_profile(flag, "---fsync period[%ld]---", a_conf->fsync_period);
 	zc_profile(flag, "---default archive maxbytes[%ld]---", a_conf->archive_max_size);
 	zc_profile(flag, "---default archive maxcount[%d]---", a_conf->archive_max_count);
+	zc_profile(flag, "---default archive maxtotal[%ld]---", (long)a_conf->archive_max_total);
+	zc_profile(flag, "---default archive maxage[%ld]---", a_conf->archive_max_age);
+	zc_profile(flag, "---archive compress[%d]---", a_conf->archive_compress);
+	zc_profile(flag, "---archive compress jobs[%d]---", a_conf->archive_compress_jobs);
+	if (a_conf->archive_worker) zlog_worker_profile(a_conf->archive_worker, flag);
+
+	zc_profile(flag, "---crash flush[%d]---", a_conf->crash_flush);
+	if (a_conf->watcher) zlog_watcher_profile(a_conf->watcher, flag);
 
 	zc_profile(flag, "---rotate lock file[%s]---", a_conf->rotate_lock_file);
 	if (a_conf->rotater) zlog_rotater_profile(a_conf->rotater, flag);
@@ -95,6 +106,14 @@ void zlog_conf_del(zlog_conf_t * a_conf)
 	if (a_conf->default_format_line)
 		free(a_conf->default_format_line);
 
+	/* before rules, it flips their flags */
+	if (a_conf->watcher)
+		zlog_watcher_del(a_conf->watcher);
+
+	/* before rotater, jobs of worker use it */
+	if (a_conf->archive_worker)
+		zlog_worker_del(a_conf->archive_worker);
+
 	if (a_conf->rotater)
 		zlog_rotater_del(a_conf->rotater);
 
@@ -107,6 +126,9 @@ void zlog_conf_del(zlog_conf_t * a_conf)
 	if (a_conf->formats)
 		zc_arraylist_del(a_conf->formats);
 
+	if (a_conf->rule_trie)
+		zlog_rule_trie_del(a_conf->rule_trie);
+
 	if (a_conf->rules)
 		zc_arraylist_del(a_conf->rules);
 
@@ -117,6 +139,8 @@ void zlog_conf_del(zlog_conf_t * a_conf)
 
 static int zlog_conf_build_without_file(zlog_conf_t * a_conf);
 static int zlog_conf_build_with_file(zlog_conf_t * a_conf);
+static void zlog_conf_watch_rules(zlog_conf_t * a_conf);
+static void zlog_conf_prune_archives(zlog_conf_t * a_conf);
 
 zlog_conf_t *zlog_conf_new(const char *confpath)
 {
@@ -159,6 +183,11 @@ zlog_conf_t *zlog_conf_new(const char *confpath)
 
 	a_conf->archive_max_size = ZLOG_CONF_DEFAULT_ARCHIVE_MAX_SIZE;
 	a_conf->archive_max_count = ZLOG_CONF_DEFAULT_ARCHIVE_MAX_COUNT;
+	a_conf->archive_max_total = 0;
+	a_conf->archive_max_age = 0;
+	a_conf->archive_compress = 0;
+	a_conf->archive_compress_jobs = ZLOG_CONF_DEFAULT_ARCHIVE_COMPRESS_JOBS;
+	a_conf->crash_flush = 0;
 	/* set default configuration end */
 
 	a_conf->levels = zlog_level_list_new(ARRAY_LIST_DEFAULT_SIZE);
@@ -197,6 +226,15 @@ zlog_conf_t *zlog_conf_new(const char *confpath)
 	zc_arraylist_reduce_size(a_conf->formats);
 	zc_arraylist_reduce_size(a_conf->rules);
 
+	a_conf->rule_trie = zlog_rule_trie_new(a_conf->rules);
+	if (!a_conf->rule_trie) {
+		zc_error("zlog_rule_trie_new fail");
+		goto err;
+	}
+
+	zlog_conf_watch_rules(a_conf);
+	zlog_conf_prune_archives(a_conf);
+
 	zlog_conf_profile(a_conf, ZC_DEBUG);
 	return a_conf;
 err:
@@ -204,6 +242,50 @@ err:
 	return NULL;
 }
 /*******************************************************************************/
+/* one thread tells static file rules when their file is moved away,
+ * without inotify they stat the file once a second as before
+ */
+static void zlog_conf_watch_rules(zlog_conf_t * a_conf)
+{
+	int i;
+	zlog_rule_t *a_rule;
+
+	a_conf->watcher = zlog_watcher_new();
+	if (!a_conf->watcher) return;
+
+	zc_arraylist_foreach(a_conf->rules, i, a_rule) {
+		zlog_rule_watch(a_rule, a_conf->watcher);
+	}
+
+	/* fail, the watcher is dead and rules poll */
+	if (zlog_watcher_start(a_conf->watcher)) {
+		zc_error("zlog_watcher_start fail");
+	}
+	return;
+}
+/*******************************************************************************/
+/* archives are pruned between rotations too, a minute apart,
+ * or sooner when a rule keeps them for less
+ */
+static void zlog_conf_prune_archives(zlog_conf_t * a_conf)
+{
+	int i;
+	long period = ZLOG_CONF_ARCHIVE_PRUNE_PERIOD;
+	zlog_rule_t *a_rule;
+
+	if (!a_conf->archive_worker) return;
+
+	zc_arraylist_foreach(a_conf->rules, i, a_rule) {
+		if (a_rule->archive_max_age > 0 && a_rule->archive_max_age * 1000 < period) {
+			period = a_rule->archive_max_age * 1000;
+		}
+	}
+
+	/* the thread starts at the first rotation */
+	zlog_worker_set_tick(a_conf->archive_worker, period, zlog_rotater_tick, a_conf->rotater);
+	return;
+}
+/*******************************************************************************/
 static int zlog_conf_build_without_file(zlog_conf_t * a_conf)
 {
 	zlog_rule_t *default_rule;
@@ -229,6 +311,7 @@ static int zlog_conf_build_without_file(zlog_conf_t * a_conf)
 			a_conf->fsync_period,
 			ZLOG_CONF_DEFAULT_ARCHIVE_MAX_SIZE,
 			ZLOG_CONF_DEFAULT_ARCHIVE_MAX_COUNT,
+			0, 0,
 			&(a_conf->time_cache_count));
 	if (!default_rule) {
 		zc_error("zlog_rule_new fail");
@@ -417,6 +500,17 @@ static int zlog_conf_parse_line(zlog_conf_t * a_conf, char *line, int *section)
 				zc_error("zlog_format_new fail");
 				return -1;
 			}
+
+			/* compresses and prunes archives, ticks to prune between rotations,
+			 * threads are started at the first rotation
+			 */
+			a_conf->archive_worker = zlog_worker_new("archive",
+						a_conf->archive_compress_jobs,
+						ZLOG_CONF_ARCHIVE_WORKER_NICE);
+			if (!a_conf->archive_worker) {
+				zc_error("zlog_worker_new fail");
+				return -1;
+			}
 		} else {
 			zc_error("wrong section name[%s]", name);
 			return -1;
@@ -457,6 +551,8 @@ static int zlog_conf_parse_line(zlog_conf_t * a_conf, char *line, int *section)
 			a_conf->fsync_period,
 			a_conf->archive_max_size,
 			a_conf->archive_max_count,
+			a_conf->archive_max_total,
+			a_conf->archive_max_age,
 			&(a_conf->time_cache_count));
 
 		if (!a_rule) {
@@ -546,6 +642,32 @@ static int zlog_conf_parse_global_section(zlog_conf_t * a_conf, char *line)
 	} else if (STRCMP(word_1, ==, "default") && STRCMP(word_2, ==, "archive")
 			&& STRCMP(word_3, ==, "maxcount")) {
 		sscanf(value, "%d", &(a_conf->archive_max_count));
+	} else if (STRCMP(word_1, ==, "default") && STRCMP(word_2, ==, "archive")
+			&& STRCMP(word_3, ==, "maxtotal")) {
+		a_conf->archive_max_total = zc_parse_byte_size(value);
+		if (a_conf->archive_max_total == 0) {
+			zc_error("default archive maxtotal[%s] should be > 0", value);
+			return -1;
+		}
+	} else if (STRCMP(word_1, ==, "default") && STRCMP(word_2, ==, "archive")
+			&& STRCMP(word_3, ==, "maxage")) {
+		a_conf->archive_max_age = zc_parse_duration_ms(value) / 1000;
+		if (a_conf->archive_max_age <= 0) {
+			zc_error("default archive maxage[%s] should be >= 1s", value);
+			return -1;
+		}
+	} else if (STRCMP(word_1, ==, "archive") && STRCMP(word_2, ==, "compress")
+			&& word_3[0] == '\0') {
+		a_conf->archive_compress = STRICMP(value, ==, "true") ? 1 : 0;
+	} else if (STRCMP(word_1, ==, "archive") && STRCMP(word_2, ==, "compress")
+			&& STRCMP(word_3, ==, "jobs")) {
+		sscanf(value, "%d", &(a_conf->archive_compress_jobs));
+		if (a_conf->archive_compress_jobs <= 0) {
+			zc_error("archive compress jobs[%s] should be > 0", value);
+			return -1;
+		}
+	} else if (STRCMP(word_1, ==, "crash") && STRCMP(word_2, ==, "flush")) {
+		a_conf->crash_flush = STRICMP(value, ==, "true") ? 1 : 0;
 	} else {
 		zc_error("name[%s] is not any one of global options", name);
 		if (a_conf->strict_init)
@@ -12,6 +12,9 @@
 #include "zc_defs.h"
 #include "format.h"
 #include "rotater.h"
+#include "worker.h"
+#include "watcher.h"
+#include "rule_trie.h"
 
 typedef struct zlog_conf_s {
 	char *file;
@@ -33,10 +36,19 @@ typedef struct zlog_conf_s {
 
 	long archive_max_size;
 	int archive_max_count;
+	size_t archive_max_total;
+	long archive_max_age;
+
+	int archive_compress;
+	int archive_compress_jobs;
+	zlog_worker_t *archive_worker;
+	int crash_flush;			/* write buffered records on a crash signal */
+	zlog_watcher_t *watcher;		/* NULL, static files are polled */
 
 	zc_arraylist_t *levels;
 	zc_arraylist_t *formats;
 	zc_arraylist_t *rules;
+	zlog_rule_trie_t *rule_trie;		/* of rules, for categories */
 	int time_cache_count;
 } zlog_conf_t;
 
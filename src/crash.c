@@ -0,0 +1,102 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include "crash.h"
+#include "stream.h"
+#include "pipe.h"
+#include "zc_defs.h"
+
+static const int zlog_crash_signals[] = { SIGSEGV, SIGBUS, SIGABRT, SIGFPE };
+#define ZLOG_CRASH_NSIGNALS (sizeof(zlog_crash_signals) / sizeof(zlog_crash_signals[0]))
+
+static struct sigaction zlog_crash_old_actions[ZLOG_CRASH_NSIGNALS];
+static int zlog_crash_installed = 0;
+static volatile sig_atomic_t zlog_crash_flushed = 0;
+
+void zlog_crash_claim(int *flag)
+{
+	int i;
+	struct timespec ts = { 0, 1000000 };
+
+	for (i = 0; i < 100; i++) {
+		if (ATOM_CASB(flag, 0, 2)) return;
+		nanosleep(&ts, NULL);
+	}
+	/* the crashed thread may be the writer */
+	ATOM_SET(flag, 2);
+}
+
+static void zlog_crash_handler(int sig)
+{
+	size_t i;
+
+	/* once, a crash in the flush itself goes straight on */
+	if (!zlog_crash_flushed) {
+		zlog_crash_flushed = 1;
+		zlog_stream_crash_flush();
+		zlog_pipe_crash_flush();
+	}
+
+	for (i = 0; i < ZLOG_CRASH_NSIGNALS; i++) {
+		if (zlog_crash_signals[i] == sig) {
+			sigaction(sig, &(zlog_crash_old_actions[i]), NULL);
+			break;
+		}
+	}
+	raise(sig);
+}
+
+static int zlog_crash_install(void)
+{
+	size_t i;
+	struct sigaction act;
+
+	memset(&act, 0x00, sizeof(act));
+	act.sa_handler = zlog_crash_handler;
+	sigemptyset(&act.sa_mask);
+	act.sa_flags = SA_NODEFER;
+
+	for (i = 0; i < ZLOG_CRASH_NSIGNALS; i++) {
+		if (sigaction(zlog_crash_signals[i], &act, &(zlog_crash_old_actions[i]))) {
+			zc_error("sigaction[%d] fail, errno[%d]", zlog_crash_signals[i], errno);
+			while (i-- > 0) {
+				sigaction(zlog_crash_signals[i], &(zlog_crash_old_actions[i]), NULL);
+			}
+			return -1;
+		}
+	}
+
+	zlog_crash_installed = 1;
+	return 0;
+}
+
+static void zlog_crash_uninstall(void)
+{
+	size_t i;
+
+	for (i = 0; i < ZLOG_CRASH_NSIGNALS; i++) {
+		if (sigaction(zlog_crash_signals[i], &(zlog_crash_old_actions[i]), NULL)) {
+			zc_error("sigaction[%d] fail, errno[%d]", zlog_crash_signals[i], errno);
+		}
+	}
+	zlog_crash_installed = 0;
+}
+
+int zlog_crash_set(int enable)
+{
+	if (enable && !zlog_crash_installed) return zlog_crash_install();
+	if (!enable && zlog_crash_installed) zlog_crash_uninstall();
+	return 0;
+}
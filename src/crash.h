@@ -0,0 +1,31 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_crash_h
+#define __zlog_crash_h
+
+/* on SIGSEGV, SIGBUS, SIGABRT and SIGFPE, write out buffered records
+ * with async-signal-safe calls only, then raise the signal again to the
+ * handler which was there before, the default one dumps core
+ *
+ * blocks of buffer= rules and the buffer of | outputs are written out,
+ * the backlog of sockets, batches for a callback and backtrace records
+ * are not, they need a peer, user code or a trigger record
+ *
+ * enable installs the handler once, disable puts back the old ones
+ * return 0 on success, -1 on fail
+ */
+int zlog_crash_set(int enable);
+
+/* a writer holds flag as 1 while it writes out what it took from a
+ * buffer, this waits a while for the writer and sets it to 2, then the
+ * writer does not take more, the flag is all a crash flush looks at
+ */
+void zlog_crash_claim(int *flag);
+
+#endif
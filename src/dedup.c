@@ -0,0 +1,122 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "dedup.h"
+#include "spec.h"
+#include "zc_defs.h"
+
+void zlog_dedup_profile(zlog_dedup_t * a_dedup, int flag)
+{
+	zc_assert(a_dedup,);
+	zc_profile(flag, "--dedup[%p][window:%lluus][nrepeat:%lu]--",
+		a_dedup,
+		(unsigned long long)a_dedup->window,
+		a_dedup->nrepeat);
+	return;
+}
+
+/*******************************************************************************/
+void zlog_dedup_del(zlog_dedup_t * a_dedup)
+{
+	zc_assert(a_dedup,);
+	pthread_mutex_destroy(&(a_dedup->lock_mutex));
+	zc_debug("zlog_dedup_del[%p]", a_dedup);
+	free(a_dedup);
+	return;
+}
+
+zlog_dedup_t *zlog_dedup_new(long window_ms)
+{
+	zlog_dedup_t *a_dedup;
+
+	zc_assert(window_ms > 0, NULL);
+
+	a_dedup = calloc(1, sizeof(zlog_dedup_t));
+	if (!a_dedup) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	a_dedup->window = (uint64_t)window_ms * 1000;
+
+	if (pthread_mutex_init(&(a_dedup->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_dedup);
+		return NULL;
+	}
+
+	zlog_dedup_profile(a_dedup, ZC_DEBUG);
+	return a_dedup;
+}
+
+/*******************************************************************************/
+/* fnv-1a, the pointers stand for category and file, as their names do */
+static uint64_t zlog_dedup_hash(zlog_thread_t * a_thread)
+{
+	const unsigned char *p;
+	const unsigned char *end;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	zlog_event_t *a_event = a_thread->event;
+
+	hash = (hash ^ (uintptr_t)a_event->category_name) * 0x100000001b3ULL;
+	hash = (hash ^ (uintptr_t)a_event->file) * 0x100000001b3ULL;
+	hash = (hash ^ (uint64_t)a_event->line) * 0x100000001b3ULL;
+	hash = (hash ^ (uint64_t)a_event->level) * 0x100000001b3ULL;
+
+	p = (const unsigned char *)zlog_buf_str(a_thread->usr_msg_buf);
+	end = p + zlog_buf_len(a_thread->usr_msg_buf);
+	for (; p < end; p++) {
+		hash = (hash ^ *p) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+int zlog_dedup_check(zlog_dedup_t * a_dedup, zlog_thread_t * a_thread, unsigned long *nrepeat)
+{
+	uint64_t hash;
+	uint64_t now;
+	zlog_event_t *a_event = a_thread->event;
+
+	*nrepeat = 0;
+
+	/* the other rules and %m take the same rendering */
+	if (zlog_spec_gen_usrmsg(a_thread)) {
+		zc_error("zlog_spec_gen_usrmsg fail");
+		return 1;
+	}
+	hash = zlog_dedup_hash(a_thread);
+
+	if (!a_event->time_stamp.tv_sec) {
+		gettimeofday(&(a_event->time_stamp), NULL);
+	}
+	now = (uint64_t)a_event->time_stamp.tv_sec * 1000000 + a_event->time_stamp.tv_usec;
+
+	pthread_mutex_lock(&(a_dedup->lock_mutex));
+	/* another thread may have stamped the run a bit after this one */
+	if (now < a_dedup->first_at) now = a_dedup->first_at;
+	if (hash == a_dedup->hash && now - a_dedup->first_at < a_dedup->window) {
+		a_dedup->nrepeat++;
+		pthread_mutex_unlock(&(a_dedup->lock_mutex));
+		return 0;
+	}
+
+	/* the run is over, by another record or by time */
+	*nrepeat = a_dedup->nrepeat;
+	a_dedup->nrepeat = 0;
+	a_dedup->hash = hash;
+	a_dedup->first_at = now;
+	pthread_mutex_unlock(&(a_dedup->lock_mutex));
+	return 1;
+}
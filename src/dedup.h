@@ -0,0 +1,37 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_dedup_h
+#define __zlog_dedup_h
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "thread.h"
+
+/* the last record of a rule, by hash of category, level, file, line and %m,
+ * records equal to it in window after the first are only counted
+ */
+typedef struct zlog_dedup_s {
+	pthread_mutex_t lock_mutex;
+	uint64_t window;		/* us */
+	uint64_t hash;			/* of the last record which went */
+	uint64_t first_at;		/* us, when it went */
+	unsigned long nrepeat;		/* equal ones since, not written */
+} zlog_dedup_t;
+
+zlog_dedup_t *zlog_dedup_new(long window_ms);
+void zlog_dedup_del(zlog_dedup_t * a_dedup);
+void zlog_dedup_profile(zlog_dedup_t * a_dedup, int flag);
+
+/* return 1 when the event of a_thread goes, 0 when it repeats the last one
+ * *nrepeat is the count of repeats to report ahead of it, when it goes
+ */
+int zlog_dedup_check(zlog_dedup_t * a_dedup, zlog_thread_t * a_thread, unsigned long *nrepeat);
+
+#endif
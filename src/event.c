@@ -128,6 +128,8 @@ void zlog_event_set_fmt(zlog_event_t * a_event,
 	a_event->generate_cmd = ZLOG_FMT;
 	a_event->str_format = str_format;
 	va_copy(a_event->str_args, str_args);
+	a_event->fields = NULL;
+	a_event->field_count = 0;
 
 	/* in a event's life cycle, time will be get when spec need,
 	 * and keep unchange though all event's life cycle
@@ -158,6 +160,8 @@ void zlog_event_set_hex(zlog_event_t * a_event,
 	a_event->generate_cmd = ZLOG_HEX;
 	a_event->hex_buf = hex_buf;
 	a_event->hex_buf_len = hex_buf_len;
+	a_event->fields = NULL;
+	a_event->field_count = 0;
 
 	/* in a event's life cycle, time will be get when spec need,
 	 * and keep unchange though all event's life cycle
@@ -165,3 +169,28 @@ void zlog_event_set_hex(zlog_event_t * a_event,
 	a_event->time_stamp.tv_sec = 0;
 	return;
 }
+
+void zlog_event_set_kv(zlog_event_t * a_event,
+			char *category_name, size_t category_name_len,
+			const char *file, size_t file_len, const char *func, size_t func_len, long line, int level,
+			const char *msg, const zlog_field_t * fields, size_t field_count)
+{
+	a_event->category_name = category_name;
+	a_event->category_name_len = category_name_len;
+
+	a_event->file = (char *) file;
+	a_event->file_len = file_len;
+	a_event->func = (char *) func;
+	a_event->func_len = func_len;
+	a_event->line = line;
+	a_event->level = level;
+
+	/* fields stay where the caller has them, rendered by the specs */
+	a_event->generate_cmd = ZLOG_KV;
+	a_event->str_format = msg;
+	a_event->fields = fields;
+	a_event->field_count = field_count;
+
+	a_event->time_stamp.tv_sec = 0;
+	return;
+}
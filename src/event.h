@@ -14,10 +14,12 @@
 #include <pthread.h>    /* for pthread_t */
 #include <stdarg.h>     /* for va_list */
 #include "zc_defs.h"
+#include "kv.h"
 
 typedef enum {
 	ZLOG_FMT = 0,
 	ZLOG_HEX = 1,
+	ZLOG_KV = 2,
 } zlog_event_cmd;
 
 typedef struct zlog_time_cache_s {
@@ -41,10 +43,13 @@ typedef struct {
 
 	const void *hex_buf;
 	size_t hex_buf_len;
-	const char *str_format;
+	const char *str_format;		/* the message of ZLOG_KV */
 	va_list str_args;
 	zlog_event_cmd generate_cmd;
 
+	const zlog_field_t *fields;	/* of ZLOG_KV, none for others */
+	size_t field_count;
+
 	struct timeval time_stamp;
 
 	time_t time_local_sec;
@@ -87,4 +92,9 @@ void zlog_event_set_hex(zlog_event_t * a_event,
 			const char *file, size_t file_len, const char *func, size_t func_len, long line, int level,
 			const void *hex_buf, size_t hex_buf_len);
 
+void zlog_event_set_kv(zlog_event_t * a_event,
+			char *category_name, size_t category_name_len,
+			const char *file, size_t file_len, const char *func, size_t func_len, long line, int level,
+			const char *msg, const zlog_field_t * fields, size_t field_count);
+
 #endif
@@ -0,0 +1,220 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "flight.h"
+#include "zc_defs.h"
+
+void zlog_flight_profile(zlog_flight_t * a_flight, int flag)
+{
+	zc_assert(a_flight,);
+	zc_profile(flag, "--flight[%p][%s][%lu][cursor:%llu]--",
+		a_flight,
+		a_flight->name,
+		(unsigned long)a_flight->head->data_size,
+		(unsigned long long)a_flight->head->cursor);
+	return;
+}
+
+/*******************************************************************************/
+void zlog_flight_del(zlog_flight_t * a_flight)
+{
+	zc_assert(a_flight,);
+	if (a_flight->head) munmap(a_flight->head, a_flight->map_size);
+	zc_debug("zlog_flight_del[%p]", a_flight);
+	free(a_flight);
+	return;
+}
+
+/* same head and length as this rule wants */
+static int zlog_flight_is_same(zlog_flight_head_t * a_head, size_t data_size, off_t file_size)
+{
+	return memcmp(a_head->magic, ZLOG_FLIGHT_MAGIC, sizeof(a_head->magic)) == 0
+		&& a_head->head_size == ZLOG_FLIGHT_HEAD_SIZE
+		&& a_head->data_size == data_size
+		&& file_size == (off_t)(ZLOG_FLIGHT_HEAD_SIZE + data_size);
+}
+
+zlog_flight_t *zlog_flight_new(const char *path, size_t data_size, unsigned int perms)
+{
+	int fd;
+	struct stat stb;
+	zlog_flight_t *a_flight;
+
+	zc_assert(path, NULL);
+
+	if (data_size == 0) {
+		zc_error("flight size of [%s] is 0", path);
+		return NULL;
+	}
+	if (strlen(path) > MAXLEN_PATH) {
+		zc_error("path[%s] is too long", path);
+		return NULL;
+	}
+
+	a_flight = calloc(1, sizeof(zlog_flight_t));
+	if (!a_flight) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	strcpy(a_flight->name, path);
+	a_flight->map_size = ZLOG_FLIGHT_HEAD_SIZE + data_size;
+
+	fd = open(path, O_RDWR | O_CREAT, perms);
+	if (fd < 0) {
+		zc_error("open file[%s] fail, errno[%d]", path, errno);
+		goto err;
+	}
+	if (fstat(fd, &stb)) {
+		zc_error("fstat [%s] fail, errno[%d]", path, errno);
+		goto err;
+	}
+	/* grow or cut first, the map must not go beyond the file */
+	if (stb.st_size != (off_t)a_flight->map_size
+		&& ftruncate(fd, a_flight->map_size)) {
+		zc_error("ftruncate [%s] fail, errno[%d]", path, errno);
+		goto err;
+	}
+
+	a_flight->head = mmap(NULL, a_flight->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (a_flight->head == MAP_FAILED) {
+		a_flight->head = NULL;
+		zc_error("mmap [%s] fail, errno[%d]", path, errno);
+		goto err;
+	}
+	close(fd);
+	fd = -1;
+	a_flight->data = (char *)a_flight->head + ZLOG_FLIGHT_HEAD_SIZE;
+
+	/* left from last run, go on after it */
+	if (!zlog_flight_is_same(a_flight->head, data_size, stb.st_size)) {
+		a_flight->head->head_size = ZLOG_FLIGHT_HEAD_SIZE;
+		a_flight->head->reserved = 0;
+		a_flight->head->data_size = data_size;
+		a_flight->head->cursor = 0;
+		memcpy(a_flight->head->magic, ZLOG_FLIGHT_MAGIC, sizeof(a_flight->head->magic));
+	}
+
+	zlog_flight_profile(a_flight, ZC_DEBUG);
+	return a_flight;
+err:
+	if (fd >= 0) close(fd);
+	zlog_flight_del(a_flight);
+	return NULL;
+}
+
+/*******************************************************************************/
+void zlog_flight_write(zlog_flight_t * a_flight, const char *str, size_t len)
+{
+	uint64_t cursor;
+	size_t data_size = a_flight->head->data_size;
+	size_t pos;
+	size_t n;
+
+	if (len > data_size) {
+		str += len - data_size;
+		len = data_size;
+	}
+
+	/* each writer owns [cursor, cursor + len), a crash in between leaves
+	 * that much of the old bytes, nothing else is lost
+	 */
+	cursor = ATOM_F_ADD(&(a_flight->head->cursor), (uint64_t)len);
+	pos = cursor % data_size;
+	n = data_size - pos;
+	if (n >= len) {
+		memcpy(a_flight->data + pos, str, len);
+	} else {
+		memcpy(a_flight->data + pos, str, n);
+		memcpy(a_flight->data, str + n, len - n);
+	}
+}
+
+/*******************************************************************************/
+static int zlog_flight_copy(int in_fd, off_t offset, size_t len, int out_fd, int *skip)
+{
+	char buf[64 * 1024];
+	ssize_t nread;
+	ssize_t nwrite;
+	char *p;
+	char *q;
+
+	while (len > 0) {
+		nread = pread(in_fd, buf, len < sizeof(buf) ? len : sizeof(buf), offset);
+		if (nread < 0) {
+			if (errno == EINTR) continue;
+			zc_error("pread fail, errno[%d]", errno);
+			return -1;
+		}
+		if (nread == 0) {
+			zc_error("flight file is cut short");
+			return -1;
+		}
+		offset += nread;
+		len -= nread;
+
+		p = buf;
+		if (*skip) {
+			q = memchr(buf, '\n', nread);
+			if (!q) continue;
+			*skip = 0;
+			p = q + 1;
+		}
+		for (; p < buf + nread; p += nwrite) {
+			nwrite = write(out_fd, p, buf + nread - p);
+			if (nwrite < 0) {
+				if (errno == EINTR) {
+					nwrite = 0;
+					continue;
+				}
+				zc_error("write fail, errno[%d]", errno);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+int zlog_flight_dump_fd(int in_fd, int out_fd)
+{
+	zlog_flight_head_t head;
+	uint64_t pos;
+	int skip = 0;
+
+	if (pread(in_fd, &head, sizeof(head), 0) != sizeof(head)
+		|| memcmp(head.magic, ZLOG_FLIGHT_MAGIC, sizeof(head.magic))) {
+		return 1;
+	}
+	if (head.data_size == 0) {
+		zc_error("flight data size is 0");
+		return -1;
+	}
+
+	if (head.cursor <= head.data_size) {
+		return zlog_flight_copy(in_fd, head.head_size, head.cursor, out_fd, &skip);
+	}
+
+	/* oldest first, the record torn by the wrap is left out */
+	pos = head.cursor % head.data_size;
+	skip = 1;
+	if (zlog_flight_copy(in_fd, head.head_size + pos, head.data_size - pos, out_fd, &skip)
+		|| zlog_flight_copy(in_fd, head.head_size, pos, out_fd, &skip)) {
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_flight_h
+#define __zlog_flight_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "zc_defs.h"
+
+/* a flight file is one page of head, then data_size bytes of ring
+ * records are copied to data[cursor % data_size], cursor only grows,
+ * so data[0, cursor) is all when cursor <= data_size, or else the ring
+ * starts at cursor % data_size, in the middle of a record
+ * the file is mapped shared, what is copied is kept by the kernel
+ * when the process dies, numbers are in host byte order
+ */
+#define ZLOG_FLIGHT_MAGIC	"zlogfly1"
+#define ZLOG_FLIGHT_HEAD_SIZE	4096
+#define ZLOG_FLIGHT_DEFAULT_SIZE	(64 * 1024 * 1024)
+
+typedef struct zlog_flight_head_s {
+	char magic[8];
+	uint32_t head_size;
+	uint32_t reserved;
+	uint64_t data_size;
+	volatile uint64_t cursor;	/* bytes ever written */
+} zlog_flight_head_t;
+
+typedef struct zlog_flight_s {
+	char name[MAXLEN_PATH + 1];
+	size_t map_size;
+	zlog_flight_head_t *head;
+	char *data;
+} zlog_flight_t;
+
+/* map path, a flight file of the same size goes on at its cursor,
+ * anything else is made over as an empty ring of data_size
+ */
+zlog_flight_t *zlog_flight_new(const char *path, size_t data_size, unsigned int perms);
+void zlog_flight_del(zlog_flight_t * a_flight);
+void zlog_flight_profile(zlog_flight_t * a_flight, int flag);
+
+/* memcpy only, safe with other threads and processes on the same file */
+void zlog_flight_write(zlog_flight_t * a_flight, const char *str, size_t len);
+
+/* write the ring of in_fd in order to out_fd, a leading part record is cut
+ * return 0 on success, -1 on fail, 1 when in_fd is not a flight file
+ */
+int zlog_flight_dump_fd(int in_fd, int out_fd);
+
+#endif
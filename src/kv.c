@@ -0,0 +1,139 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "kv.h"
+#include "zc_defs.h"
+
+/* numbers, bools and nulls are the same in logfmt and json, but for
+ * a double which is not finite, null in json
+ */
+static int zlog_kv_write_scalar(zlog_buf_t * a_buf, const zlog_field_t * a_field, int json)
+{
+	int rc;
+	int n;
+	char tmp[32];
+
+	switch (a_field->type) {
+	case ZLOG_FIELD_INT:
+		if (a_field->v.i < 0) {
+			rc = zlog_buf_append(a_buf, "-", 1);
+			if (rc) return rc;
+			return zlog_buf_printf_dec64(a_buf, (uint64_t)0 - (uint64_t)a_field->v.i, 0);
+		}
+		return zlog_buf_printf_dec64(a_buf, (uint64_t)a_field->v.i, 0);
+	case ZLOG_FIELD_UINT:
+		return zlog_buf_printf_dec64(a_buf, (uint64_t)a_field->v.u, 0);
+	case ZLOG_FIELD_DOUBLE:
+		if (json && !isfinite(a_field->v.d)) {
+			return zlog_buf_append(a_buf, "null", 4);
+		}
+		n = snprintf(tmp, sizeof(tmp), "%.15g", a_field->v.d);
+		return zlog_buf_append(a_buf, tmp, n);
+	case ZLOG_FIELD_BOOL:
+		return a_field->v.i ? zlog_buf_append(a_buf, "true", 4)
+			: zlog_buf_append(a_buf, "false", 5);
+	default:
+		zc_error("type[%d] of field[%s] is unknown", a_field->type, a_field->key);
+		return zlog_buf_append(a_buf, "null", 4);
+	}
+}
+
+/* a str as it is while it is one word, else quoted and escaped as json */
+static int zlog_kv_write_logfmt_value(zlog_buf_t * a_buf, const zlog_field_t * a_field)
+{
+	int rc;
+	size_t i;
+	size_t len;
+	unsigned char c;
+	const char *s;
+
+	if (a_field->type != ZLOG_FIELD_STR) return zlog_kv_write_scalar(a_buf, a_field, 0);
+
+	s = a_field->v.s;
+	if (!s) return zlog_buf_append(a_buf, "(null)", sizeof("(null)") - 1);
+	len = strlen(s);
+
+	for (i = 0; i < len; i++) {
+		c = (unsigned char)s[i];
+		if (c <= ' ' || c == '"' || c == '=' || c == '\\') break;
+	}
+	if (len && i == len) return zlog_buf_append(a_buf, s, len);
+
+	rc = zlog_buf_append(a_buf, "\"", 1);
+	if (rc) return rc;
+	rc = zlog_buf_append_json(a_buf, s, len);
+	if (rc) return rc;
+	return zlog_buf_append(a_buf, "\"", 1);
+}
+
+int zlog_kv_write_logfmt(zlog_buf_t * a_buf, const zlog_field_t * fields, size_t count)
+{
+	int rc;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (i) {
+			rc = zlog_buf_append(a_buf, " ", 1);
+			if (rc) return rc;
+		}
+		rc = zlog_buf_append(a_buf, fields[i].key, strlen(fields[i].key));
+		if (rc) return rc;
+		rc = zlog_buf_append(a_buf, "=", 1);
+		if (rc) return rc;
+		rc = zlog_kv_write_logfmt_value(a_buf, &fields[i]);
+		if (rc) return rc;
+	}
+	return 0;
+}
+
+int zlog_kv_write_json(zlog_buf_t * a_buf, const zlog_field_t * fields, size_t count)
+{
+	int rc;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		rc = zlog_buf_append(a_buf, ",\"", 2);
+		if (rc) return rc;
+		rc = zlog_buf_append_json(a_buf, fields[i].key, strlen(fields[i].key));
+		if (rc) return rc;
+		rc = zlog_buf_append(a_buf, "\":", 2);
+		if (rc) return rc;
+
+		if (fields[i].type != ZLOG_FIELD_STR) {
+			rc = zlog_kv_write_scalar(a_buf, &fields[i], 1);
+		} else if (!fields[i].v.s) {
+			rc = zlog_buf_append(a_buf, "null", 4);
+		} else {
+			rc = zlog_buf_append(a_buf, "\"", 1);
+			if (rc) return rc;
+			rc = zlog_buf_append_json(a_buf, fields[i].v.s, strlen(fields[i].v.s));
+			if (rc) return rc;
+			rc = zlog_buf_append(a_buf, "\"", 1);
+		}
+		if (rc) return rc;
+	}
+	return 0;
+}
+
+int zlog_kv_write_value(zlog_buf_t * a_buf, const zlog_field_t * fields, size_t count,
+		const char *key)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (STRCMP(fields[i].key, ==, key)) {
+			return zlog_kv_write_logfmt_value(a_buf, &fields[i]);
+		}
+	}
+	return 0;
+}
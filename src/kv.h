@@ -0,0 +1,44 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_kv_h
+#define __zlog_kv_h
+
+#include <stddef.h>
+
+#include "buf.h"
+
+/* a typed field of zlog_kv(), the same as in zlog.h */
+typedef enum {
+	ZLOG_FIELD_INT = 1,
+	ZLOG_FIELD_UINT = 2,
+	ZLOG_FIELD_DOUBLE = 3,
+	ZLOG_FIELD_STR = 4,
+	ZLOG_FIELD_BOOL = 5
+} zlog_field_type;
+
+typedef struct zlog_field_s {
+	const char *key;
+	int type;
+	union {
+		long long i;
+		unsigned long long u;
+		double d;
+		const char *s;
+	} v;
+} zlog_field_t;
+
+/* key=value key="a b" ..., as logfmt, quoted when the value needs it */
+int zlog_kv_write_logfmt(zlog_buf_t * a_buf, const zlog_field_t * fields, size_t count);
+/* ,"key":value for each field, the rest of a json object */
+int zlog_kv_write_json(zlog_buf_t * a_buf, const zlog_field_t * fields, size_t count);
+/* the value of the first field of key as logfmt has it, nothing if none */
+int zlog_kv_write_value(zlog_buf_t * a_buf, const zlog_field_t * fields, size_t count,
+		const char *key);
+
+#endif
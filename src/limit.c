@@ -0,0 +1,147 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "limit.h"
+#include "zc_defs.h"
+
+void zlog_limit_profile(zlog_limit_t * a_limit, int flag)
+{
+	zc_assert(a_limit,);
+	zc_profile(flag, "--limit[%p][scope:%d][interval:%lluus][tolerance:%lluus][report:%lluus]--",
+		a_limit,
+		a_limit->scope,
+		(unsigned long long)a_limit->interval,
+		(unsigned long long)a_limit->tolerance,
+		(unsigned long long)a_limit->report_period);
+	return;
+}
+
+/*******************************************************************************/
+void zlog_limit_del(zlog_limit_t * a_limit)
+{
+	zc_assert(a_limit,);
+	zc_debug("zlog_limit_del[%p]", a_limit);
+	free(a_limit);
+	return;
+}
+
+zlog_limit_t *zlog_limit_new(char *rate, long burst, int scope, long report_period_ms)
+{
+	char *p;
+	long count;
+	long period_ms;
+	char period[MAXLEN_CFG_NAME + 1];
+	zlog_limit_t *a_limit;
+
+	zc_assert(rate, NULL);
+
+	/* 100/s is 100/1s */
+	count = strtol(rate, &p, 10);
+	if (count <= 0 || *p != '/' || strlen(p + 1) > MAXLEN_CFG_NAME - 1) {
+		zc_error("rate[%s] should be as 100/s", rate);
+		return NULL;
+	}
+	p++;
+	if (*p >= '0' && *p <= '9') {
+		strcpy(period, p);
+	} else {
+		sprintf(period, "1%s", p);
+	}
+	period_ms = zc_parse_duration_ms(period);
+	if (period_ms <= 0) {
+		zc_error("rate[%s] should be as 100/s", rate);
+		return NULL;
+	}
+
+	a_limit = calloc(1, sizeof(zlog_limit_t));
+	if (!a_limit) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+
+	a_limit->scope = scope;
+	a_limit->interval = (uint64_t)period_ms * 1000 / count;
+	if (a_limit->interval == 0) a_limit->interval = 1;
+	if (burst <= 0) {
+		burst = 1000000 / a_limit->interval;
+		if (burst <= 0) burst = 1;
+	}
+	a_limit->tolerance = (uint64_t)(burst - 1) * a_limit->interval;
+	a_limit->report_period = (uint64_t)report_period_ms * 1000;
+
+	zlog_limit_profile(a_limit, ZC_DEBUG);
+	return a_limit;
+}
+
+/*******************************************************************************/
+static zlog_limit_bucket_t *zlog_limit_bucket(zlog_limit_t * a_limit, zlog_event_t * a_event)
+{
+	uintptr_t key;
+
+	switch (a_limit->scope) {
+	case ZLOG_LIMIT_CATEGORY:
+		/* the name is owned by the category, one pointer for each */
+		key = (uintptr_t)a_event->category_name;
+		break;
+	case ZLOG_LIMIT_SITE:
+		/* __FILE__ is a literal, same for all lines of a file */
+		key = (uintptr_t)a_event->file * 31 + (uintptr_t)a_event->line;
+		break;
+	default:
+		return &(a_limit->buckets[0]);
+	}
+
+	key ^= key >> 16;
+	key *= 0x45d9f3b;
+	key ^= key >> 16;
+	return &(a_limit->buckets[key % ZLOG_LIMIT_SLOTS]);
+}
+
+int zlog_limit_take(zlog_limit_t * a_limit, zlog_event_t * a_event, unsigned long *nsuppressed)
+{
+	uint64_t now;
+	uint64_t full_at;
+	uint64_t reported_at;
+	uint64_t base;
+	zlog_limit_bucket_t *a_bucket;
+
+	*nsuppressed = 0;
+	a_bucket = zlog_limit_bucket(a_limit, a_event);
+
+	/* the same time is used by %d and %us later */
+	if (!a_event->time_stamp.tv_sec) {
+		gettimeofday(&(a_event->time_stamp), NULL);
+	}
+	now = (uint64_t)a_event->time_stamp.tv_sec * 1000000 + a_event->time_stamp.tv_usec;
+
+	do {
+		full_at = a_bucket->full_at;
+		base = full_at > now ? full_at : now;
+		if (base - now > a_limit->tolerance) {
+			ATOM_ADD_F(&(a_bucket->nsuppressed), 1);
+			return 0;
+		}
+	} while (!ATOM_CASB(&(a_bucket->full_at), full_at, base + a_limit->interval));
+
+	/* one of the passing threads takes the count to report */
+	if (a_limit->report_period && a_bucket->nsuppressed) {
+		reported_at = a_bucket->reported_at;
+		if (now - reported_at >= a_limit->report_period
+			&& ATOM_CASB(&(a_bucket->reported_at), reported_at, now)) {
+			*nsuppressed = ATOM_SET(&(a_bucket->nsuppressed), 0);
+		}
+	}
+	return 1;
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_limit_h
+#define __zlog_limit_h
+
+#include <stdint.h>
+
+#include "event.h"
+
+/* what records share a bucket */
+#define ZLOG_LIMIT_RULE		0	/* all of the rule */
+#define ZLOG_LIMIT_CATEGORY	1	/* each category the rule matches */
+#define ZLOG_LIMIT_SITE		2	/* each file and line */
+
+/* keys are hashed to slots, two keys in one slot share its bucket */
+#define ZLOG_LIMIT_SLOTS	256
+
+/* a bucket is one word, the time when it is full again (the theoretical
+ * arrival time of cell rate), a record takes interval from it, and is
+ * dropped when that goes further than tolerance ahead of now, so bursts
+ * of up to burst records and rate on average pass, with one cas only
+ */
+typedef struct zlog_limit_bucket_s {
+	volatile uint64_t full_at;		/* us */
+	volatile unsigned long nsuppressed;	/* since last report */
+	volatile uint64_t reported_at;		/* us */
+} zlog_limit_bucket_t;
+
+typedef struct zlog_limit_s {
+	int scope;
+	uint64_t interval;		/* us for one record */
+	uint64_t tolerance;		/* us, (burst - 1) * interval */
+	uint64_t report_period;		/* us, 0 no report */
+	zlog_limit_bucket_t buckets[ZLOG_LIMIT_SLOTS];
+} zlog_limit_t;
+
+/* rate is [100/s], [5/m] or [1000/10s], burst 0 is a second of rate */
+zlog_limit_t *zlog_limit_new(char *rate, long burst, int scope, long report_period_ms);
+void zlog_limit_del(zlog_limit_t * a_limit);
+void zlog_limit_profile(zlog_limit_t * a_limit, int flag);
+
+/* return 1 when the record of a_event may go, 0 when it is dropped
+ * *nsuppressed is the count dropped before it, when it is time to report them
+ */
+int zlog_limit_take(zlog_limit_t * a_limit, zlog_event_t * a_event, unsigned long *nsuppressed);
+
+#endif
@@ -8,58 +8,107 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "mdc.h"
 #include "zc_defs.h"
 
+#define ZLOG_MDC_MAX_KEYS	1024
+#define ZLOG_MDC_KEY_SLOTS	(ZLOG_MDC_MAX_KEYS * 2)	/* a power of 2 */
+/* keys of all threads, a slot is 0 or id + 1, set once under the mutex
+ * and read without it
+ */
+static char *zlog_mdc_keys[ZLOG_MDC_MAX_KEYS];
+static volatile int zlog_mdc_key_slots[ZLOG_MDC_KEY_SLOTS];
+static int zlog_mdc_nkeys;
+static pthread_mutex_t zlog_mdc_key_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* return id of key, -1 when it was never interned */
+static int zlog_mdc_key_find(const char *key, unsigned int *slot)
+{
+	int id;
+	unsigned int i;
+
+	i = zc_hashtable_str_hash(key) & (ZLOG_MDC_KEY_SLOTS - 1);
+	while ((id = zlog_mdc_key_slots[i])) {
+		zc_barrier();
+		if (STRCMP(zlog_mdc_keys[id - 1], ==, key)) return id - 1;
+		i = (i + 1) & (ZLOG_MDC_KEY_SLOTS - 1);
+	}
+	if (slot) *slot = i;
+	return -1;
+}
+
+int zlog_mdc_key_intern(const char *key)
+{
+	int id;
+	unsigned int slot;
+
+	id = zlog_mdc_key_find(key, NULL);
+	if (id >= 0) return id;
+
+	pthread_mutex_lock(&zlog_mdc_key_mutex);
+	id = zlog_mdc_key_find(key, &slot);
+	if (id < 0) {
+		if (zlog_mdc_nkeys == ZLOG_MDC_MAX_KEYS) {
+			zc_debug("more than [%d] mdc keys, key[%s] is an extra", ZLOG_MDC_MAX_KEYS, key);
+		} else if (!(zlog_mdc_keys[zlog_mdc_nkeys] = zc_strdup(key))) {
+			zc_error("zc_strdup fail, errno[%d]", errno);
+		} else {
+			id = zlog_mdc_nkeys++;
+			zc_barrier();
+			zlog_mdc_key_slots[slot] = id + 1;
+		}
+	}
+	pthread_mutex_unlock(&zlog_mdc_key_mutex);
+	return id;
+}
+
+/*******************************************************************************/
 void zlog_mdc_profile(zlog_mdc_t *a_mdc, int flag)
 {
-	zc_hashtable_entry_t *a_entry;
-	zlog_mdc_kv_t *a_mdc_kv;
+	int i;
 
 	zc_assert(a_mdc,);
-	zc_profile(flag, "---mdc[%p]---", a_mdc);
+	zc_profile(flag, "---mdc[%p][kvs:%d,extras:%d][snap:%p,%d][pushed:%d]---", a_mdc,
+		a_mdc->nkvs, a_mdc->nextras, a_mdc->snap, a_mdc->borrowed, a_mdc->nstack);
 
-	zc_hashtable_foreach(a_mdc->tab, a_entry) {
-		a_mdc_kv = a_entry->value;
+	for (i = 0; i < a_mdc->nkvs; i++) {
+		if (!a_mdc->kvs[i] || !a_mdc->kvs[i]->value) continue;
 		zc_profile(flag, "----mdc_kv[%p][%s]-[%s]----",
-				a_mdc_kv,
-				a_mdc_kv->key, a_mdc_kv->value);
+				a_mdc->kvs[i],
+				a_mdc->kvs[i]->key, a_mdc->kvs[i]->value);
+	}
+	for (i = 0; i < a_mdc->nextras; i++) {
+		zc_profile(flag, "----mdc_kv[%p][%s]-[%s]----extra",
+				a_mdc->extras[i],
+				a_mdc->extras[i]->key, a_mdc->extras[i]->value);
 	}
 	return;
 }
 /*******************************************************************************/
 void zlog_mdc_del(zlog_mdc_t * a_mdc)
 {
+	int i;
+
 	zc_assert(a_mdc,);
-	if (a_mdc->tab) zc_hashtable_del(a_mdc->tab);
+	zlog_mdc_clean(a_mdc);
+	for (i = 0; i < a_mdc->nstack; i++) {
+		zlog_mdc_snap_release(a_mdc->stack[i]);
+	}
+	for (i = 0; i < a_mdc->nkvs; i++) {
+		free(a_mdc->kvs[i]);
+	}
+	free(a_mdc->stack);
+	free(a_mdc->kvs);
+	free(a_mdc->extras);
 	free(a_mdc);
 	zc_debug("zlog_mdc_del[%p]", a_mdc);
 	return;
 }
 
-static void zlog_mdc_kv_del(zlog_mdc_kv_t * a_mdc_kv)
-{
-	free(a_mdc_kv);
-	zc_debug("zlog_mdc_kv_del[%p]", a_mdc_kv);
-}
-
-static zlog_mdc_kv_t *zlog_mdc_kv_new(const char *key, const char *value)
-{
-	zlog_mdc_kv_t *a_mdc_kv;
-
-	a_mdc_kv = calloc(1, sizeof(zlog_mdc_kv_t));
-	if (!a_mdc_kv) {
-		zc_error("calloc fail, errno[%d]", errno);
-		return NULL;
-	}
-
-	snprintf(a_mdc_kv->key, sizeof(a_mdc_kv->key), "%s", key);
-	a_mdc_kv->value_len = snprintf(a_mdc_kv->value, sizeof(a_mdc_kv->value), "%s", value);
-	return a_mdc_kv;
-}
-
 zlog_mdc_t *zlog_mdc_new(void)
 {
 	zlog_mdc_t *a_mdc;
@@ -70,76 +119,387 @@ zlog_mdc_t *zlog_mdc_new(void)
 		return NULL;
 	}
 
-	a_mdc->tab = zc_hashtable_new(20,
-			      zc_hashtable_str_hash,
-			      zc_hashtable_str_equal, NULL,
-			      (zc_hashtable_del_fn) zlog_mdc_kv_del);
-	if (!a_mdc->tab) {
-		zc_error("zc_hashtable_new fail");
-		goto err;
-	}
-
 	//zlog_mdc_profile(a_mdc, ZC_DEBUG);
 	return a_mdc;
-err:
-	zlog_mdc_del(a_mdc);
-	return NULL;
 }
 
 /*******************************************************************************/
-int zlog_mdc_put(zlog_mdc_t * a_mdc, const char *key, const char *value)
+/* a slot for each key id so far */
+static int zlog_mdc_fit_kvs(zlog_mdc_t * a_mdc, int id)
 {
-	zlog_mdc_kv_t *a_mdc_kv;
+	int n;
+	zlog_mdc_kv_t **kvs;
 
-	a_mdc_kv = zlog_mdc_kv_new(key, value);
-	if (!a_mdc_kv) {
-		zc_error("zlog_mdc_kv_new failed");
+	if (id < a_mdc->nkvs) return 0;
+
+	n = a_mdc->nkvs ? a_mdc->nkvs : 8;
+	while (n <= id) n *= 2;
+	kvs = realloc(a_mdc->kvs, n * sizeof(zlog_mdc_kv_t *));
+	if (!kvs) {
+		zc_error("realloc fail, errno[%d]", errno);
 		return -1;
 	}
+	memset(kvs + a_mdc->nkvs, 0, (n - a_mdc->nkvs) * sizeof(zlog_mdc_kv_t *));
+	a_mdc->kvs = kvs;
+	a_mdc->nkvs = n;
+	return 0;
+}
 
-	if (zc_hashtable_put(a_mdc->tab, a_mdc_kv->key, a_mdc_kv)) {
-		zc_error("zc_hashtable_put fail");
-		zlog_mdc_kv_del(a_mdc_kv);
+static void zlog_mdc_kv_set(zlog_mdc_kv_t * a_kv, const char *value, size_t len)
+{
+	memcpy(a_kv->buf, value, len);
+	a_kv->buf[len] = '\0';
+	a_kv->value = a_kv->buf;
+	a_kv->value_len = len;
+}
+
+static int zlog_mdc_put_id(zlog_mdc_t * a_mdc, int id, const char *value, size_t len)
+{
+	if (zlog_mdc_fit_kvs(a_mdc, id)) {
+		zc_error("zlog_mdc_fit_kvs fail");
 		return -1;
 	}
+	if (!a_mdc->kvs[id]) {
+		a_mdc->kvs[id] = calloc(1, sizeof(zlog_mdc_kv_t));
+		if (!a_mdc->kvs[id]) {
+			zc_error("calloc fail, errno[%d]", errno);
+			return -1;
+		}
+		a_mdc->kvs[id]->key = zlog_mdc_keys[id];
+	}
+	zlog_mdc_kv_set(a_mdc->kvs[id], value, len);
+	return 0;
+}
+
+static int zlog_mdc_find_extra(zlog_mdc_t * a_mdc, const char *key)
+{
+	int i;
+
+	for (i = 0; i < a_mdc->nextras; i++) {
+		if (STRCMP(a_mdc->extras[i]->key, ==, key)) return i;
+	}
+	return -1;
+}
+
+static int zlog_mdc_put_extra(zlog_mdc_t * a_mdc, const char *key, const char *value, size_t len)
+{
+	int i;
+	size_t key_len;
+	zlog_mdc_kv_t **extras;
+	zlog_mdc_kv_t *a_kv;
 
+	i = zlog_mdc_find_extra(a_mdc, key);
+	if (i >= 0) {
+		zlog_mdc_kv_set(a_mdc->extras[i], value, len);
+		return 0;
+	}
+
+	if (a_mdc->nextras == a_mdc->extras_size) {
+		i = a_mdc->extras_size ? a_mdc->extras_size * 2 : 8;
+		extras = realloc(a_mdc->extras, i * sizeof(zlog_mdc_kv_t *));
+		if (!extras) {
+			zc_error("realloc fail, errno[%d]", errno);
+			return -1;
+		}
+		a_mdc->extras = extras;
+		a_mdc->extras_size = i;
+	}
+
+	/* the key is after the kv */
+	key_len = strlen(key);
+	a_kv = malloc(sizeof(zlog_mdc_kv_t) + key_len + 1);
+	if (!a_kv) {
+		zc_error("malloc fail, errno[%d]", errno);
+		return -1;
+	}
+	memcpy(a_kv + 1, key, key_len + 1);
+	a_kv->key = (char *)(a_kv + 1);
+	zlog_mdc_kv_set(a_kv, value, len);
+	a_mdc->extras[a_mdc->nextras++] = a_kv;
 	return 0;
 }
 
+/* kv of key, NULL when it is not put */
+static zlog_mdc_kv_t *zlog_mdc_find_kv(zlog_mdc_t * a_mdc, const char *key)
+{
+	int id;
+
+	id = zlog_mdc_key_find(key, NULL);
+	if (id >= 0) return zlog_mdc_get_kv_by_id(a_mdc, id);
+	id = zlog_mdc_find_extra(a_mdc, key);
+	return id >= 0 ? a_mdc->extras[id] : NULL;
+}
+
+static void zlog_mdc_unborrow(zlog_mdc_t * a_mdc)
+{
+	if (!a_mdc->borrowed) return;
+	a_mdc->kvs = a_mdc->own_kvs;
+	a_mdc->nkvs = a_mdc->own_nkvs;
+	a_mdc->extras = a_mdc->own_extras;
+	a_mdc->nextras = a_mdc->own_nextras;
+	a_mdc->borrowed = 0;
+}
+
+/* no values, kvs of ids are kept for the next put */
+static void zlog_mdc_reset(zlog_mdc_t * a_mdc)
+{
+	int i;
+
+	for (i = 0; i < a_mdc->nkvs; i++) {
+		if (!a_mdc->kvs[i]) continue;
+		a_mdc->kvs[i]->value = NULL;
+		a_mdc->kvs[i]->value_len = 0;
+	}
+	for (i = 0; i < a_mdc->nextras; i++) {
+		free(a_mdc->extras[i]);
+	}
+	a_mdc->nextras = 0;
+}
+
+/* values are going to change, so they are not of snap any more */
+static int zlog_mdc_own(zlog_mdc_t * a_mdc)
+{
+	int i;
+	zlog_mdc_snap_t *a_snap;
+
+	a_snap = a_mdc->snap;
+	if (!a_snap) return 0;
+	a_mdc->snap = NULL;
+	if (!a_mdc->borrowed) {
+		zlog_mdc_snap_release(a_snap);
+		return 0;
+	}
+
+	/* values got from a_snap stay till the next clean or use */
+	zlog_mdc_snap_release(a_mdc->copied);
+	a_mdc->copied = a_snap;
+	zlog_mdc_unborrow(a_mdc);
+	zlog_mdc_reset(a_mdc);
+	for (i = 0; i < a_snap->nkvs; i++) {
+		if (!a_snap->kvs[i]) continue;
+		if (zlog_mdc_put_id(a_mdc, i, a_snap->kvs[i]->value, a_snap->kvs[i]->value_len)) {
+			zc_error("zlog_mdc_put_id fail");
+			return -1;
+		}
+	}
+	for (i = 0; i < a_snap->nextras; i++) {
+		if (zlog_mdc_put_extra(a_mdc, a_snap->extras[i]->key,
+				a_snap->extras[i]->value, a_snap->extras[i]->value_len)) {
+			zc_error("zlog_mdc_put_extra fail");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int zlog_mdc_put(zlog_mdc_t * a_mdc, const char *key, const char *value)
+{
+	int id;
+	size_t len;
+
+	if (zlog_mdc_own(a_mdc)) {
+		zc_error("zlog_mdc_own fail");
+		return -1;
+	}
+
+	/* as long as values were before */
+	for (len = 0; len < MAXLEN_CFG_NAME && value[len]; len++);
+
+	id = zlog_mdc_key_intern(key);
+	if (id < 0) return zlog_mdc_put_extra(a_mdc, key, value, len);
+	return zlog_mdc_put_id(a_mdc, id, value, len);
+}
+
 void zlog_mdc_clean(zlog_mdc_t * a_mdc)
 {
-	zc_hashtable_clean(a_mdc->tab);
+	zlog_mdc_snap_release(a_mdc->snap);
+	a_mdc->snap = NULL;
+	zlog_mdc_snap_release(a_mdc->copied);
+	a_mdc->copied = NULL;
+	zlog_mdc_unborrow(a_mdc);
+	zlog_mdc_reset(a_mdc);
 	return;
 }
 
-char *zlog_mdc_get(zlog_mdc_t * a_mdc, const char *key)
+zlog_mdc_kv_t *zlog_mdc_get_kv(zlog_mdc_t * a_mdc, const char *key)
 {
 	zlog_mdc_kv_t *a_mdc_kv;
 
-	a_mdc_kv = zc_hashtable_get(a_mdc->tab, key);
+	a_mdc_kv = zlog_mdc_find_kv(a_mdc, key);
 	if (!a_mdc_kv) {
-		zc_error("zc_hashtable_get fail");
+		zc_error("mdc key[%s] is not put", key);
 		return NULL;
-	} else {
-		return a_mdc_kv->value;
 	}
+	return a_mdc_kv;
 }
 
-zlog_mdc_kv_t *zlog_mdc_get_kv(zlog_mdc_t * a_mdc, const char *key)
+char *zlog_mdc_get(zlog_mdc_t * a_mdc, const char *key)
 {
 	zlog_mdc_kv_t *a_mdc_kv;
 
-	a_mdc_kv = zc_hashtable_get(a_mdc->tab, key);
-	if (!a_mdc_kv) {
-		zc_error("zc_hashtable_get fail");
+	a_mdc_kv = zlog_mdc_get_kv(a_mdc, key);
+	return a_mdc_kv ? a_mdc_kv->value : NULL;
+}
+
+void zlog_mdc_remove(zlog_mdc_t * a_mdc, const char *key)
+{
+	int i;
+	zlog_mdc_kv_t *a_mdc_kv;
+
+	if (!zlog_mdc_find_kv(a_mdc, key)) return;
+	if (zlog_mdc_own(a_mdc)) {
+		zc_error("zlog_mdc_own fail");
+		return;
+	}
+
+	a_mdc_kv = zlog_mdc_find_kv(a_mdc, key);
+	if (!a_mdc_kv) return;
+	i = zlog_mdc_find_extra(a_mdc, key);
+	if (i < 0) {
+		a_mdc_kv->value = NULL;
+		a_mdc_kv->value_len = 0;
+		return;
+	}
+	free(a_mdc_kv);
+	memmove(a_mdc->extras + i, a_mdc->extras + i + 1,
+		(a_mdc->nextras - i - 1) * sizeof(zlog_mdc_kv_t *));
+	a_mdc->nextras--;
+	return;
+}
+
+/*******************************************************************************/
+zlog_mdc_snap_t *zlog_mdc_snap(zlog_mdc_t * a_mdc)
+{
+	int i;
+	int n;
+	int nlive;
+	size_t size;
+	char *p;
+	zlog_mdc_kv_t *a_kv;
+	zlog_mdc_snap_t *a_snap;
+
+	if (a_mdc->snap) {
+		ATOM_ADD_F(&(a_mdc->snap->refs), 1);
+		return a_mdc->snap;
+	}
+
+	for (i = n = nlive = 0, size = 0; i < a_mdc->nkvs; i++) {
+		if (!a_mdc->kvs[i] || !a_mdc->kvs[i]->value) continue;
+		n = i + 1;
+		nlive++;
+	}
+	for (i = 0; i < a_mdc->nextras; i++) {
+		size += strlen(a_mdc->extras[i]->key) + 1;
+	}
+
+	/* head, kvs, extras, kv of each, keys of extras */
+	a_snap = malloc(sizeof(zlog_mdc_snap_t)
+		+ (n + a_mdc->nextras) * sizeof(zlog_mdc_kv_t *)
+		+ (nlive + a_mdc->nextras) * sizeof(zlog_mdc_kv_t) + size);
+	if (!a_snap) {
+		zc_error("malloc fail, errno[%d]", errno);
 		return NULL;
-	} else {
-		return a_mdc_kv;
 	}
+	a_snap->refs = 2;		/* of the caller and of the mdc */
+	a_snap->nkvs = n;
+	a_snap->kvs = (zlog_mdc_kv_t **)(a_snap + 1);
+	a_snap->nextras = a_mdc->nextras;
+	a_snap->extras = a_snap->kvs + n;
+
+	a_kv = (zlog_mdc_kv_t *)(a_snap->extras + a_snap->nextras);
+	p = (char *)(a_kv + nlive + a_snap->nextras);
+	for (i = 0; i < n; i++) {
+		if (!a_mdc->kvs[i] || !a_mdc->kvs[i]->value) {
+			a_snap->kvs[i] = NULL;
+			continue;
+		}
+		*a_kv = *(a_mdc->kvs[i]);
+		a_kv->value = a_kv->buf;
+		a_snap->kvs[i] = a_kv++;
+	}
+	for (i = 0; i < a_snap->nextras; i++) {
+		*a_kv = *(a_mdc->extras[i]);
+		a_kv->value = a_kv->buf;
+		size = strlen(a_kv->key) + 1;
+		memcpy(p, a_kv->key, size);
+		a_kv->key = p;
+		p += size;
+		a_snap->extras[i] = a_kv++;
+	}
+	a_mdc->snap = a_snap;
+	return a_snap;
 }
 
-void zlog_mdc_remove(zlog_mdc_t * a_mdc, const char *key)
+void zlog_mdc_use(zlog_mdc_t * a_mdc, zlog_mdc_snap_t * a_snap)
+{
+	if (a_snap == a_mdc->snap) return;
+	if (!a_snap) {
+		zlog_mdc_clean(a_mdc);
+		return;
+	}
+
+	ATOM_ADD_F(&(a_snap->refs), 1);
+	zlog_mdc_snap_release(a_mdc->snap);
+	zlog_mdc_snap_release(a_mdc->copied);
+	a_mdc->copied = NULL;
+	if (!a_mdc->borrowed) {
+		a_mdc->own_kvs = a_mdc->kvs;
+		a_mdc->own_nkvs = a_mdc->nkvs;
+		a_mdc->own_extras = a_mdc->extras;
+		a_mdc->own_nextras = a_mdc->nextras;
+		a_mdc->borrowed = 1;
+	}
+	a_mdc->snap = a_snap;
+	a_mdc->kvs = a_snap->kvs;
+	a_mdc->nkvs = a_snap->nkvs;
+	a_mdc->extras = a_snap->extras;
+	a_mdc->nextras = a_snap->nextras;
+	return;
+}
+
+void zlog_mdc_snap_release(zlog_mdc_snap_t * a_snap)
 {
-	zc_hashtable_remove(a_mdc->tab, key);
+	if (!a_snap) return;
+	if (ATOM_SUB_F(&(a_snap->refs), 1) == 0) free(a_snap);
 	return;
 }
+
+int zlog_mdc_push_snap(zlog_mdc_t * a_mdc)
+{
+	int n;
+	zlog_mdc_snap_t **stack;
+	zlog_mdc_snap_t *a_snap;
+
+	if (a_mdc->nstack == a_mdc->stack_size) {
+		n = a_mdc->stack_size ? a_mdc->stack_size * 2 : 8;
+		stack = realloc(a_mdc->stack, n * sizeof(zlog_mdc_snap_t *));
+		if (!stack) {
+			zc_error("realloc fail, errno[%d]", errno);
+			return -1;
+		}
+		a_mdc->stack = stack;
+		a_mdc->stack_size = n;
+	}
+
+	a_snap = zlog_mdc_snap(a_mdc);
+	if (!a_snap) {
+		zc_error("zlog_mdc_snap fail");
+		return -1;
+	}
+	a_mdc->stack[a_mdc->nstack++] = a_snap;
+	return 0;
+}
+
+int zlog_mdc_pop_snap(zlog_mdc_t * a_mdc)
+{
+	zlog_mdc_snap_t *a_snap;
+
+	if (a_mdc->nstack == 0) {
+		zc_error("no mdc was pushed");
+		return -1;
+	}
+	a_snap = a_mdc->stack[--a_mdc->nstack];
+	zlog_mdc_use(a_mdc, a_snap);
+	zlog_mdc_snap_release(a_snap);
+	return 0;
+}
@@ -11,9 +11,56 @@
 
 #include "zc_defs.h"
 
+/* a key is interned once for the process as a small id, an mdc of a
+ * thread is an array by that id, a kv is malloced on the first put of its
+ * key in the thread and keeps the value in it, so put, get and remove look
+ * at one slot, do not malloc and do not move values of other keys
+ */
+typedef struct zlog_mdc_kv_s {
+	const char *key;		/* interned, never freed, or of an extra kv */
+	char *value;			/* buf, NULL when not put */
+	size_t value_len;
+	char buf[MAXLEN_CFG_NAME + 1];
+} zlog_mdc_kv_t;
+
+/* values of an mdc at one time, read only, shared by threads and freed
+ * when the last ref is released, all is in the same block
+ */
+typedef struct zlog_mdc_snap_s zlog_mdc_snap_t;
+struct zlog_mdc_snap_s {
+	int refs;
+	int nkvs;
+	zlog_mdc_kv_t **kvs;
+	int nextras;
+	zlog_mdc_kv_t **extras;
+};
+
 typedef struct zlog_mdc_s zlog_mdc_t;
 struct zlog_mdc_s {
-	zc_hashtable_t *tab;
+	zlog_mdc_kv_t **kvs;		/* by key id, of snap when borrowed */
+	int nkvs;
+	/* keys put after all ids are taken, the key is in the kv and
+	 * found by name, it is freed on remove
+	 */
+	zlog_mdc_kv_t **extras;
+	int nextras;
+
+	/* the mdc has the values of snap, and reads them from it when
+	 * borrowed, the first put or remove copies them back to own_kvs,
+	 * and keeps snap as copied, so values got before stay
+	 */
+	zlog_mdc_snap_t *snap;
+	int borrowed;
+	zlog_mdc_kv_t **own_kvs;	/* kvs of the mdc while borrowed */
+	int own_nkvs;
+	zlog_mdc_kv_t **own_extras;
+	int own_nextras;
+	int extras_size;
+	zlog_mdc_snap_t *copied;
+
+	zlog_mdc_snap_t **stack;	/* of zlog_mdc_push_snap */
+	int nstack;
+	int stack_size;
 };
 
 zlog_mdc_t *zlog_mdc_new(void);
@@ -22,15 +69,35 @@ void zlog_mdc_profile(zlog_mdc_t *a_mdc, int flag);
 
 void zlog_mdc_clean(zlog_mdc_t * a_mdc);
 int zlog_mdc_put(zlog_mdc_t * a_mdc, const char *key, const char *value);
+/* a value stays until its key is put again or removed, or the mdc is
+ * cleaned or restored
+ */
 char *zlog_mdc_get(zlog_mdc_t * a_mdc, const char *key);
 void zlog_mdc_remove(zlog_mdc_t * a_mdc, const char *key);
 
-typedef struct zlog_mdc_kv_s {
-	char key[MAXLEN_CFG_NAME + 1];
-	char value[MAXLEN_CFG_NAME + 1];
-	size_t value_len;
-} zlog_mdc_kv_t;
-
 zlog_mdc_kv_t *zlog_mdc_get_kv(zlog_mdc_t * a_mdc, const char *key);
 
+/* snap of the values now, O(1) when none was put or removed since the
+ * last one, ref is taken for the caller
+ */
+zlog_mdc_snap_t *zlog_mdc_snap(zlog_mdc_t * a_mdc);
+/* the mdc has the values of a_snap, O(1), NULL cleans it */
+void zlog_mdc_use(zlog_mdc_t * a_mdc, zlog_mdc_snap_t * a_snap);
+void zlog_mdc_snap_release(zlog_mdc_snap_t * a_snap);
+
+/* pop gives back the values the mdc had at push */
+int zlog_mdc_push_snap(zlog_mdc_t * a_mdc);
+int zlog_mdc_pop_snap(zlog_mdc_t * a_mdc);
+
+/* id of key for all threads, from now until the process exits, so specs
+ * take it once and it stays the same over zlog_reload, -1 when all ids
+ * are taken, then the key is put as an extra of the thread
+ */
+int zlog_mdc_key_intern(const char *key);
+
+/* the kv of an id, NULL when the thread has not put it */
+#define zlog_mdc_get_kv_by_id(a_mdc, id) \
+	((id) >= 0 && (id) < (a_mdc)->nkvs && (a_mdc)->kvs[id] && (a_mdc)->kvs[id]->value \
+		? (a_mdc)->kvs[id] : NULL)
+
 #endif
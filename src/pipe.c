@@ -0,0 +1,424 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+
+#include "pipe.h"
+#include "crash.h"
+#include "zc_defs.h"
+
+/* linux only, not in fcntl.h without _GNU_SOURCE */
+#if defined(__linux__) && !defined(F_SETPIPE_SZ)
+#define F_SETPIPE_SZ 1031
+#endif
+
+void zlog_pipe_profile(zlog_pipe_t * a_pipe, int flag)
+{
+	zc_assert(a_pipe,);
+	zc_profile(flag, "--pipe[%p][fd:%d][full:%d][%s][buf:%ld/%ld][dropped:%lu][spilled:%lu]--",
+		a_pipe,
+		a_pipe->fd,
+		a_pipe->full,
+		a_pipe->spill_path,
+		(long)a_pipe->len,
+		(long)a_pipe->size,
+		a_pipe->ndropped,
+		a_pipe->nspilled);
+	return;
+}
+
+/*******************************************************************************/
+/* return bytes the pipe took now, 0 when it is full, -1 on fail */
+static ssize_t zlog_pipe_try(int fd, const char *str, size_t len)
+{
+	ssize_t nwrite;
+
+	do {
+		nwrite = write(fd, str, len);
+	} while (nwrite < 0 && errno == EINTR);
+
+	if (nwrite < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+	return nwrite;
+}
+
+/* return 1 when fd can be written, 0 on timeout */
+static int zlog_pipe_poll(int fd, int timeout_ms)
+{
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = POLLOUT;
+	pfd.revents = 0;
+	return poll(&pfd, 1, timeout_ms) != 0;
+}
+
+/* wait as a blocking fd would */
+static int zlog_pipe_write_all(int fd, const char *str, size_t len)
+{
+	ssize_t nwrite;
+
+	while (len > 0) {
+		nwrite = zlog_pipe_try(fd, str, len);
+		if (nwrite < 0) {
+			zc_error("write fail, errno[%d]", errno);
+			return -1;
+		}
+		if (nwrite == 0) {
+			zlog_pipe_poll(fd, -1);
+			continue;
+		}
+		str += nwrite;
+		len -= nwrite;
+	}
+	return 0;
+}
+
+/* called with lock_mutex held, room is checked */
+static void zlog_pipe_put(zlog_pipe_t * a_pipe, const char *str, size_t len)
+{
+	size_t tail = (a_pipe->head + a_pipe->len) % a_pipe->size;
+	size_t n = a_pipe->size - tail;
+
+	if (n >= len) {
+		memcpy(a_pipe->buf + tail, str, len);
+	} else {
+		memcpy(a_pipe->buf + tail, str, n);
+		memcpy(a_pipe->buf, str + n, len - n);
+	}
+	a_pipe->len += len;
+}
+
+/* called with lock_mutex held, when all before is written */
+static void zlog_pipe_report(zlog_pipe_t * a_pipe)
+{
+	int len;
+	char line[MAXLEN_PATH + 64];
+
+	if (a_pipe->ndropped != a_pipe->nreported) {
+		len = snprintf(line, sizeof(line), "zlog: %lu records dropped, pipe was full\n",
+			a_pipe->ndropped - a_pipe->nreported);
+		a_pipe->nreported = a_pipe->ndropped;
+		zlog_pipe_put(a_pipe, line, len);
+	}
+}
+
+/*******************************************************************************/
+static void *zlog_pipe_drain(void *arg)
+{
+	zlog_pipe_t *a_pipe = arg;
+	ssize_t nwrite;
+	size_t chunk;
+
+	pthread_mutex_lock(&(a_pipe->lock_mutex));
+	for (;;) {
+		while (!a_pipe->len && !a_pipe->stopping) {
+			pthread_cond_wait(&(a_pipe->cond), &(a_pipe->lock_mutex));
+		}
+		if (!a_pipe->len) break;
+
+		/* writers only add after head + len, so this part stays */
+		chunk = a_pipe->size - a_pipe->head;
+		if (chunk > a_pipe->len) chunk = a_pipe->len;
+		pthread_mutex_unlock(&(a_pipe->lock_mutex));
+
+		/* a crash flush writes it out */
+		if (!ATOM_CASB(&(a_pipe->writing), 0, 1)) {
+			pthread_mutex_lock(&(a_pipe->lock_mutex));
+			break;
+		}
+
+		nwrite = zlog_pipe_try(a_pipe->fd, a_pipe->buf + a_pipe->head, chunk);
+		if (nwrite == 0) {
+			ATOM_CASB(&(a_pipe->writing), 1, 0);
+			if (!zlog_pipe_poll(a_pipe->fd, ZLOG_PIPE_STALL_MS)) {
+				pthread_mutex_lock(&(a_pipe->lock_mutex));
+				if (a_pipe->stopping) {
+					zc_error("pipe is stalled, [%ld] bytes lost", (long)a_pipe->len);
+					break;
+				}
+				continue;
+			}
+			pthread_mutex_lock(&(a_pipe->lock_mutex));
+			continue;
+		}
+
+		pthread_mutex_lock(&(a_pipe->lock_mutex));
+		if (nwrite < 0) {
+			/* the reader is gone, nothing will be taken any more */
+			zc_error("write fail, errno[%d], [%ld] bytes lost", errno, (long)a_pipe->len);
+			nwrite = a_pipe->len;
+		}
+		a_pipe->head = (a_pipe->head + nwrite) % a_pipe->size;
+		a_pipe->len -= nwrite;
+		if (!a_pipe->len) zlog_pipe_report(a_pipe);
+		pthread_cond_broadcast(&(a_pipe->cond));
+		ATOM_CASB(&(a_pipe->writing), 1, 0);
+	}
+	pthread_mutex_unlock(&(a_pipe->lock_mutex));
+	return NULL;
+}
+
+int zlog_pipe_write(zlog_pipe_t * a_pipe, const char *str, size_t len)
+{
+	int rc = 0;
+	int partial = 0;
+	ssize_t nwrite;
+
+	/* no thread in a child, it waits itself */
+	if (zc_forked(a_pipe->forks)) return zlog_pipe_write_all(a_pipe->fd, str, len);
+
+	pthread_mutex_lock(&(a_pipe->lock_mutex));
+
+	/* nothing is waiting, so this one can go first */
+	if (!a_pipe->len) {
+		nwrite = zlog_pipe_try(a_pipe->fd, str, len);
+		if (nwrite < 0) {
+			pthread_mutex_unlock(&(a_pipe->lock_mutex));
+			zc_error("write fail, errno[%d]", errno);
+			return -1;
+		}
+		str += nwrite;
+		len -= nwrite;
+		if (!len) goto exit;
+		/* only above PIPE_BUF, the rest must follow, whatever full is */
+		partial = (nwrite > 0);
+	}
+
+	if (len > a_pipe->size) {
+		/* larger than the buffer, after all before it */
+		while (a_pipe->len) {
+			pthread_cond_wait(&(a_pipe->cond), &(a_pipe->lock_mutex));
+		}
+		rc = zlog_pipe_write_all(a_pipe->fd, str, len);
+		goto exit;
+	}
+
+	while (a_pipe->size - a_pipe->len < len) {
+		if (partial || a_pipe->full == ZLOG_PIPE_BLOCK) {
+			pthread_cond_wait(&(a_pipe->cond), &(a_pipe->lock_mutex));
+		} else if (a_pipe->full == ZLOG_PIPE_DROP) {
+			a_pipe->ndropped++;
+			goto exit;
+		} else {
+			a_pipe->nspilled++;
+			pthread_mutex_unlock(&(a_pipe->lock_mutex));
+			if (write(a_pipe->spill_fd, str, len) < 0) {
+				zc_error("write spill file[%s] fail, errno[%d]", a_pipe->spill_path, errno);
+				return -1;
+			}
+			return 0;
+		}
+	}
+
+	zlog_pipe_put(a_pipe, str, len);
+	pthread_cond_broadcast(&(a_pipe->cond));
+exit:
+	pthread_mutex_unlock(&(a_pipe->lock_mutex));
+	return rc;
+}
+
+/*******************************************************************************/
+/* pipes of this process, for a crash flush */
+static zlog_pipe_t *zlog_pipes = NULL;
+static pthread_mutex_t zlog_pipes_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t zlog_pipes_once = PTHREAD_ONCE_INIT;
+
+/* from a signal handler, a reader which takes nothing for a while is
+ * given up, what the thread was writing right now may come twice
+ */
+static int zlog_pipe_crash_write(int fd, const char *str, size_t len)
+{
+	ssize_t nwrite;
+
+	while (len > 0) {
+		nwrite = write(fd, str, len);
+		if (nwrite < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+			if (!zlog_pipe_poll(fd, ZLOG_PIPE_STALL_MS)) return -1;
+			continue;
+		}
+		str += nwrite;
+		len -= nwrite;
+	}
+	return 0;
+}
+
+void zlog_pipe_crash_flush(void)
+{
+	size_t head;
+	size_t len;
+	size_t n;
+	zlog_pipe_t *a_pipe;
+
+	for (a_pipe = zlog_pipes; a_pipe; a_pipe = a_pipe->next) {
+		if (zc_forked(a_pipe->forks)) continue;
+		zlog_crash_claim(&(a_pipe->writing));
+
+		head = a_pipe->head;
+		len = a_pipe->len;
+		n = a_pipe->size - head;
+		if (n > len) n = len;
+		if (zlog_pipe_crash_write(a_pipe->fd, a_pipe->buf + head, n)) continue;
+		zlog_pipe_crash_write(a_pipe->fd, a_pipe->buf, len - n);
+	}
+}
+
+static void zlog_pipes_atfork_child(void)
+{
+	pthread_mutex_init(&zlog_pipes_mutex, NULL);
+}
+
+static void zlog_pipes_init(void)
+{
+	pthread_atfork(NULL, NULL, zlog_pipes_atfork_child);
+}
+
+static void zlog_pipe_register(zlog_pipe_t * a_pipe)
+{
+	pthread_once(&zlog_pipes_once, zlog_pipes_init);
+
+	pthread_mutex_lock(&zlog_pipes_mutex);
+	a_pipe->next = zlog_pipes;
+	zlog_pipes = a_pipe;
+	pthread_mutex_unlock(&zlog_pipes_mutex);
+}
+
+static void zlog_pipe_unregister(zlog_pipe_t * a_pipe)
+{
+	zlog_pipe_t **p;
+
+	pthread_mutex_lock(&zlog_pipes_mutex);
+	for (p = &zlog_pipes; *p; p = &((*p)->next)) {
+		if (*p == a_pipe) {
+			*p = a_pipe->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&zlog_pipes_mutex);
+}
+
+/*******************************************************************************/
+void zlog_pipe_del(zlog_pipe_t * a_pipe)
+{
+	zc_assert(a_pipe,);
+
+	zlog_pipe_unregister(a_pipe);
+
+	if (a_pipe->started && !zc_forked(a_pipe->forks)) {
+		pthread_mutex_lock(&(a_pipe->lock_mutex));
+		a_pipe->stopping = 1;
+		pthread_cond_broadcast(&(a_pipe->cond));
+		pthread_mutex_unlock(&(a_pipe->lock_mutex));
+		pthread_join(a_pipe->tid, NULL);
+	}
+
+	if (a_pipe->spill_fd >= 0) close(a_pipe->spill_fd);
+	pthread_cond_destroy(&(a_pipe->cond));
+	pthread_mutex_destroy(&(a_pipe->lock_mutex));
+	free(a_pipe->buf);
+	zc_debug("zlog_pipe_del[%p]", a_pipe);
+	free(a_pipe);
+	return;
+}
+
+zlog_pipe_t *zlog_pipe_new(int fd, size_t buf_size, int full,
+		const char *spill_path, unsigned int spill_perms, size_t pipe_size)
+{
+	int rc;
+	int flags;
+	zlog_pipe_t *a_pipe;
+
+	if (full == ZLOG_PIPE_SPILL && (!spill_path || *spill_path == '\0')) {
+		zc_error("spill needs a file");
+		return NULL;
+	}
+	if (spill_path && strlen(spill_path) > MAXLEN_PATH) {
+		zc_error("spill path[%s] is too long", spill_path);
+		return NULL;
+	}
+
+	a_pipe = calloc(1, sizeof(zlog_pipe_t));
+	if (!a_pipe) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	a_pipe->fd = fd;
+	a_pipe->full = full;
+	a_pipe->spill_fd = -1;
+	zc_fork_watch();
+	a_pipe->forks = zc_forks;
+	a_pipe->size = buf_size ? buf_size : ZLOG_PIPE_DEFAULT_BUFFER;
+	if (spill_path) strcpy(a_pipe->spill_path, spill_path);
+
+	if (pthread_mutex_init(&(a_pipe->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_pipe);
+		return NULL;
+	}
+	if (pthread_cond_init(&(a_pipe->cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		pthread_mutex_destroy(&(a_pipe->lock_mutex));
+		free(a_pipe);
+		return NULL;
+	}
+
+	a_pipe->buf = malloc(a_pipe->size);
+	if (!a_pipe->buf) {
+		zc_error("malloc fail, errno[%d]", errno);
+		goto err;
+	}
+
+	if (full == ZLOG_PIPE_SPILL) {
+		a_pipe->spill_fd = open(a_pipe->spill_path,
+			O_WRONLY | O_APPEND | O_CREAT, spill_perms);
+		if (a_pipe->spill_fd < 0) {
+			zc_error("open file[%s] fail, errno[%d]", a_pipe->spill_path, errno);
+			goto err;
+		}
+	}
+
+	if (pipe_size) {
+#ifdef F_SETPIPE_SZ
+		if (fcntl(fd, F_SETPIPE_SZ, (int)pipe_size) < 0) {
+			zc_warn("fcntl F_SETPIPE_SZ[%ld] fail, errno[%d]", (long)pipe_size, errno);
+		}
+#else
+		zc_warn("pipe size can not be set on this system");
+#endif
+	}
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		zc_error("fcntl O_NONBLOCK fail, errno[%d]", errno);
+		goto err;
+	}
+
+	rc = pthread_create(&(a_pipe->tid), NULL, zlog_pipe_drain, a_pipe);
+	if (rc) {
+		zc_error("pthread_create fail, rc[%d]", rc);
+		goto err;
+	}
+	a_pipe->started = 1;
+	zlog_pipe_register(a_pipe);
+
+	zlog_pipe_profile(a_pipe, ZC_DEBUG);
+	return a_pipe;
+err:
+	zlog_pipe_del(a_pipe);
+	return NULL;
+}
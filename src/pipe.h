@@ -0,0 +1,71 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_pipe_h
+#define __zlog_pipe_h
+
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "zc_defs.h"
+
+/* what is done with a record when the pipe and the buffer are full */
+#define ZLOG_PIPE_BLOCK		0	/* wait for the reader, as before */
+#define ZLOG_PIPE_DROP		1	/* drop it and count */
+#define ZLOG_PIPE_SPILL		2	/* append it to a file and count */
+
+#define ZLOG_PIPE_DEFAULT_BUFFER	(1024 * 1024)
+#define ZLOG_PIPE_STALL_MS	5000	/* at fini, the reader is given up after this */
+
+/* the fd is non-blocking, a record goes to it at once when nothing is
+ * waiting, or else into the buffer, which a thread writes out as the
+ * reader takes it
+ */
+typedef struct zlog_pipe_s {
+	int fd;
+	int full;			/* ZLOG_PIPE_* */
+	char spill_path[MAXLEN_PATH + 1];
+	int spill_fd;
+	unsigned long forks;		/* of zc_forks, the thread runs in this process only */
+
+	pthread_mutex_t lock_mutex;
+	pthread_cond_t cond;		/* data to write, or room made */
+	char *buf;			/* ring */
+	size_t size;
+	size_t head;
+	size_t len;
+
+	pthread_t tid;
+	int started;
+	int stopping;
+	int writing;			/* of zlog_crash_claim, while the thread writes */
+
+	unsigned long ndropped;
+	unsigned long nspilled;
+	unsigned long nreported;	/* of ndropped, told in the pipe */
+
+	struct zlog_pipe_s *next;	/* in the list written out on a crash */
+} zlog_pipe_t;
+
+/* pipe_size > 0 asks the kernel for a larger pipe, where it can */
+zlog_pipe_t *zlog_pipe_new(int fd, size_t buf_size, int full,
+		const char *spill_path, unsigned int spill_perms, size_t pipe_size);
+/* what is in the buffer is written first, unless the reader takes nothing
+ * in ZLOG_PIPE_STALL_MS
+ */
+void zlog_pipe_del(zlog_pipe_t * a_pipe);
+void zlog_pipe_profile(zlog_pipe_t * a_pipe, int flag);
+
+int zlog_pipe_write(zlog_pipe_t * a_pipe, const char *str, size_t len);
+
+/* write the buffers of all pipes, async-signal-safe, for a crash handler,
+ * a reader which takes nothing for a while is given up
+ */
+void zlog_pipe_crash_flush(void);
+
+#endif
@@ -11,30 +11,32 @@
 #include "errno.h"
 #include "zc_defs.h"
 #include "record.h"
+#include "batch.h"
 
 void zlog_record_profile(zlog_record_t *a_record, int flag)
 {
 	zc_assert(a_record,);
-	zc_profile(flag, "--record:[%p][%s:%p]--", a_record, a_record->name,  a_record->output);
+	zc_profile(flag, "--record:[%p][%s:%p:%p]--", a_record, a_record->name,
+		a_record->output, a_record->event_output);
+	if (a_record->batch) zlog_batch_profile(a_record->batch, flag);
 	return;
 }
 
 void zlog_record_del(zlog_record_t *a_record)
 {
 	zc_assert(a_record,);
+	/* the records waiting go to the callback first */
+	if (a_record->batch) zlog_batch_del(a_record->batch);
 	free(a_record);
 	zc_debug("zlog_record_del[%p]", a_record);
 	return;
 }
 
-zlog_record_t *zlog_record_new(const char *name, zlog_record_fn output)
+static zlog_record_t *zlog_record_alloc(const char *name)
 {
 	int nwrite;
 	zlog_record_t *a_record;
 
-	zc_assert(name, NULL);
-	zc_assert(output, NULL);
-
 	a_record = calloc(1, sizeof(zlog_record_t));
 	if (!a_record) {
 		zc_error("calloc fail, errno[%d]", errno);
@@ -44,11 +46,62 @@ zlog_record_t *zlog_record_new(const char *name, zlog_record_fn output)
 	nwrite = snprintf(a_record->name, sizeof(a_record->name), "%s", name);
 	if (nwrite >= sizeof(a_record->name)) {
 		zc_error("name[%s] is too long", name);
-		goto err;
+		zlog_record_del(a_record);
+		return NULL;
 	}
+	return a_record;
+}
+
+zlog_record_t *zlog_record_new(const char *name, zlog_record_fn output)
+{
+	zlog_record_t *a_record;
+
+	zc_assert(name, NULL);
+	zc_assert(output, NULL);
+
+	a_record = zlog_record_alloc(name);
+	if (!a_record) return NULL;
 
 	a_record->output = output;
 
+	zlog_record_profile(a_record, ZC_DEBUG);
+	return a_record;
+}
+
+zlog_record_t *zlog_record_new_event(const char *name, zlog_record_event_fn output)
+{
+	zlog_record_t *a_record;
+
+	zc_assert(name, NULL);
+	zc_assert(output, NULL);
+
+	a_record = zlog_record_alloc(name);
+	if (!a_record) return NULL;
+
+	a_record->event_output = output;
+
+	zlog_record_profile(a_record, ZC_DEBUG);
+	return a_record;
+}
+
+zlog_record_t *zlog_record_new_batch(const char *name, zlog_record_batch_fn output,
+		size_t batch_size, long latency)
+{
+	zlog_record_t *a_record;
+
+	zc_assert(name, NULL);
+	zc_assert(output, NULL);
+
+	a_record = zlog_record_alloc(name);
+	if (!a_record) return NULL;
+
+	a_record->batch_output = output;
+	a_record->batch = zlog_batch_new(output, batch_size, latency);
+	if (!a_record->batch) {
+		zc_error("zlog_batch_new fail");
+		goto err;
+	}
+
 	zlog_record_profile(a_record, ZC_DEBUG);
 	return a_record;
 err:
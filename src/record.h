@@ -10,6 +10,7 @@
 #define __zlog_record_h
 
 #include "zc_defs.h"
+#include "kv.h"
 
 /* record is user-defined output function and it's name from configure file */
 typedef struct zlog_msg_s {
@@ -19,13 +20,48 @@ typedef struct zlog_msg_s {
 } zlog_msg_t; /* 3 of this first, see need thread or not later */
 
 typedef int (*zlog_record_fn)(zlog_msg_t * msg);
+typedef int (*zlog_record_batch_fn)(zlog_msg_t * msgs, size_t count);
+
+/* the fields of zlog_event_t a record came from, see zlog.h */
+typedef struct zlog_record_event_s {
+	const char *category;
+	size_t category_len;
+	int level;
+	const char *level_name;		/* as in conf, upper case */
+	long time_sec;
+	long time_usec;
+	const char *file;
+	size_t file_len;
+	const char *func;
+	size_t func_len;
+	long line;
+	long pid;
+	unsigned long tid;
+	long ktid;
+	const char *host;
+	size_t host_len;
+	const char *usr_msg;		/* %m, the dump of hzlog too */
+	size_t usr_msg_len;
+	const zlog_field_t *fields;	/* of zlog_kv, usr_msg is its message alone */
+	size_t field_count;
+} zlog_record_event_t;
+
+typedef int (*zlog_record_event_fn)(zlog_msg_t * msg, const zlog_record_event_t * event);
 
 typedef struct zlog_record_s {
 	char name[MAXLEN_CFG_NAME + 1];
 	zlog_record_fn output;
+	/* or output with the fields of the event */
+	zlog_record_event_fn event_output;
+	/* or records go to batch_output by the thread of batch */
+	zlog_record_batch_fn batch_output;
+	struct zlog_batch_s *batch;
 } zlog_record_t;
 
 zlog_record_t *zlog_record_new(const char *name, zlog_record_fn output);
+zlog_record_t *zlog_record_new_event(const char *name, zlog_record_event_fn output);
+zlog_record_t *zlog_record_new_batch(const char *name, zlog_record_batch_fn output,
+		size_t batch_size, long latency);
 void zlog_record_del(zlog_record_t *a_record);
 void zlog_record_profile(zlog_record_t *a_record, int flag);
 
@@ -6,6 +6,8 @@
  * Licensed under the LGPL v2.1, see the file COPYING in base directory.
  */
 
+#include "fmacros.h"
+
 #include <string.h>
 #include <glob.h>
 #include <stdio.h>
@@ -17,21 +19,28 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "zc_defs.h"
 #include "rotater.h"
+#include "compress.h"
 
 #define ROLLING  1     /* aa.02->aa.03, aa.01->aa.02, aa->aa.01 */
 #define SEQUENCE 2     /* aa->aa.03 */
 
 typedef struct {
 	int index;
+	char suffix[8];		/* "" or compressed suffix, aa.01.log.gz */
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
 } zlog_file_t;
 
 void zlog_rotater_profile(zlog_rotater_t * a_rotater, int flag)
 {
 	zc_assert(a_rotater,);
-	zc_profile(flag, "--rotater[%p][%p,%s,%d][%s,%s,%s,%ld,%ld,%d,%d,%d]--",
+	zc_profile(flag, "--rotater[%p][%p,%s,%d][%s,%s,%s,%ld,%ld,%d,%d,%d,%ld,%ld]--",
 		a_rotater,
 
 		&(a_rotater->lock_mutex),
@@ -45,13 +54,15 @@ void zlog_rotater_profile(zlog_rotater_t * a_rotater, int flag)
 		(long)a_rotater->num_end_len,
 		a_rotater->num_width,
 		a_rotater->mv_type,
-		a_rotater->max_count
+		a_rotater->max_count,
+		(long)a_rotater->max_total,
+		a_rotater->max_age
 		);
 	if (a_rotater->files) {
 		int i;
 		zlog_file_t *a_file;
 		zc_arraylist_foreach(a_rotater->files, i, a_file) {
-			zc_profile(flag, "[%d]->", a_file->index);
+			zc_profile(flag, "[%d%s,%ld]->", a_file->index, a_file->suffix, (long)a_file->size);
 		}
 	}
 	return;
@@ -69,6 +80,8 @@ static void zlog_file_del(zlog_file_t * a_file)
 static zlog_file_t *zlog_file_check_new(zlog_rotater_t * a_rotater, const char *path)
 {
 	int nread;
+	size_t len;
+	const char *tail;
 	zlog_file_t *a_file;
 
 	/* base_path will not be in list */
@@ -97,6 +110,20 @@ static zlog_file_t *zlog_file_check_new(zlog_rotater_t * a_rotater, const char *
 		}
 	} /* else all file is ok */
 
+	/* after the number, aa.01.log or aa.01.log.gz, which is compressed */
+	tail = path + a_rotater->num_start_len + nread;
+	len = strlen(a_rotater->glob_path + a_rotater->num_end_len);
+	if (STRNCMP(tail, !=, a_rotater->glob_path + a_rotater->num_end_len, len)) {
+		goto err;
+	}
+	tail += len;
+	if (*tail != '\0') {
+		if (!zlog_compress_suffix_len(tail)) {
+			goto err;
+		}
+		strcpy(a_file->suffix, tail);
+	}
+
 	return a_file;
 err:
 	zlog_file_del(a_file);
@@ -109,28 +136,270 @@ static int zlog_file_cmp(zlog_file_t * a_file_1, zlog_file_t * a_file_2)
 	return (a_file_1->index > a_file_2->index);
 }
 
+/*******************************************************************************/
+/* archive index
+ *
+ * archives of a glob_path are listed by glob once, then kept up to date by
+ * rotations and background jobs of this rotater, all in the rotate lock.
+ * a dir keeps its mtime after our last change, if it differs when we come
+ * back, something else was there, and its indexes are listed again.
+ * an index not rotated for its max age, or a day without one, is dropped
+ * by the tick when no compress job is on it, so do dirs left without indexes
+ */
+#define ZLOG_ARCHIVE_IDLE (24 * 3600)
+
+typedef struct {
+	char path[MAXLEN_PATH + 1];
+	time_t sec;
+	long nsec;
+	unsigned long gen;		/* bumped when changed by others */
+	int refs;			/* indexes and prune jobs in it */
+	time_t used;			/* last rotation in it */
+} zlog_archive_dir_t;
+
+typedef struct zlog_archive_index_s {
+	char glob_path[MAXLEN_PATH + 1];
+	zlog_archive_dir_t *dir;
+	unsigned long gen;		/* of dir, when listed */
+	zc_arraylist_t *files;		/* NULL, not listed yet */
+	int refs;			/* compress jobs on it */
+
+	/* of the last rotation, to prune between rotations */
+	char base_path[MAXLEN_PATH + 1];
+	size_t num_start_len;
+	size_t num_end_len;
+	int num_width;
+	int mv_type;
+	size_t max_total;
+	long max_age;
+	time_t used;
+} zlog_archive_index_t;
+
+static void zlog_archive_index_del(zlog_archive_index_t * a_index)
+{
+	a_index->dir->refs--;
+	if (a_index->files) zc_arraylist_del(a_index->files);
+	free(a_index);
+}
+
+static zlog_archive_dir_t *zlog_archive_dir_get(zlog_rotater_t * a_rotater, const char *path)
+{
+	char dir_path[MAXLEN_PATH + 1];
+	const char *p;
+	zlog_archive_dir_t *a_dir;
+
+	p = strrchr(path, '/');
+	if (!p) {
+		strcpy(dir_path, ".");
+	} else if (p == path) {
+		strcpy(dir_path, "/");
+	} else {
+		snprintf(dir_path, sizeof(dir_path), "%.*s", (int)(p - path), path);
+	}
+
+	if (!a_rotater->dirs) {
+		a_rotater->dirs = zc_hashtable_new(8,
+				(zc_hashtable_hash_fn) zc_hashtable_str_hash,
+				(zc_hashtable_equal_fn) zc_hashtable_str_equal,
+				NULL, (zc_hashtable_del_fn) free);
+		if (!a_rotater->dirs) {
+			zc_error("zc_hashtable_new fail");
+			return NULL;
+		}
+	}
+
+	a_dir = zc_hashtable_get(a_rotater->dirs, dir_path);
+	if (a_dir) return a_dir;
+
+	a_dir = calloc(1, sizeof(zlog_archive_dir_t));
+	if (!a_dir) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	strcpy(a_dir->path, dir_path);
+
+	if (zc_hashtable_put(a_rotater->dirs, a_dir->path, a_dir)) {
+		zc_error("zc_hashtable_put fail");
+		free(a_dir);
+		return NULL;
+	}
+	return a_dir;
+}
+
+static int zlog_archive_dir_stat(zlog_archive_dir_t * a_dir, time_t *sec, long *nsec)
+{
+	struct zlog_stat info;
+
+	if (zlog_stat(a_dir->path, &info)) return -1;
+
+	*sec = info.st_mtime;
+#ifdef __linux__
+	*nsec = info.st_mtim.tv_nsec;
+#else
+	*nsec = 0;
+#endif
+	return 0;
+}
+
+/* before we change the dir */
+static void zlog_archive_dir_begin(zlog_archive_dir_t * a_dir)
+{
+	time_t sec;
+	long nsec;
+
+	if (a_dir->sec && !zlog_archive_dir_stat(a_dir, &sec, &nsec)
+		&& sec == a_dir->sec && nsec == a_dir->nsec) {
+		return;
+	}
+
+	/* changed by others, list all its archives again */
+	a_dir->gen++;
+}
+
+/* after we changed the dir */
+static void zlog_archive_dir_end(zlog_archive_dir_t * a_dir)
+{
+	if (zlog_archive_dir_stat(a_dir, &(a_dir->sec), &(a_dir->nsec))) {
+		a_dir->sec = 0;
+		return;
+	}
+
+#ifndef __linux__
+	/* mtime in seconds, a change by others later in this second would be missed */
+	if (a_dir->sec >= time(NULL)) a_dir->sec = 0;
+#endif
+}
+
+static zlog_archive_index_t *zlog_archive_index_get(zlog_rotater_t * a_rotater, const char *glob_path)
+{
+	zlog_archive_index_t *a_index;
+
+	if (!a_rotater->indexes) {
+		a_rotater->indexes = zc_hashtable_new(8,
+				(zc_hashtable_hash_fn) zc_hashtable_str_hash,
+				(zc_hashtable_equal_fn) zc_hashtable_str_equal,
+				NULL, (zc_hashtable_del_fn) zlog_archive_index_del);
+		if (!a_rotater->indexes) {
+			zc_error("zc_hashtable_new fail");
+			return NULL;
+		}
+	}
+
+	a_index = zc_hashtable_get(a_rotater->indexes, glob_path);
+	if (a_index) return a_index;
+
+	a_index = calloc(1, sizeof(zlog_archive_index_t));
+	if (!a_index) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	snprintf(a_index->glob_path, sizeof(a_index->glob_path), "%s", glob_path);
+
+	a_index->dir = zlog_archive_dir_get(a_rotater, glob_path);
+	if (!a_index->dir) {
+		zc_error("zlog_archive_dir_get fail");
+		free(a_index);
+		return NULL;
+	}
+
+	if (zc_hashtable_put(a_rotater->indexes, a_index->glob_path, a_index)) {
+		zc_error("zc_hashtable_put fail");
+		free(a_index);
+		return NULL;
+	}
+	a_index->dir->refs++;
+	return a_index;
+}
+
+/* keep the pattern and limits, the tick prunes with them */
+static void zlog_archive_index_use(zlog_rotater_t * a_rotater, zlog_archive_dir_t * base_dir)
+{
+	zlog_archive_index_t *a_index = a_rotater->index;
+
+	snprintf(a_index->base_path, sizeof(a_index->base_path), "%s", a_rotater->base_path);
+	a_index->num_start_len = a_rotater->num_start_len;
+	a_index->num_end_len = a_rotater->num_end_len;
+	a_index->num_width = a_rotater->num_width;
+	a_index->mv_type = a_rotater->mv_type;
+	a_index->max_total = a_rotater->max_total;
+	a_index->max_age = a_rotater->max_age;
+	a_index->used = time(NULL);
+	a_index->dir->used = a_index->used;
+	base_dir->used = a_index->used;
+}
+
+/* list it again next time */
+#define zlog_archive_index_forget(a_index) ((a_index)->gen = (a_index)->dir->gen - 1)
+
+static zlog_file_t *zlog_archive_index_find(zlog_archive_index_t * a_index, dev_t dev, ino_t ino)
+{
+	int i;
+	zlog_file_t *a_file;
+
+	if (!a_index->files || a_index->gen != a_index->dir->gen) return NULL;
+
+	zc_arraylist_foreach(a_index->files, i, a_file) {
+		if (a_file->dev == dev && a_file->ino == ino) return a_file;
+	}
+	return NULL;
+}
+
+static int zlog_file_set_stat(zlog_file_t * a_file, const char *path)
+{
+	struct zlog_stat info;
+
+	if (zlog_stat(path, &info)) {
+		zc_warn("stat [%s] fail, errno[%d]", path, errno);
+		return -1;
+	}
+	a_file->dev = info.st_dev;
+	a_file->ino = info.st_ino;
+	a_file->size = info.st_size;
+	a_file->mtime = info.st_mtime;
+	return 0;
+}
+
 static int zlog_rotater_add_archive_files(zlog_rotater_t * a_rotater)
 {
 	int rc = 0;
+	int nwrite;
+	int globbed = 0;
 	glob_t glob_buf;
 	size_t pathc;
 	char **pathv;
 	zlog_file_t *a_file;
+	zc_arraylist_t *files;
+	zlog_archive_index_t *a_index = a_rotater->index;
+	char glob_path[MAXLEN_PATH + 2];
 
-	/* scan file which is aa.*.log and aa */
-	rc = glob(a_rotater->glob_path, GLOB_ERR | GLOB_MARK | GLOB_NOSORT, NULL, &glob_buf);
+	/* listed before, and nothing else changed the dir since */
+	if (a_index->files && a_index->gen == a_index->dir->gen) {
+		a_rotater->files = a_index->files;
+		return 0;
+	}
+
+	/* scan file which is aa.*.log, aa.*.log.gz and aa */
+	nwrite = snprintf(glob_path, sizeof(glob_path), "%s*", a_rotater->glob_path);
+	if (nwrite < 0 || nwrite >= sizeof(glob_path)) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		return -1;
+	}
+
+	rc = glob(glob_path, GLOB_ERR | GLOB_MARK | GLOB_NOSORT, NULL, &glob_buf);
 	if (rc == GLOB_NOMATCH) {
-		goto exit;
+		pathv = NULL;
+		pathc = 0;
 	} else if (rc) {
 		zc_error("glob err, rc=[%d], errno[%d]", rc, errno);
 		return -1;
+	} else {
+		globbed = 1;
+		pathv = glob_buf.gl_pathv;
+		pathc = glob_buf.gl_pathc;
 	}
 
-	pathv = glob_buf.gl_pathv;
-	pathc = glob_buf.gl_pathc;
-
-	a_rotater->files = zc_arraylist_new((zc_arraylist_del_fn)zlog_file_del, pathc);
-	if (!a_rotater->files) {
+	files = zc_arraylist_new((zc_arraylist_del_fn)zlog_file_del, pathc ? pathc : 1);
+	if (!files) {
 		zc_error("zc_arraylist_new fail");
 		goto err;
 	}
@@ -143,25 +412,430 @@ static int zlog_rotater_add_archive_files(zlog_rotater_t * a_rotater)
 			continue;
 		}
 
+		/* size and age, for max total and max age */
+		if (zlog_file_set_stat(a_file, *pathv)) {
+			zlog_file_del(a_file);
+			continue;
+		}
+
 		/* file in list aa.00, aa.01, aa.02... */
-		rc = zc_arraylist_sortadd(a_rotater->files,
+		rc = zc_arraylist_sortadd(files,
 					(zc_arraylist_cmp_fn)zlog_file_cmp, a_file);
 		if (rc) {
 			zc_error("zc_arraylist_sortadd fail");
+			zlog_file_del(a_file);
+			zc_arraylist_del(files);
 			goto err;
 		}
 	}
 
-	zc_arraylist_reduce_size(a_rotater->files);
+	if (a_index->files) zc_arraylist_del(a_index->files);
+	a_index->files = files;
+	a_index->gen = a_index->dir->gen;
+	a_rotater->files = files;
 
-exit:
-	globfree(&glob_buf);
+	if (globbed) globfree(&glob_buf);
 	return 0;
 err:
-	globfree(&glob_buf);
+	if (globbed) globfree(&glob_buf);
 	return -1;
 }
 
+/* the new archive, aa.00.log in roll or aa.05.log in sequence */
+static int zlog_rotater_index_add(zlog_rotater_t * a_rotater, const char *path, int index)
+{
+	zlog_file_t *a_file;
+
+	a_file = calloc(1, sizeof(zlog_file_t));
+	if (!a_file) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return -1;
+	}
+	a_file->index = index;
+
+	if (zlog_file_set_stat(a_file, path)
+		|| zc_arraylist_sortadd(a_rotater->files,
+				(zc_arraylist_cmp_fn)zlog_file_cmp, a_file)) {
+		zlog_file_del(a_file);
+		return -1;
+	}
+	return 0;
+}
+
+/* find the file by inode, at path or rolled to another name of glob_path */
+static int zlog_rotater_find(const char *path, const char *glob_path,
+		dev_t dev, ino_t ino, char *found, size_t found_size)
+{
+	int rc = 0;
+	size_t i;
+	glob_t glob_buf;
+	struct zlog_stat info;
+
+	if (!zlog_stat(path, &info) && info.st_dev == dev && info.st_ino == ino) {
+		snprintf(found, found_size, "%s", path);
+		return 0;
+	}
+
+	rc = glob(glob_path, GLOB_NOSORT, NULL, &glob_buf);
+	if (rc) return -1;
+
+	rc = -1;
+	for (i = 0; i < glob_buf.gl_pathc; i++) {
+		if (!zlog_stat(glob_buf.gl_pathv[i], &info)
+			&& info.st_dev == dev && info.st_ino == ino) {
+			snprintf(found, found_size, "%s", glob_buf.gl_pathv[i]);
+			rc = 0;
+			break;
+		}
+	}
+	globfree(&glob_buf);
+	return rc;
+}
+
+/*******************************************************************************/
+/* compress archives in background
+ *
+ * the archive may be rolled to another index while being compressed,
+ * so the job keeps an fd of it, and looks for the inode again in lock,
+ * the final aa.01.log.gz only appears by rename
+ */
+typedef struct {
+	zlog_rotater_t *rotater;
+	zlog_archive_index_t *index;
+	int fd;
+	struct zlog_stat info;
+	char path[MAXLEN_PATH + 1];		/* aa.00.log when queued */
+	char glob_path[MAXLEN_PATH + 2];	/* aa.*.log* */
+	char tmp_path[MAXLEN_PATH + 1];		/* .aa.00.log.gz.XXXXXX */
+} zlog_rotater_zip_t;
+
+static void zlog_rotater_zip_del(zlog_rotater_zip_t *a_zip)
+{
+	if (a_zip->fd >= 0) close(a_zip->fd);
+	if (a_zip->tmp_path[0] != '\0') unlink(a_zip->tmp_path);
+	/* taken in lock, so the tick does not drop it meanwhile */
+	ATOM_SUB_F(&(a_zip->index->refs), 1);
+	zlog_rotater_del(a_zip->rotater);
+	free(a_zip);
+}
+
+static int zlog_rotater_lock(zlog_rotater_t *a_rotater);
+static int zlog_rotater_unlock(zlog_rotater_t *a_rotater);
+
+static void zlog_rotater_zip_run(zlog_worker_t *a_worker, zlog_rotater_zip_t *a_zip)
+{
+	int tmp_fd;
+	char *p;
+	char path[MAXLEN_PATH + 1];
+	char zip_path[MAXLEN_PATH + 1];
+	int nwrite;
+	struct zlog_stat info;
+	struct timespec times[2];
+	zlog_file_t *a_file;
+
+	/* .aa.00.log.gz.XXXXXX, beside the archive and hidden from glob */
+	p = strrchr(a_zip->path, '/');
+	p = p ? p + 1 : a_zip->path;
+	nwrite = snprintf(a_zip->tmp_path, sizeof(a_zip->tmp_path), "%.*s.%s%s.XXXXXX",
+			(int)(p - a_zip->path), a_zip->path, p, ZLOG_COMPRESS_SUFFIX);
+	if (nwrite < 0 || nwrite >= sizeof(a_zip->tmp_path)) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		a_zip->tmp_path[0] = '\0';
+		return;
+	}
+
+	/* in lock, so the index knows the dir is changed by us */
+	if (zlog_rotater_lock(a_zip->rotater)) {
+		zc_error("zlog_rotater_lock fail");
+		a_zip->tmp_path[0] = '\0';
+		return;
+	}
+	zlog_archive_dir_begin(a_zip->index->dir);
+	tmp_fd = mkstemp(a_zip->tmp_path);
+	zlog_archive_dir_end(a_zip->index->dir);
+	if (zlog_rotater_unlock(a_zip->rotater)) {
+		zc_error("zlog_rotater_unlock fail");
+	}
+	if (tmp_fd < 0) {
+		zc_error("mkstemp[%s] fail, errno[%d]", a_zip->tmp_path, errno);
+		a_zip->tmp_path[0] = '\0';
+		return;
+	}
+	fchmod(tmp_fd, a_zip->info.st_mode & 07777);
+
+	if (zlog_compress_fd(a_zip->fd, tmp_fd, &(a_worker->stop))) {
+		zc_error("zlog_compress_fd[%s] fail", a_zip->path);
+		close(tmp_fd);
+		return;
+	}
+	if (zlog_fsync(tmp_fd)) {
+		zc_error("fsync[%s] fail, errno[%d]", a_zip->tmp_path, errno);
+		close(tmp_fd);
+		return;
+	}
+
+	/* keep mtime of the archive, max age counts from it */
+	times[0].tv_sec = 0;
+	times[0].tv_nsec = UTIME_OMIT;
+	times[1].tv_sec = a_zip->info.st_mtime;
+	times[1].tv_nsec = 0;
+	futimens(tmp_fd, times);
+
+	if (zlog_fstat(tmp_fd, &info)) {
+		zc_error("fstat[%s] fail, errno[%d]", a_zip->tmp_path, errno);
+		close(tmp_fd);
+		return;
+	}
+	close(tmp_fd);
+
+	if (zlog_rotater_lock(a_zip->rotater)) {
+		zc_error("zlog_rotater_lock fail");
+		return;
+	}
+	zlog_archive_dir_begin(a_zip->index->dir);
+
+	if (zlog_rotater_find(a_zip->path, a_zip->glob_path,
+			a_zip->info.st_dev, a_zip->info.st_ino, path, sizeof(path))) {
+		/* removed as beyond max count, drop the tmp */
+		zc_debug("archive[%s] is gone", a_zip->path);
+		goto exit;
+	}
+
+	/* pruned meanwhile, its delete job is on the way */
+	a_file = zlog_archive_index_find(a_zip->index, a_zip->info.st_dev, a_zip->info.st_ino);
+	if (!a_file && a_zip->index->files && a_zip->index->gen == a_zip->index->dir->gen) {
+		zc_debug("archive[%s] is pruned", path);
+		goto exit;
+	}
+
+	nwrite = snprintf(zip_path, sizeof(zip_path), "%s%s", path, ZLOG_COMPRESS_SUFFIX);
+	if (nwrite < 0 || nwrite >= sizeof(zip_path)) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		goto exit;
+	}
+
+	if (rename(a_zip->tmp_path, zip_path)) {
+		zc_error("rename[%s]->[%s] fail, errno[%d]", a_zip->tmp_path, zip_path, errno);
+		goto exit;
+	}
+	a_zip->tmp_path[0] = '\0';
+
+	if (unlink(path)) {
+		zc_error("unlink[%s] fail, errno[%d]", path, errno);
+		if (a_file) zlog_archive_index_forget(a_zip->index);
+	} else if (a_file) {
+		strcpy(a_file->suffix, ZLOG_COMPRESS_SUFFIX);
+		a_file->dev = info.st_dev;
+		a_file->ino = info.st_ino;
+		a_file->size = info.st_size;
+	}
+
+exit:
+	zlog_archive_dir_end(a_zip->index->dir);
+	if (zlog_rotater_unlock(a_zip->rotater)) {
+		zc_error("zlog_rotater_unlock fail");
+	}
+	return;
+}
+
+static int zlog_rotater_zip(zlog_rotater_t * a_rotater, const char *path)
+{
+	int nwrite;
+	zlog_rotater_zip_t *a_zip;
+
+	a_zip = calloc(1, sizeof(zlog_rotater_zip_t));
+	if (!a_zip) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return -1;
+	}
+
+	nwrite = snprintf(a_zip->glob_path, sizeof(a_zip->glob_path), "%s*", a_rotater->glob_path);
+	if (nwrite < 0 || nwrite >= sizeof(a_zip->glob_path)) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		free(a_zip);
+		return -1;
+	}
+	snprintf(a_zip->path, sizeof(a_zip->path), "%s", path);
+
+	a_zip->fd = open(path, O_RDONLY);
+	if (a_zip->fd < 0) {
+		zc_error("open file[%s] fail, errno[%d]", path, errno);
+		free(a_zip);
+		return -1;
+	}
+
+	if (zlog_fstat(a_zip->fd, &(a_zip->info))) {
+		zc_error("fstat file[%s] fail, errno[%d]", path, errno);
+		close(a_zip->fd);
+		free(a_zip);
+		return -1;
+	}
+
+	ATOM_ADD_F(&(a_rotater->refs), 1);
+	a_zip->rotater = a_rotater;
+	a_zip->index = a_rotater->index;
+	ATOM_ADD_F(&(a_zip->index->refs), 1);
+
+	/* a_zip is freed by the worker, even when fail */
+	return zlog_worker_submit(a_rotater->compress_worker,
+			(zlog_worker_run_fn)zlog_rotater_zip_run,
+			(zlog_worker_del_fn)zlog_rotater_zip_del, a_zip);
+}
+
+/*******************************************************************************/
+/* delete archives beyond max total or max age, oldest first, in background
+ *
+ * they leave the index at once, and are renamed to hidden names in lock,
+ * so a later roll can not hit them, and their inodes are not looked for.
+ * all victims of a rotation are unlinked by one job
+ */
+typedef struct {
+	zlog_rotater_t *rotater;
+	zlog_archive_dir_t *dir;
+	int nvictims;
+	char victims[][MAXLEN_PATH + 1];	/* .aa.03.log.<pid>.<n>.del */
+} zlog_rotater_prune_t;
+
+static void zlog_rotater_prune_del(zlog_rotater_prune_t *a_prune)
+{
+	if (a_prune->rotater) zlog_rotater_del(a_prune->rotater);
+	free(a_prune);
+}
+
+static void zlog_rotater_prune_run(zlog_worker_t *a_worker, zlog_rotater_prune_t *a_prune)
+{
+	int i;
+
+	/* in lock, so the index knows the dir is changed by us */
+	if (zlog_rotater_lock(a_prune->rotater)) {
+		zc_error("zlog_rotater_lock fail");
+		return;
+	}
+	zlog_archive_dir_begin(a_prune->dir);
+
+	for (i = 0; i < a_prune->nvictims; i++) {
+		if (unlink(a_prune->victims[i])) {
+			zc_error("unlink[%s] fail, errno[%d]", a_prune->victims[i], errno);
+		}
+	}
+
+	zlog_archive_dir_end(a_prune->dir);
+	a_prune->dir->refs--;
+	if (zlog_rotater_unlock(a_prune->rotater)) {
+		zc_error("zlog_rotater_unlock fail");
+	}
+	return;
+}
+
+/* move aa.03.log away to .aa.03.log.<pid>.<n>.del, hidden from glob */
+static int zlog_rotater_prune_hide(zlog_rotater_t * a_rotater,
+		zlog_file_t * a_file, char *hidden_path, size_t size)
+{
+	int nwrite;
+	const char *p;
+	char path[MAXLEN_PATH + 1];
+
+	nwrite = snprintf(path, sizeof(path), "%.*s%0*d%s%s",
+		(int)a_rotater->num_start_len, a_rotater->glob_path,
+		a_rotater->num_width, a_file->index,
+		a_rotater->glob_path + a_rotater->num_end_len, a_file->suffix);
+	if (nwrite < 0 || nwrite >= sizeof(path)) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		return -1;
+	}
+
+	p = strrchr(path, '/');
+	p = p ? p + 1 : path;
+	nwrite = snprintf(hidden_path, size, "%.*s.%s.%ld.%lu.del",
+		(int)(p - path), path, p, (long)getpid(), a_rotater->nhidden++);
+	if (nwrite < 0 || nwrite >= size) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		return -1;
+	}
+
+	if (rename(path, hidden_path)) {
+		zc_error("rename[%s]->[%s] fail, errno[%d]", path, hidden_path, errno);
+		return -1;
+	}
+	return 0;
+}
+
+static int zlog_rotater_prune(zlog_rotater_t * a_rotater)
+{
+	int i;
+	int len;
+	off_t total = 0;
+	time_t now;
+	zlog_file_t *a_file;
+	zlog_rotater_prune_t *a_prune;
+
+	if (a_rotater->max_total == 0 && a_rotater->max_age <= 0) return 0;
+
+	len = zc_arraylist_len(a_rotater->files);
+	if (len <= 1) return 0;
+
+	zc_arraylist_foreach(a_rotater->files, i, a_file) {
+		total += a_file->size;
+	}
+	now = time(NULL);
+
+	a_prune = calloc(1, sizeof(zlog_rotater_prune_t) + len * sizeof(a_prune->victims[0]));
+	if (!a_prune) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return -1;
+	}
+
+	/* the newest one is always kept, sequence numbers go on from it */
+	while ((len = zc_arraylist_len(a_rotater->files)) > 1) {
+		/* roll keeps the oldest at the end, sequence at the start */
+		i = (a_rotater->mv_type == ROLLING) ? len - 1 : 0;
+		a_file = zc_arraylist_get(a_rotater->files, i);
+
+		if (!(a_rotater->max_total && total > (off_t)a_rotater->max_total)
+			&& !(a_rotater->max_age > 0 && a_file->mtime + a_rotater->max_age <= now)) {
+			break;
+		}
+
+		if (zlog_rotater_prune_hide(a_rotater, a_file,
+				a_prune->victims[a_prune->nvictims], sizeof(a_prune->victims[0]))) {
+			/* gone already or not ours to move, the next scan tells */
+			zlog_archive_index_forget(a_rotater->index);
+		} else {
+			a_prune->nvictims++;
+		}
+
+		total -= a_file->size;
+		zc_arraylist_remove(a_rotater->files, i);
+	}
+
+	if (a_prune->nvictims == 0) {
+		free(a_prune);
+		return 0;
+	}
+
+	if (!a_rotater->prune_worker) {
+		/* we are in lock already */
+		for (i = 0; i < a_prune->nvictims; i++) {
+			if (unlink(a_prune->victims[i])) {
+				zc_error("unlink[%s] fail, errno[%d]", a_prune->victims[i], errno);
+			}
+		}
+		free(a_prune);
+		return 0;
+	}
+
+	ATOM_ADD_F(&(a_rotater->refs), 1);
+	a_prune->rotater = a_rotater;
+	a_prune->dir = a_rotater->index->dir;
+	a_prune->dir->refs++;
+
+	/* a_prune is freed by the worker, even when fail, hidden files stay then */
+	return zlog_worker_submit(a_rotater->prune_worker,
+			(zlog_worker_run_fn)zlog_rotater_prune_run,
+			(zlog_worker_del_fn)zlog_rotater_prune_del, a_prune);
+}
+
+/*******************************************************************************/
 static int zlog_rotater_seq_files(zlog_rotater_t * a_rotater,
 		int file_open_flags, unsigned int file_perms, int *orig_fd)
 {
@@ -172,9 +846,12 @@ static int zlog_rotater_seq_files(zlog_rotater_t * a_rotater,
 	char new_path[MAXLEN_PATH + 1];
 	int fd;
 	int min_idx = 0;
+	int nfiles = 0;
 
 	memcpy(new_path, a_rotater->glob_path, a_rotater->num_start_len);
 
+	if (a_rotater->files) nfiles = zc_arraylist_len(a_rotater->files);
+
 	if (a_rotater->files && zc_arraylist_len(a_rotater->files) > 0) {
 		a_file = zc_arraylist_get(a_rotater->files, zc_arraylist_len(a_rotater->files) - 1);
 		if (!a_file) {
@@ -215,13 +892,22 @@ static int zlog_rotater_seq_files(zlog_rotater_t * a_rotater,
 	dup2(fd, *orig_fd);
 	close(fd);
 
+	if (a_rotater->compress_worker && zlog_rotater_zip(a_rotater, new_path)) {
+		zc_error("zlog_rotater_zip[%s] fail, left uncompressed", new_path);
+	}
+
+	/* newest at the end of index */
+	if (zlog_rotater_index_add(a_rotater, new_path, j)) {
+		zlog_archive_index_forget(a_rotater->index);
+	}
+
 	if (!a_rotater->files || a_rotater->max_count <= 0) {
 		return 0;
 	}
 
 	min_idx = 0;
-	if (zc_arraylist_len(a_rotater->files) > a_rotater->max_count) {
-		min_idx = zc_arraylist_len(a_rotater->files) - a_rotater->max_count;
+	if (nfiles > a_rotater->max_count) {
+		min_idx = nfiles - a_rotater->max_count;
 	}
 
 	for (i = 0; i < min_idx; i++) {
@@ -233,9 +919,9 @@ static int zlog_rotater_seq_files(zlog_rotater_t * a_rotater,
 
 		/* unlink aa.0 aa.1 .. aa.(n-c) */
 		nwrite = snprintf(new_path + a_rotater->num_start_len,
-			sizeof(new_path) - a_rotater->num_start_len, "%0*d%s",
+			sizeof(new_path) - a_rotater->num_start_len, "%0*d%s%s",
 			a_rotater->num_width, a_file->index,
-			a_rotater->glob_path + a_rotater->num_end_len);
+			a_rotater->glob_path + a_rotater->num_end_len, a_file->suffix);
 		if (nwrite < 0 ||
 			nwrite + a_rotater->num_start_len >= sizeof(new_path)) {
 			zc_error("nwirte[%d], overflow or errno[%d]",
@@ -250,6 +936,10 @@ static int zlog_rotater_seq_files(zlog_rotater_t * a_rotater,
 		}
 	}
 
+	for (i = 0; i < min_idx; i++) {
+		zc_arraylist_remove(a_rotater->files, 0);
+	}
+
 	return 0;
 }
 
@@ -288,9 +978,9 @@ static int zlog_rotater_roll_files(zlog_rotater_t * a_rotater,
 		}
 
 		nwrite = snprintf(old_path + a_rotater->num_start_len,
-			sizeof(old_path) - a_rotater->num_start_len, "%0*d%s",
+			sizeof(old_path) - a_rotater->num_start_len, "%0*d%s%s",
 			a_rotater->num_width, a_file->index,
-			a_rotater->glob_path + a_rotater->num_end_len);
+			a_rotater->glob_path + a_rotater->num_end_len, a_file->suffix);
 		if (nwrite < 0 ||
 			nwrite + a_rotater->num_start_len >= sizeof(old_path)) {
 			zc_error("nwirte[%d], overflow or errno[%d]",
@@ -300,9 +990,9 @@ static int zlog_rotater_roll_files(zlog_rotater_t * a_rotater,
 
 		/* begin rename aa.01.log -> aa.02.log , using i, as index in list maybe repeat */
 		nwrite = snprintf(new_path + a_rotater->num_start_len,
-			sizeof(new_path) - a_rotater->num_start_len, "%0*d%s",
+			sizeof(new_path) - a_rotater->num_start_len, "%0*d%s%s",
 			a_rotater->num_width, i + 1,
-			a_rotater->glob_path + a_rotater->num_end_len);
+			a_rotater->glob_path + a_rotater->num_end_len, a_file->suffix);
 		if (nwrite < 0 ||
 			nwrite + a_rotater->num_start_len >= sizeof(new_path)) {
 			zc_error("nwirte[%d], overflow or errno[%d]",
@@ -314,6 +1004,7 @@ static int zlog_rotater_roll_files(zlog_rotater_t * a_rotater,
 			zc_error("rename[%s]->[%s] fail, errno[%d]", old_path, new_path, errno);
 			return -1;
 		}
+		a_file->index = i + 1;
 	}
 
 mv_base_path:
@@ -345,8 +1036,12 @@ mv_base_path:
 	dup2(fd, *orig_fd);
 	close(fd);
 
+	if (a_rotater->compress_worker && zlog_rotater_zip(a_rotater, new_path)) {
+		zc_error("zlog_rotater_zip[%s] fail, left uncompressed", new_path);
+	}
+
 	if (!a_rotater->files || a_rotater->max_count <= 0) {
-		return 0;
+		goto add_index;
 	}
 
 	for (i = zc_arraylist_len(a_rotater->files) - 1; i > max_idx; i--) {
@@ -357,9 +1052,9 @@ mv_base_path:
 		}
 
 		nwrite = snprintf(old_path + a_rotater->num_start_len,
-			sizeof(old_path) - a_rotater->num_start_len, "%0*d%s",
+			sizeof(old_path) - a_rotater->num_start_len, "%0*d%s%s",
 			a_rotater->num_width, a_file->index,
-			a_rotater->glob_path + a_rotater->num_end_len);
+			a_rotater->glob_path + a_rotater->num_end_len, a_file->suffix);
 		if (nwrite < 0 ||
 			nwrite + a_rotater->num_start_len >= sizeof(old_path)) {
 			zc_error("nwirte[%d], overflow or errno[%d]",
@@ -374,6 +1069,24 @@ mv_base_path:
 		}
 	}
 
+	/* the one at max_idx is overwritten by the last rename, if it has the same name */
+	a_file = zc_arraylist_get(a_rotater->files, max_idx);
+	if (a_file) {
+		zlog_file_t *a_prev = max_idx > 0 ? zc_arraylist_get(a_rotater->files, max_idx - 1) : NULL;
+		if (a_file->index != max_idx
+			|| STRCMP(a_file->suffix, !=, a_prev ? a_prev->suffix : "")) {
+			zlog_archive_index_forget(a_rotater->index);
+		}
+	}
+	for (i = zc_arraylist_len(a_rotater->files) - 1; i >= max_idx; i--) {
+		zc_arraylist_remove(a_rotater->files, i);
+	}
+
+add_index:
+	if (zlog_rotater_index_add(a_rotater, new_path, 0)) {
+		zlog_archive_index_forget(a_rotater->index);
+	}
+
 	return 0;
 }
 
@@ -464,28 +1177,53 @@ static void zlog_rotater_clean(zlog_rotater_t *a_rotater)
 	a_rotater->num_width = 0;
 	a_rotater->num_start_len = 0;
 	a_rotater->num_end_len = 0;
-
-	if (a_rotater->files) {
-		zc_arraylist_del(a_rotater->files);
-		a_rotater->files = NULL;
-	}
+	a_rotater->max_total = 0;
+	a_rotater->max_age = 0;
+	a_rotater->compress_worker = NULL;
+	a_rotater->prune_worker = NULL;
+
+	/* files stay in index for next time */
+	a_rotater->files = NULL;
+	a_rotater->index = NULL;
 }
 
 static int zlog_rotater_lsmv(zlog_rotater_t *a_rotater,
 		char *base_path, char *archive_path, int archive_max_count,
-		int file_open_flags, unsigned int file_perms, int *orig_fd)
+		size_t archive_max_total, long archive_max_age,
+		int file_open_flags, unsigned int file_perms, int *orig_fd,
+		zlog_worker_t *compress_worker, zlog_worker_t *prune_worker)
 {
 	int rc = 0;
+	zlog_archive_dir_t *base_dir = NULL;
 
 	a_rotater->base_path = base_path;
 	a_rotater->archive_path = archive_path;
 	a_rotater->max_count = archive_max_count;
+	a_rotater->max_total = archive_max_total;
+	a_rotater->max_age = archive_max_age;
+	a_rotater->compress_worker = compress_worker;
+	a_rotater->prune_worker = prune_worker;
 	rc = zlog_rotater_parse_archive_path(a_rotater);
 	if (rc) {
 		zc_error("zlog_rotater_parse_archive_path fail");
 		goto err;
 	}
 
+	a_rotater->index = zlog_archive_index_get(a_rotater, a_rotater->glob_path);
+	if (!a_rotater->index) {
+		zc_error("zlog_archive_index_get fail");
+		goto err;
+	}
+
+	/* base file is moved out of its dir too */
+	base_dir = zlog_archive_dir_get(a_rotater, base_path);
+	if (!base_dir) {
+		zc_error("zlog_archive_dir_get fail");
+		goto err;
+	}
+	zlog_archive_dir_begin(a_rotater->index->dir);
+	if (base_dir != a_rotater->index->dir) zlog_archive_dir_begin(base_dir);
+
 	rc = zlog_rotater_add_archive_files(a_rotater);
 	if (rc) {
 		zc_error("zlog_rotater_add_archive_files fail");
@@ -506,9 +1244,22 @@ static int zlog_rotater_lsmv(zlog_rotater_t *a_rotater,
 		}
 	}
 
+	if (zlog_rotater_prune(a_rotater)) {
+		zc_error("zlog_rotater_prune fail");
+	}
+	zlog_archive_index_use(a_rotater, base_dir);
+
+	zlog_archive_dir_end(a_rotater->index->dir);
+	if (base_dir != a_rotater->index->dir) zlog_archive_dir_end(base_dir);
 	zlog_rotater_clean(a_rotater);
 	return 0;
 err:
+	if (base_dir) {
+		/* half done, list again next time */
+		zlog_archive_index_forget(a_rotater->index);
+		zlog_archive_dir_end(a_rotater->index->dir);
+		if (base_dir != a_rotater->index->dir) zlog_archive_dir_end(base_dir);
+	}
 	zlog_rotater_clean(a_rotater);
 	return -1;
 }
@@ -518,13 +1269,14 @@ static int zlog_rotater_trylock(zlog_rotater_t *a_rotater)
 {
 	struct flock fl;
 
-	if (!a_rotater->lock_file)
-		return 0;
-
+	/* also taken by compress job, for rotater without lock file */
 	if (!ATOM_CASB(&(a_rotater->is_rotating), 0, 1)) {
 		return -1;
 	}
 
+	if (!a_rotater->lock_file)
+		return 0;
+
 	fl.l_type = F_WRLCK;
 	fl.l_start = 0;
 	fl.l_whence = SEEK_SET;
@@ -548,13 +1300,40 @@ static int zlog_rotater_trylock(zlog_rotater_t *a_rotater)
 	return 0;
 }
 
+/* wait for the lock, only used in background */
+static int zlog_rotater_lock(zlog_rotater_t *a_rotater)
+{
+	struct flock fl;
+
+	while (!ATOM_CASB(&(a_rotater->is_rotating), 0, 1)) {
+		usleep(1000);
+	}
+
+	if (!a_rotater->lock_file)
+		return 0;
+
+	fl.l_type = F_WRLCK;
+	fl.l_start = 0;
+	fl.l_whence = SEEK_SET;
+	fl.l_len = 0;
+
+	while (fcntl(a_rotater->lock_fd, F_SETLKW, &fl)) {
+		if (errno == EINTR) continue;
+		zc_error("lock fd[%d] fail, errno[%d]", a_rotater->lock_fd, errno);
+		ATOM_CASB(&(a_rotater->is_rotating), 1, 0);
+		return -1;
+	}
+
+	return 0;
+}
+
 static int zlog_rotater_unlock(zlog_rotater_t *a_rotater)
 {
 	int rc = 0;
 	struct flock fl;
 
 	if (!a_rotater->lock_file)
-		return 0;
+		goto exit;
 
 	fl.l_type = F_UNLCK;
 	fl.l_start = 0;
@@ -563,9 +1342,10 @@ static int zlog_rotater_unlock(zlog_rotater_t *a_rotater)
 
 	if (fcntl(a_rotater->lock_fd, F_SETLK, &fl)) {
 		rc = -1;
-		zc_error("unlock fd[%s] fail, errno[%d]", a_rotater->lock_fd, errno);
+		zc_error("unlock fd[%d] fail, errno[%d]", a_rotater->lock_fd, errno);
 	}
 
+exit:
 	if (!ATOM_CASB(&(a_rotater->is_rotating), 1, 0)) {
 		rc = -1;
 	}
@@ -577,9 +1357,13 @@ int zlog_rotater_rotate(zlog_rotater_t *a_rotater,
 						char *base_path,
 						char *archive_path,
 						int archive_max_count,
+						size_t archive_max_total,
+						long archive_max_age,
 						int file_open_flags,
 						unsigned int file_perms,
-						int *orig_fd)
+						int *orig_fd,
+						zlog_worker_t *compress_worker,
+						zlog_worker_t *prune_worker)
 {
 	int rc = 0;
 
@@ -592,7 +1376,8 @@ int zlog_rotater_rotate(zlog_rotater_t *a_rotater,
 
 	/* begin list and move files */
 	rc = zlog_rotater_lsmv(a_rotater, base_path, archive_path, archive_max_count,
-		file_open_flags, file_perms, orig_fd);
+		archive_max_total, archive_max_age,
+		file_open_flags, file_perms, orig_fd, compress_worker, prune_worker);
 	if (rc) {
 		zc_error("zlog_rotater_lsmv [%s] fail, return", base_path);
 		rc = -1;
@@ -603,7 +1388,86 @@ int zlog_rotater_rotate(zlog_rotater_t *a_rotater,
 		zc_error("zlog_rotater_unlock fail");
 	}
 
+	/* its tick prunes from now on, also in a forked child */
+	if (prune_worker && zlog_worker_start(prune_worker)) {
+		zc_error("zlog_worker_start fail");
+	}
+
 	return rc;
 }
 
 /*******************************************************************************/
+/* between rotations, so a quiet log still ages out */
+static void zlog_rotater_prune_index(zlog_rotater_t *a_rotater, zlog_archive_index_t *a_index)
+{
+	a_rotater->base_path = a_index->base_path;
+	snprintf(a_rotater->glob_path, sizeof(a_rotater->glob_path), "%s", a_index->glob_path);
+	a_rotater->num_start_len = a_index->num_start_len;
+	a_rotater->num_end_len = a_index->num_end_len;
+	a_rotater->num_width = a_index->num_width;
+	a_rotater->mv_type = a_index->mv_type;
+	a_rotater->max_total = a_index->max_total;
+	a_rotater->max_age = a_index->max_age;
+	a_rotater->index = a_index;
+
+	/* we are in a worker thread, victims are unlinked in place */
+	zlog_archive_dir_begin(a_index->dir);
+	if (zlog_rotater_add_archive_files(a_rotater)) {
+		zc_error("zlog_rotater_add_archive_files fail");
+	} else if (zlog_rotater_prune(a_rotater)) {
+		zc_error("zlog_rotater_prune fail");
+	}
+	zlog_archive_dir_end(a_index->dir);
+	zlog_rotater_clean(a_rotater);
+}
+
+void zlog_rotater_tick(zlog_worker_t *a_worker, void *arg)
+{
+	time_t now;
+	zlog_rotater_t *a_rotater = arg;
+	zlog_archive_index_t *a_index;
+	zlog_archive_dir_t *a_dir;
+	zc_hashtable_entry_t *a_entry;
+	zc_hashtable_entry_t *next;
+
+	/* rotating now, next tick */
+	if (zlog_rotater_trylock(a_rotater)) return;
+
+	now = time(NULL);
+	if (a_rotater->indexes) {
+		for (a_entry = zc_hashtable_begin(a_rotater->indexes); a_entry; a_entry = next) {
+			next = zc_hashtable_next(a_rotater->indexes, a_entry);
+			a_index = a_entry->value;
+			if (zlog_worker_is_stopping(a_worker)) break;
+
+			if (a_index->max_total || a_index->max_age > 0) {
+				zlog_rotater_prune_index(a_rotater, a_index);
+			}
+
+			/* not rotated for long, its log is gone or quiet, list it again if back */
+			if (ATOM_ADD_F(&(a_index->refs), 0) == 0
+				&& a_index->used + (a_index->max_age > 0 ?
+					a_index->max_age : ZLOG_ARCHIVE_IDLE) <= now) {
+				zc_hashtable_remove(a_rotater->indexes, a_index->glob_path);
+			}
+		}
+	}
+
+	if (a_rotater->dirs) {
+		for (a_entry = zc_hashtable_begin(a_rotater->dirs); a_entry; a_entry = next) {
+			next = zc_hashtable_next(a_rotater->dirs, a_entry);
+			a_dir = a_entry->value;
+
+			if (a_dir->refs == 0 && a_dir->used + ZLOG_ARCHIVE_IDLE <= now) {
+				zc_hashtable_remove(a_rotater->dirs, a_dir->path);
+			}
+		}
+	}
+
+	if (zlog_rotater_unlock(a_rotater)) {
+		zc_error("zlog_rotater_unlock fail");
+	}
+	return;
+}
+
+/*******************************************************************************/
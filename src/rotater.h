@@ -13,6 +13,11 @@
 #include "rotater_head.h"
 
 /*
+ * compress_worker, if not NULL, compresses the new archive in background
+ * archive_max_total (bytes) and archive_max_age (seconds), if not 0, prune
+ * the oldest archives, prune_worker, if not NULL, deletes them in background,
+ * and is started to tick for zlog_rotater_tick()
+ *
  * return
  * -1	fail
  * 0	no rotate, or rotate and success
@@ -21,9 +26,18 @@ int zlog_rotater_rotate(zlog_rotater_t *a_rotater,
 						char *base_path,
 						char *archive_path,
 						int archive_max_count,
+						size_t archive_max_total,
+						long archive_max_age,
 						int file_open_flags,
 						unsigned int file_perms,
-						int *orig_fd);
+						int *orig_fd,
+						zlog_worker_t *compress_worker,
+						zlog_worker_t *prune_worker);
+
+/* tick of the prune worker, applies max total and max age of archives
+ * between rotations, and forgets archives of logs not rotated for long
+ */
+void zlog_rotater_tick(zlog_worker_t *a_worker, void *arg);
 
 void zlog_rotater_profile(zlog_rotater_t *a_rotater, int flag);
 
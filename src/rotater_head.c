@@ -22,6 +22,18 @@ void zlog_rotater_del(zlog_rotater_t *a_rotater)
 {
 	zc_assert(a_rotater,);
 
+	/* a compress job still uses the lock */
+	if (ATOM_SUB_F(&(a_rotater->refs), 1) > 0) {
+		return;
+	}
+
+	if (a_rotater->indexes) {
+		zc_hashtable_del(a_rotater->indexes);
+	}
+	if (a_rotater->dirs) {
+		zc_hashtable_del(a_rotater->dirs);
+	}
+
 	if (a_rotater->lock_file) {
 		if (a_rotater->lock_fd) {
 			if (close(a_rotater->lock_fd)) {
@@ -49,6 +61,7 @@ zlog_rotater_t *zlog_rotater_new(char *lock_file)
 		zc_error("calloc fail, errno[%d]", errno);
 		return NULL;
 	}
+	a_rotater->refs = 1;
 
 	if (!lock_file) {
 		/* no need lock */
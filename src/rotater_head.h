@@ -10,12 +10,19 @@
 #define __zlog_rotater_head_h
 
 #include "zc_defs.h"
+#include "worker.h"
+
+struct zlog_archive_index_s;
 
 typedef struct zlog_rotater_s {
 	pthread_mutex_t lock_mutex;
 	char *lock_file;
 	int lock_fd;
 	volatile int is_rotating;
+	int refs;				/* held by pending compress jobs too */
+	zc_hashtable_t *indexes;		/* glob_path -> archives, kept between rotations */
+	zc_hashtable_t *dirs;			/* dir -> mtime after our last change */
+	unsigned long nhidden;			/* names pruned archives apart */
 
 	/* single-use members */
 	char *base_path;			/* aa.log */
@@ -26,7 +33,12 @@ typedef struct zlog_rotater_s {
 	int num_width;				/* 5 */
 	int mv_type;				/* ROLLING or SEQUENCE */
 	int max_count;
-	zc_arraylist_t *files;
+	size_t max_total;			/* bytes of all archives, 0 no limit */
+	long max_age;				/* seconds, 0 no limit */
+	struct zlog_archive_index_s *index;
+	zc_arraylist_t *files;			/* owned by index */
+	zlog_worker_t *compress_worker;		/* NULL, no compress */
+	zlog_worker_t *prune_worker;		/* NULL, delete in place */
 } zlog_rotater_t;
 
 zlog_rotater_t *zlog_rotater_new(char *lock_file);
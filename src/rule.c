@@ -28,6 +28,8 @@
 #include "spec.h"
 #include "conf.h"
 #include "fname_fd.h"
+#include "zlogd.h"
+#include "rule_trie.h"
 
 #include "zc_defs.h"
 
@@ -38,7 +40,7 @@ void zlog_rule_profile(zlog_rule_t * a_rule, int flag)
 	zlog_spec_t *a_spec;
 
 	zc_assert(a_rule,);
-	zc_profile(flag, "---rule:[%p][%s%c%d]-[%d,%d][%s,%p,%d:%ld*%d~%s][%d][%d][%s:%s:%p];[%p]---",
+	zc_profile(flag, "---rule:[%p][%s%c%d]-[%d,%d][%s,%p,%d:%ld*%d<%ld,%lds~%s][%d][%d][%s:%s:%p];[%p]---",
 		a_rule,
 
 		a_rule->category,
@@ -54,6 +56,8 @@ void zlog_rule_profile(zlog_rule_t * a_rule, int flag)
 
 		a_rule->archive_max_size,
 		a_rule->archive_max_count,
+		(long)a_rule->archive_max_total,
+		a_rule->archive_max_age,
 		a_rule->archive_path,
 
 		a_rule->pipe_fd,
@@ -70,6 +74,16 @@ void zlog_rule_profile(zlog_rule_t * a_rule, int flag)
 			zlog_spec_profile(a_spec, flag);
 		}
 	}
+
+	if (a_rule->stream) zlog_stream_profile(a_rule->stream, flag);
+	if (a_rule->flight) zlog_flight_profile(a_rule->flight, flag);
+	if (a_rule->shm) zlog_shm_profile(a_rule->shm, flag);
+	if (a_rule->backtrace) zlog_backtrace_profile(a_rule->backtrace, flag);
+	if (a_rule->limit) zlog_limit_profile(a_rule->limit, flag);
+	if (a_rule->dedup) zlog_dedup_profile(a_rule->dedup, flag);
+	if (a_rule->syslog) zlog_syslog_profile(a_rule->syslog, flag);
+	if (a_rule->pipe) zlog_pipe_profile(a_rule->pipe, flag);
+	if (a_rule->socket) zlog_socket_profile(a_rule->socket, flag);
 	return;
 }
 
@@ -115,9 +129,16 @@ static int zlog_rule_check_reopen_static_file(zlog_rule_t * a_rule, zlog_thread_
 	int redo_inode_stat = 0;
 	struct timeval time_stamp;
 
-	gettimeofday(&time_stamp, NULL);
-	if (time_stamp.tv_sec - a_thread->event->time_local_sec < 1)
-		return 0;
+	/* told by the watcher, only a flag is read for each record */
+	if (a_rule->watcher && zlog_watcher_is_alive(a_rule->watcher)
+		&& a_rule->watch_state != ZLOG_WATCH_LOST) {
+		if (!ATOM_CASB(&(a_rule->watch_state), ZLOG_WATCH_CHANGED, ZLOG_WATCH_QUIET))
+			return 0;
+	} else {
+		gettimeofday(&time_stamp, NULL);
+		if (time_stamp.tv_sec - a_thread->event->time_local_sec < 1)
+			return 0;
+	}
 
 	if (stat(a_rule->file_path, &stb)) {
 		if (errno != ENOENT) {
@@ -170,6 +191,10 @@ err:
 	return rc;
 }
 
+/* a record kept by backtrace is in msg_buf already */
+#define zlog_rule_gen_msg(a_rule, a_thread) \
+	((a_thread)->msg_kept ? 0 : zlog_format_gen_msg((a_rule)->format, (a_thread)))
+
 static int zlog_rule_output_static_file_single(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
 {
 	/* check if the output file was changed by an external tool by comparing the
@@ -180,7 +205,7 @@ static int zlog_rule_output_static_file_single(zlog_rule_t * a_rule, zlog_thread
 		return -1;
 	}
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
@@ -228,7 +253,7 @@ static int zlog_rule_output_static_file_rotate(zlog_rule_t * a_rule, zlog_thread
 	size_t len;
 	struct zlog_stat info;
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
@@ -267,9 +292,14 @@ static int zlog_rule_output_static_file_rotate(zlog_rule_t * a_rule, zlog_thread
 							a_rule->file_path,
 							zlog_rule_gen_archive_path(a_rule, a_thread),
 							a_rule->archive_max_count,
+							a_rule->archive_max_total,
+							a_rule->archive_max_age,
 							a_rule->file_open_flags,
 							a_rule->file_perms,
-							&(a_rule->static_fd))
+							&(a_rule->static_fd),
+							zlog_env_conf->archive_compress ?
+								zlog_env_conf->archive_worker : NULL,
+							zlog_env_conf->archive_worker)
 		) {
 		zc_error("zlog_rotater_rotate fail");
 		return -1;
@@ -283,6 +313,64 @@ static int zlog_rule_output_static_file_rotate(zlog_rule_t * a_rule, zlog_thread
 	return 0;
 }
 
+static int zlog_rule_output_static_file_stream(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
+{
+	struct zlog_stat info;
+
+	/* no rotate, so check if the file was moved away as the single one does */
+	if (a_rule->archive_max_size <= 0
+		&& zlog_rule_check_reopen_static_file(a_rule, a_thread)) {
+		zc_error("zlog_rule_check_reopen_static_file failed");
+		return -1;
+	}
+
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
+		zc_error("zlog_format_gen_msg fail");
+		return -1;
+	}
+
+	if (zlog_stream_write(a_rule->stream, a_thread,
+			zlog_buf_str(a_thread->msg_buf),
+			zlog_buf_len(a_thread->msg_buf),
+			!a_thread->msg_kept && a_thread->event->level >= a_rule->stream_flush_level)) {
+		zc_error("zlog_stream_write fail");
+		return -1;
+	}
+
+	/* file_size is grown by the stream writer, in bytes on disk */
+	if (a_rule->archive_max_size <= 0
+		|| a_rule->file_size < (size_t)a_rule->archive_max_size
+		|| zlog_env_conf->rotater->is_rotating) {
+		return 0;
+	}
+
+	ATOM_CASB(&(a_rule->file_size), a_rule->file_size, 0);
+
+	/* compressed blocks are not compressed again in archives */
+	if (zlog_rotater_rotate(zlog_env_conf->rotater,
+							a_rule->file_path,
+							zlog_rule_gen_archive_path(a_rule, a_thread),
+							a_rule->archive_max_count,
+							a_rule->archive_max_total,
+							a_rule->archive_max_age,
+							a_rule->file_open_flags,
+							a_rule->file_perms,
+							&(a_rule->static_fd),
+							(zlog_env_conf->archive_compress && !a_rule->stream_compress) ?
+								zlog_env_conf->archive_worker : NULL,
+							zlog_env_conf->archive_worker)
+		) {
+		zc_error("zlog_rotater_rotate fail");
+		return -1;
+	}
+
+	if (!stat(a_rule->file_path, &info)) {
+		ATOM_CASB(&(a_rule->file_size), a_rule->file_size, info.st_size);
+	}
+
+	return 0;
+}
+
 /* return path	success
  * return NULL	fail
  */
@@ -644,7 +732,7 @@ static int zlog_rule_output_dynamic_file_single(zlog_rule_t * a_rule, zlog_threa
 		return -1;
 	}
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_output fail");
 		return -1;
 	}
@@ -683,7 +771,7 @@ static int zlog_rule_output_dynamic_file_rotate(zlog_rule_t * a_rule, zlog_threa
 
 	path = zlog_buf_str(a_thread->path_buf);
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_output fail");
 		return -1;
 	}
@@ -749,9 +837,14 @@ static int zlog_rule_output_dynamic_file_rotate(zlog_rule_t * a_rule, zlog_threa
 							path,
 							zlog_rule_gen_archive_path(a_rule, a_thread),
 							a_rule->archive_max_count,
+							a_rule->archive_max_total,
+							a_rule->archive_max_age,
 							a_rule->file_open_flags,
 							a_rule->file_perms,
-							&(a_fname_fd->fd))
+							&(a_fname_fd->fd),
+							zlog_env_conf->archive_compress ?
+								zlog_env_conf->archive_worker : NULL,
+							zlog_env_conf->archive_worker)
 		) {
 		zc_error("zlog_rotater_rotate fail");
 		return -1;
@@ -771,15 +864,15 @@ static int zlog_rule_output_dynamic_file_rotate(zlog_rule_t * a_rule, zlog_threa
 
 static int zlog_rule_output_pipe(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
 {
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
 
-	if (write(a_rule->pipe_fd,
+	if (zlog_pipe_write(a_rule->pipe,
 			zlog_buf_str(a_thread->msg_buf),
-			zlog_buf_len(a_thread->msg_buf)) < 0) {
-		zc_error("write fail, errno[%d]", errno);
+			zlog_buf_len(a_thread->msg_buf))) {
+		zc_error("zlog_pipe_write fail");
 		return -1;
 	}
 
@@ -790,20 +883,72 @@ static int zlog_rule_output_syslog(zlog_rule_t * a_rule, zlog_thread_t * a_threa
 {
 	zlog_level_t *a_level;
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
 
-	/*
-	msg = a_thread->msg_buf->start;
-	msg_len = a_thread->msg_buf->end - a_thread->msg_buf->start;
-	 */
-
+	/* the record as formatted, no printf again as libc syslog does */
 	a_level = zlog_level_list_get(zlog_env_conf->levels, a_thread->event->level);
-	zlog_buf_seal(a_thread->msg_buf);
-	syslog(a_rule->syslog_facility | a_level->syslog_level,
-		"%s",  zlog_buf_str(a_thread->msg_buf));
+	if (zlog_syslog_send(a_rule->syslog, a_rule->syslog_facility | a_level->syslog_level,
+			a_thread->event, zlog_buf_str(a_thread->msg_buf), zlog_buf_len(a_thread->msg_buf))) {
+		zc_error("zlog_syslog_send fail");
+		return -1;
+	}
+	return 0;
+}
+
+/* fields of the event as they are, %m is rendered already */
+static int zlog_rule_record_event(zlog_rule_t * a_rule, zlog_thread_t * a_thread, zlog_msg_t * msg)
+{
+	zlog_event_t *a_event = a_thread->event;
+	zlog_level_t *a_level;
+	zlog_record_event_t ev;
+
+	if (a_thread->msg_kept) {
+		if (a_rule->record_event_func(msg, NULL)) {
+			zc_error("a_rule->record fail");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!a_event->time_stamp.tv_sec) {
+		gettimeofday(&(a_event->time_stamp), NULL);
+	}
+	a_level = zlog_level_list_get(zlog_env_conf->levels, a_event->level);
+
+	ev.category = a_event->category_name;
+	ev.category_len = a_event->category_name_len;
+	ev.level = a_event->level;
+	ev.level_name = a_level->str_uppercase;
+	ev.time_sec = (long)a_event->time_stamp.tv_sec;
+	ev.time_usec = (long)a_event->time_stamp.tv_usec;
+	ev.file = a_event->file;
+	ev.file_len = a_event->file_len;
+	ev.func = a_event->func;
+	ev.func_len = a_event->func_len;
+	ev.line = a_event->line;
+	ev.pid = (long)a_event->pid;
+	ev.tid = (unsigned long)a_event->tid;
+	ev.ktid = (long)a_event->ktid;
+	ev.host = a_event->host_name;
+	ev.host_len = a_event->host_name_len;
+	if (a_event->generate_cmd == ZLOG_KV) {
+		ev.usr_msg = a_event->str_format ? a_event->str_format : "";
+		ev.usr_msg_len = strlen(ev.usr_msg);
+	} else {
+		zlog_buf_seal(a_thread->usr_msg_buf);
+		ev.usr_msg = zlog_buf_str(a_thread->usr_msg_buf);
+		ev.usr_msg_len = zlog_buf_len(a_thread->usr_msg_buf);
+	}
+	ev.fields = a_event->fields;
+	ev.field_count = a_event->field_count;
+
+	if (a_rule->record_event_func(msg, &ev)) {
+		zc_error("a_rule->record fail");
+		return -1;
+	}
 	return 0;
 }
 
@@ -811,13 +956,20 @@ static int zlog_rule_output_static_record(zlog_rule_t * a_rule, zlog_thread_t *
 {
 	zlog_msg_t msg;
 
-	if (!a_rule->record_func) {
+	if (!a_rule->record_func && !a_rule->record_event_func && !a_rule->record_batch) {
 		zc_error("user defined record funcion for [%s] not set, no output",
 			a_rule->record_name);
 		return -1;
 	}
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	/* once for the format and the callback */
+	if (a_rule->record_event_func && !a_thread->msg_kept
+		&& zlog_spec_gen_usrmsg(a_thread)) {
+		zc_error("zlog_spec_gen_usrmsg fail");
+		return -1;
+	}
+
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
@@ -827,6 +979,13 @@ static int zlog_rule_output_static_record(zlog_rule_t * a_rule, zlog_thread_t *
 	msg.len = zlog_buf_len(a_thread->msg_buf);
 	msg.path = a_rule->record_path;
 
+	if (a_rule->record_batch) {
+		return zlog_batch_write(a_rule->record_batch, &msg);
+	}
+	if (a_rule->record_event_func) {
+		return zlog_rule_record_event(a_rule, a_thread, &msg);
+	}
+
 	if (a_rule->record_func(&msg)) {
 		zc_error("a_rule->record fail");
 		return -1;
@@ -838,7 +997,7 @@ static int zlog_rule_output_dynamic_record(zlog_rule_t * a_rule, zlog_thread_t *
 {
 	zlog_msg_t msg;
 
-	if (!a_rule->record_func) {
+	if (!a_rule->record_func && !a_rule->record_event_func && !a_rule->record_batch) {
 		zc_error("user defined record funcion for [%s] not set, no output",
 			a_rule->record_name);
 		return -1;
@@ -846,7 +1005,14 @@ static int zlog_rule_output_dynamic_record(zlog_rule_t * a_rule, zlog_thread_t *
 
 	zlog_rule_gen_path(a_rule, a_thread);
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	/* once for the format and the callback */
+	if (a_rule->record_event_func && !a_thread->msg_kept
+		&& zlog_spec_gen_usrmsg(a_thread)) {
+		zc_error("zlog_spec_gen_usrmsg fail");
+		return -1;
+	}
+
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
@@ -856,6 +1022,13 @@ static int zlog_rule_output_dynamic_record(zlog_rule_t * a_rule, zlog_thread_t *
 	msg.len = zlog_buf_len(a_thread->msg_buf);
 	msg.path = zlog_buf_str(a_thread->path_buf);
 
+	if (a_rule->record_batch) {
+		return zlog_batch_write(a_rule->record_batch, &msg);
+	}
+	if (a_rule->record_event_func) {
+		return zlog_rule_record_event(a_rule, a_thread, &msg);
+	}
+
 	if (a_rule->record_func(&msg)) {
 		zc_error("a_rule->record fail");
 		return -1;
@@ -867,7 +1040,7 @@ static int zlog_rule_output_stdout(zlog_rule_t * a_rule,
 				   zlog_thread_t * a_thread)
 {
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
@@ -881,11 +1054,79 @@ static int zlog_rule_output_stdout(zlog_rule_t * a_rule,
 	return 0;
 }
 
+static int zlog_rule_output_shm(zlog_rule_t * a_rule,
+				   zlog_thread_t * a_thread)
+{
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
+		zc_error("zlog_format_gen_msg fail");
+		return -1;
+	}
+
+	zlog_shm_write(a_rule->shm,
+		zlog_buf_str(a_thread->msg_buf), zlog_buf_len(a_thread->msg_buf));
+	return 0;
+}
+
+static int zlog_rule_output_socket(zlog_rule_t * a_rule,
+				   zlog_thread_t * a_thread)
+{
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
+		zc_error("zlog_format_gen_msg fail");
+		return -1;
+	}
+
+	if (zlog_socket_write(a_rule->socket,
+			zlog_buf_str(a_thread->msg_buf), zlog_buf_len(a_thread->msg_buf))) {
+		zc_error("zlog_socket_write fail");
+		return -1;
+	}
+	return 0;
+}
+
+static int zlog_rule_output_zlogd(zlog_rule_t * a_rule,
+				   zlog_thread_t * a_thread)
+{
+	char tag[ZLOGD_TAG_MAX];
+	size_t n;
+
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
+		zc_error("zlog_format_gen_msg fail");
+		return -1;
+	}
+
+	n = a_thread->event->category_name_len;
+	if (n > 255) n = 255;
+	tag[0] = (char)a_thread->event->level;
+	tag[1] = (char)n;
+	memcpy(tag + 2, a_thread->event->category_name, n);
+
+	if (zlog_socket_write_tagged(a_rule->socket, tag, 2 + n,
+			zlog_buf_str(a_thread->msg_buf), zlog_buf_len(a_thread->msg_buf))) {
+		zc_error("zlog_socket_write_tagged fail");
+		return -1;
+	}
+	return 0;
+}
+
+static int zlog_rule_output_flight(zlog_rule_t * a_rule,
+				   zlog_thread_t * a_thread)
+{
+
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
+		zc_error("zlog_format_gen_msg fail");
+		return -1;
+	}
+
+	zlog_flight_write(a_rule->flight,
+		zlog_buf_str(a_thread->msg_buf), zlog_buf_len(a_thread->msg_buf));
+	return 0;
+}
+
 static int zlog_rule_output_stderr(zlog_rule_t * a_rule,
 				   zlog_thread_t * a_thread)
 {
 
-	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+	if (zlog_rule_gen_msg(a_rule, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
@@ -930,6 +1171,222 @@ static int syslog_facility_atoi(char *facility)
 	return -187;
 }
 
+/* options are [key] or [key=value], split by space or comma
+ * compress		write compressed blocks
+ * buffer=256KB		size of a block, records are written by blocks
+ * buffer_scope=rule	one block for all threads, or thread, one for each few
+ * flush=1s		write a block which is not full after this time
+ * flush_level=ERROR	write at once after a record of this level, with all before it
+ * backtrace=100		keep the last records below backtrace_level in memory
+ * backtrace_level=ERROR	write the kept records ahead of a record of this level
+ * rate=100/s		drop records over this rate, checked before they are formatted
+ * burst=200		records which may go at once, a second of rate by default
+ * rate_scope=rule	one limit for the rule, or category, or site, of each file and line
+ * rate_report=10s	write how many were dropped at most this often, 0 never
+ * dedup=5s		count a record equal to the last one in this time, write it then
+ * syslog_socket=/dev/log	where >syslog sends to
+ * syslog_format=rfc3164	header of >syslog records, or rfc5424
+ * syslog_ident=app	name in the header, the program name by default
+ * syslog_drop		drop records when the daemon is behind, do not wait
+ * pipe_buffer=1MB	records wait here when the pipe is full, the writer goes on
+ * pipe_full=block	when the buffer is full too, wait, or drop, or spill
+ * pipe_spill=aa.spill	file a record is appended to when spilled
+ * pipe_size=1MB		ask the kernel for a pipe of this size, linux only
+ * socket_framing=newline	records of >socket as they are, or length, each after its length
+ * socket_backlog=4MB	records wait here for the peer, dropped when it is full
+ * archive_max_total=1GB	remove the oldest archives when all of them are larger
+ * archive_max_age=7d	remove archives older than this, at rotation and between them
+ */
+static int zlog_rule_parse_options(zlog_rule_t * a_rule, char *options, zc_arraylist_t * levels)
+{
+	char *key;
+	char *value;
+	char *saveptr = NULL;
+
+	for (key = strtok_r(options, " \t,", &saveptr); key;
+		key = strtok_r(NULL, " \t,", &saveptr)) {
+		value = strchr(key, '=');
+		if (value) *value++ = '\0';
+
+		if (STRCMP(key, ==, "compress")) {
+			a_rule->stream_compress = 1;
+			a_rule->stream_buffered = 1;
+			continue;
+		}
+		if (STRCMP(key, ==, "syslog_drop")) {
+			a_rule->syslog_drop = 1;
+			continue;
+		}
+
+		if (!value || *value == '\0') {
+			zc_error("rule option[%s] needs a value, or is unknown", key);
+			return -1;
+		}
+
+		if (STRCMP(key, ==, "buffer")) {
+			a_rule->stream_buffered = 1;
+			a_rule->stream_block_size = zc_parse_byte_size(value);
+			if (a_rule->stream_block_size == 0) {
+				zc_error("buffer[%s] should be > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "buffer_scope")) {
+			a_rule->stream_buffered = 1;
+			if (STRCMP(value, ==, "rule")) {
+				a_rule->stream_lanes = 1;
+			} else if (STRCMP(value, ==, "thread")) {
+				a_rule->stream_lanes = ZLOG_STREAM_THREAD_LANES;
+			} else {
+				zc_error("buffer_scope[%s] should be rule or thread", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "flush")) {
+			a_rule->stream_buffered = 1;
+			a_rule->stream_flush_period = zc_parse_duration_ms(value);
+			if (a_rule->stream_flush_period <= 0) {
+				zc_error("flush[%s] should be a duration > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "flush_level")) {
+			a_rule->stream_buffered = 1;
+			a_rule->stream_flush_level = zlog_level_list_atoi(levels, value);
+			if (a_rule->stream_flush_level < 0) {
+				zc_error("flush_level[%s] is not a level", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "backtrace")) {
+			a_rule->backtrace_count = atol(value);
+			if ((long)a_rule->backtrace_count <= 0) {
+				zc_error("backtrace[%s] should be a count > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "backtrace_level")) {
+			a_rule->backtrace_level = zlog_level_list_atoi(levels, value);
+			if (a_rule->backtrace_level < 0) {
+				zc_error("backtrace_level[%s] is not a level", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "rate")) {
+			if (strlen(value) > sizeof(a_rule->rate) - 1) {
+				zc_error("rate[%s] is too long", value);
+				return -1;
+			}
+			strcpy(a_rule->rate, value);
+		} else if (STRCMP(key, ==, "burst")) {
+			a_rule->rate_burst = atol(value);
+			if (a_rule->rate_burst <= 0) {
+				zc_error("burst[%s] should be a count > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "rate_scope")) {
+			if (STRCMP(value, ==, "rule")) {
+				a_rule->rate_scope = ZLOG_LIMIT_RULE;
+			} else if (STRCMP(value, ==, "category")) {
+				a_rule->rate_scope = ZLOG_LIMIT_CATEGORY;
+			} else if (STRCMP(value, ==, "site")) {
+				a_rule->rate_scope = ZLOG_LIMIT_SITE;
+			} else {
+				zc_error("rate_scope[%s] should be rule, category or site", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "rate_report")) {
+			a_rule->rate_report_period = zc_parse_duration_ms(value);
+			if (a_rule->rate_report_period < 0) {
+				zc_error("rate_report[%s] should be a duration", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "dedup")) {
+			a_rule->dedup_window = zc_parse_duration_ms(value);
+			if (a_rule->dedup_window <= 0) {
+				zc_error("dedup[%s] should be a duration > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "pipe_buffer")) {
+			a_rule->pipe_buffer = zc_parse_byte_size(value);
+			if (a_rule->pipe_buffer == 0) {
+				zc_error("pipe_buffer[%s] should be > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "pipe_full")) {
+			if (STRCMP(value, ==, "block")) {
+				a_rule->pipe_full = ZLOG_PIPE_BLOCK;
+			} else if (STRCMP(value, ==, "drop")) {
+				a_rule->pipe_full = ZLOG_PIPE_DROP;
+			} else if (STRCMP(value, ==, "spill")) {
+				a_rule->pipe_full = ZLOG_PIPE_SPILL;
+			} else {
+				zc_error("pipe_full[%s] should be block, drop or spill", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "pipe_spill")) {
+			if (strlen(value) > sizeof(a_rule->pipe_spill) - 1) {
+				zc_error("pipe_spill[%s] is too long", value);
+				return -1;
+			}
+			strcpy(a_rule->pipe_spill, value);
+		} else if (STRCMP(key, ==, "pipe_size")) {
+			a_rule->pipe_size = zc_parse_byte_size(value);
+			if (a_rule->pipe_size == 0) {
+				zc_error("pipe_size[%s] should be > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "socket_framing")) {
+			if (STRCMP(value, ==, "newline")) {
+				a_rule->socket_framing = ZLOG_SOCKET_NEWLINE;
+			} else if (STRCMP(value, ==, "length")) {
+				a_rule->socket_framing = ZLOG_SOCKET_LENGTH;
+			} else {
+				zc_error("socket_framing[%s] should be newline or length", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "socket_backlog")) {
+			a_rule->socket_backlog = zc_parse_byte_size(value);
+			if (a_rule->socket_backlog == 0) {
+				zc_error("socket_backlog[%s] should be > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "syslog_socket")) {
+			if (strlen(value) > sizeof(a_rule->syslog_socket) - 1) {
+				zc_error("syslog_socket[%s] is too long", value);
+				return -1;
+			}
+			strcpy(a_rule->syslog_socket, value);
+		} else if (STRCMP(key, ==, "syslog_ident")) {
+			if (strlen(value) > sizeof(a_rule->syslog_ident) - 1) {
+				zc_error("syslog_ident[%s] is too long", value);
+				return -1;
+			}
+			strcpy(a_rule->syslog_ident, value);
+		} else if (STRCMP(key, ==, "syslog_format")) {
+			if (STRICMP(value, ==, "rfc3164")) {
+				a_rule->syslog_format = ZLOG_SYSLOG_RFC3164;
+			} else if (STRICMP(value, ==, "rfc5424")) {
+				a_rule->syslog_format = ZLOG_SYSLOG_RFC5424;
+			} else {
+				zc_error("syslog_format[%s] should be rfc3164 or rfc5424", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "archive_max_total")) {
+			a_rule->archive_max_total = zc_parse_byte_size(value);
+			if (a_rule->archive_max_total == 0) {
+				zc_error("archive_max_total[%s] should be > 0", value);
+				return -1;
+			}
+		} else if (STRCMP(key, ==, "archive_max_age")) {
+			a_rule->archive_max_age = zc_parse_duration_ms(value) / 1000;
+			if (a_rule->archive_max_age <= 0) {
+				zc_error("archive_max_age[%s] should be >= 1s", value);
+				return -1;
+			}
+		} else {
+			zc_error("unknown rule option[%s]", key);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 static int zlog_rule_parse_path(char *path_start, /* start with a " */
 		size_t path_size, char **path_str, zc_arraylist_t **path_specs,
 		int *time_cache_count, int *path_spec_flag)
@@ -1007,6 +1464,8 @@ zlog_rule_t *zlog_rule_new(char *line,
 						   size_t fsync_period,
 						   long archive_max_size,
 						   int archive_max_count,
+						   size_t archive_max_total,
+						   long archive_max_age,
 						   int * time_cache_count)
 {
 	int rc = 0;
@@ -1019,12 +1478,15 @@ zlog_rule_t *zlog_rule_new(char *line,
 
 	char *action;
 	char *output;
+	char *options = NULL;
 	char format_name[MAXLEN_CFG_NAME + 1];
 	char file_path[MAXLEN_PATH + 1];
 	char str_max_size[MAXLEN_CFG_NAME + 1];
+	char socket_addr[MAXLEN_PATH + 1];
 	char *file_limit;
 
 	char *p;
+	char *q;
 	int path_spec_flag;
 
 	zc_assert(line, NULL);
@@ -1046,6 +1508,14 @@ zlog_rule_t *zlog_rule_new(char *line,
 	a_rule->fsync_period = fsync_period;
 	a_rule->archive_max_size = archive_max_size;
 	a_rule->archive_max_count = archive_max_count;
+	a_rule->archive_max_total = archive_max_total;
+	a_rule->archive_max_age = archive_max_age;
+	a_rule->stream_block_size = ZLOG_STREAM_DEFAULT_BLOCK_SIZE;
+	a_rule->stream_flush_period = ZLOG_STREAM_DEFAULT_FLUSH;
+	a_rule->stream_lanes = 1;
+	a_rule->stream_flush_level = zlog_level_list_atoi(levels, "ERROR");
+	a_rule->backtrace_level = a_rule->stream_flush_level;
+	a_rule->rate_report_period = 10 * 1000;
 
 	/* line         [f.INFO "%H/log/aa.log", 20MB * 12; MyTemplate]
 	 * selector     [f.INFO]
@@ -1073,8 +1543,8 @@ zlog_rule_t *zlog_rule_new(char *line,
 
 	/* check and set category */
 	for (p = a_rule->category; *p != '\0'; p++) {
-		if ((!isalnum(*p)) && (*p != '_') && (*p != '-') && (*p != '*') && (*p != '!')) {
-			zc_error("category name[%s] character is not in [a-Z][0-9][_!*-]", a_rule->category);
+		if ((!isalnum(*p)) && (*p != '_') && (*p != '-') && (*p != '*') && (*p != '?') && (*p != '!')) {
+			zc_error("category name[%s] character is not in [a-Z][0-9][_!*?-]", a_rule->category);
 			goto err;
 		}
 	}
@@ -1127,23 +1597,33 @@ zlog_rule_t *zlog_rule_new(char *line,
 		break;
 	}
 
-	/* action               ["%H/log/aa.log", 20MB * 12 ; MyTemplate]
+	/* action               ["%H/log/aa.log", 20MB * 12 ; MyTemplate ; compress]
 	 * output               ["%H/log/aa.log", 20MB * 12]
 	 * format               [MyTemplate]
+	 * options              [compress]
 	 */
 	nread = 0;
 	format_name[0] = '\0';
 	p = strrchr(action, ';');
 	if (p) {
-		nscan = sscanf(action, " %*[^;];%n%s", &nread, format_name);
+		nscan = sscanf(action, " %*[^;];%n", &nread);
 		if (nread == 0) {
 			zc_error("sscanf [%s] fail", action);
 			goto err;
 		}
 		action[nread - 1] = '\0';
+
+		options = strchr(action + nread, ';');
+		if (options) *options++ = '\0';
+		sscanf(action + nread, " %s", format_name);
 	}
 	output = action;
 
+	if (options && zlog_rule_parse_options(a_rule, options, levels)) {
+		zc_error("zlog_rule_parse_options fail");
+		goto err;
+	}
+
 	/* check and get format */
 	if (STRCMP(format_name, ==, "")) {
 		zc_debug("no format specified, use default");
@@ -1241,6 +1721,12 @@ zlog_rule_t *zlog_rule_new(char *line,
 
 		/* try to figure out if the log file path is dynamic or static */
 		if (a_rule->dynamic_specs) {
+			if (a_rule->stream_buffered) {
+				zc_error("compress and buffer are only for a static file path, [%s]",
+					a_rule->file_path);
+				goto err;
+			}
+
 			if (a_rule->archive_max_size <= 0) {
 				a_rule->output = zlog_rule_output_dynamic_file_single;
 			} else {
@@ -1249,7 +1735,9 @@ zlog_rule_t *zlog_rule_new(char *line,
 		} else {
 			struct zlog_stat stb;
 
-			if (a_rule->archive_max_size <= 0) {
+			if (a_rule->stream_buffered) {
+				a_rule->output = zlog_rule_output_static_file_stream;
+			} else if (a_rule->archive_max_size <= 0) {
 				a_rule->output = zlog_rule_output_static_file_single;
 			} else {
 				/* as rotate, so need to reopen everytime */
@@ -1272,6 +1760,18 @@ zlog_rule_t *zlog_rule_new(char *line,
 			}
 			a_rule->static_dev = stb.st_dev;
 			a_rule->static_ino = stb.st_ino;
+
+			if (a_rule->stream_buffered) {
+				a_rule->file_size = stb.st_size;
+				a_rule->stream = zlog_stream_new(a_rule->file_path,
+					&(a_rule->static_fd), &(a_rule->file_size),
+					a_rule->stream_block_size, a_rule->stream_flush_period,
+					a_rule->stream_compress, a_rule->stream_lanes);
+				if (!a_rule->stream) {
+					zc_error("zlog_stream_new fail");
+					goto err;
+				}
+			}
 		}
 		break;
 	case '|' :
@@ -1285,6 +1785,16 @@ zlog_rule_t *zlog_rule_new(char *line,
 			zc_error("fileno fail, errno[%d]", errno);
 			goto err;
 		}
+		if (a_rule->pipe_full == ZLOG_PIPE_SPILL && a_rule->pipe_spill[0] == '\0') {
+			zc_error("pipe_full=spill needs a pipe_spill file, [%s]", output);
+			goto err;
+		}
+		a_rule->pipe = zlog_pipe_new(a_rule->pipe_fd, a_rule->pipe_buffer,
+			a_rule->pipe_full, a_rule->pipe_spill, a_rule->file_perms, a_rule->pipe_size);
+		if (!a_rule->pipe) {
+			zc_error("zlog_pipe_new fail");
+			goto err;
+		}
 		a_rule->output = zlog_rule_output_pipe;
 		break;
 	case '>' :
@@ -1294,15 +1804,118 @@ zlog_rule_t *zlog_rule_new(char *line,
 				zc_error("-187 get");
 				goto err;
 			}
+			a_rule->syslog = zlog_syslog_new(a_rule->syslog_socket, a_rule->syslog_ident,
+				a_rule->syslog_format, a_rule->syslog_drop);
+			if (!a_rule->syslog) {
+				zc_error("zlog_syslog_new fail");
+				goto err;
+			}
 			a_rule->output = zlog_rule_output_syslog;
-			openlog(NULL, LOG_NDELAY | LOG_NOWAIT | LOG_PID, LOG_USER);
 		} else if (STRNCMP(file_path + 1, ==, "stdout", 6)) {
 			a_rule->output = zlog_rule_output_stdout;
 		} else if (STRNCMP(file_path + 1, ==, "stderr", 6)) {
 			a_rule->output = zlog_rule_output_stderr;
+		} else if (STRNCMP(file_path + 1, ==, "flight", 6)) {
+			/* >flight "aa.ring", 64MB */
+			p = strchr(file_path, '"');
+			if (!p) {
+				zc_error("flight path not start with \", [%s]", file_path);
+				goto err;
+			}
+			memmove(file_path, p, strlen(p) + 1);
+			rc = zlog_rule_parse_path(file_path, sizeof(file_path),
+				&(a_rule->file_path), &(a_rule->dynamic_specs),
+				time_cache_count, &(path_spec_flag));
+			if (rc) {
+				zc_error("zlog_rule_parse_path fail");
+				goto err;
+			}
+			if (a_rule->dynamic_specs) {
+				zc_error("flight path must be static, [%s]", a_rule->file_path);
+				goto err;
+			}
+
+			a_rule->flight = zlog_flight_new(a_rule->file_path,
+				file_limit ? zc_parse_byte_size(file_limit) : ZLOG_FLIGHT_DEFAULT_SIZE,
+				a_rule->file_perms);
+			if (!a_rule->flight) {
+				zc_error("zlog_flight_new fail");
+				goto err;
+			}
+			a_rule->output = zlog_rule_output_flight;
+		} else if (STRNCMP(file_path + 1, ==, "shm", 3)) {
+			/* >shm "/dev/shm/aa.ring", 16MB */
+			p = strchr(file_path, '"');
+			if (!p) {
+				zc_error("shm path not start with \", [%s]", file_path);
+				goto err;
+			}
+			memmove(file_path, p, strlen(p) + 1);
+			rc = zlog_rule_parse_path(file_path, sizeof(file_path),
+				&(a_rule->file_path), &(a_rule->dynamic_specs),
+				time_cache_count, &(path_spec_flag));
+			if (rc) {
+				zc_error("zlog_rule_parse_path fail");
+				goto err;
+			}
+			if (a_rule->dynamic_specs) {
+				zc_error("shm path must be static, [%s]", a_rule->file_path);
+				goto err;
+			}
+
+			a_rule->shm = zlog_shm_new(a_rule->file_path,
+				file_limit ? zc_parse_byte_size(file_limit) : ZLOG_SHM_DEFAULT_SIZE,
+				a_rule->file_perms);
+			if (!a_rule->shm) {
+				zc_error("zlog_shm_new fail");
+				goto err;
+			}
+			a_rule->output = zlog_rule_output_shm;
+		} else if (STRNCMP(file_path + 1, ==, "zlogd", 5)) {
+			/* >zlogd "/run/zlogd.sock", or >zlogd to the default */
+			if (a_rule->socket_framing) {
+				zc_error("socket_framing is not for >zlogd, [%s]", file_path);
+				goto err;
+			}
+			p = strchr(file_path, '"');
+			q = p ? strchr(p + 1, '"') : NULL;
+			if (p && !q) {
+				zc_error("zlogd path not in \"\", [%s]", file_path);
+				goto err;
+			}
+			if (q) *q = '\0';
+			snprintf(socket_addr, sizeof(socket_addr), "unix:%s", p ? p + 1 : ZLOGD_DEFAULT_PATH);
+			a_rule->socket = zlog_socket_new(socket_addr,
+				ZLOG_SOCKET_LENGTH, a_rule->socket_backlog);
+			if (!a_rule->socket) {
+				zc_error("zlog_socket_new fail");
+				goto err;
+			}
+			a_rule->socket->report_tag[0] = (char)zlog_level_list_atoi(levels, "WARN");
+			a_rule->socket->report_tag[1] = sizeof(ZLOGD_REPORT_CATEGORY) - 1;
+			memcpy(a_rule->socket->report_tag + 2, ZLOGD_REPORT_CATEGORY,
+				sizeof(ZLOGD_REPORT_CATEGORY) - 1);
+			a_rule->socket->report_tag_len = 2 + sizeof(ZLOGD_REPORT_CATEGORY) - 1;
+			a_rule->output = zlog_rule_output_zlogd;
+		} else if (STRNCMP(file_path + 1, ==, "socket", 6)) {
+			/* >socket "unix:/run/aa.sock" */
+			p = strchr(file_path, '"');
+			q = p ? strchr(p + 1, '"') : NULL;
+			if (!q) {
+				zc_error("socket address not in \"\", [%s]", file_path);
+				goto err;
+			}
+			*q = '\0';
+			a_rule->socket = zlog_socket_new(p + 1,
+				a_rule->socket_framing, a_rule->socket_backlog);
+			if (!a_rule->socket) {
+				zc_error("zlog_socket_new fail");
+				goto err;
+			}
+			a_rule->output = zlog_rule_output_socket;
 		} else {
 			zc_error
-			    ("[%s]the string after is not syslog, stdout or stderr", output);
+			    ("[%s]the string after is not syslog, stdout, stderr, flight, shm, socket or zlogd", output);
 			goto err;
 		}
 		break;
@@ -1338,6 +1951,56 @@ zlog_rule_t *zlog_rule_new(char *line,
 		goto err;
 	}
 
+	if (a_rule->stream_buffered && !a_rule->stream) {
+		zc_error("compress and buffer are only for a file output, [%s]", output);
+		goto err;
+	}
+
+	if (!a_rule->syslog && (a_rule->syslog_socket[0] || a_rule->syslog_ident[0]
+			|| a_rule->syslog_format || a_rule->syslog_drop)) {
+		zc_error("syslog options are only for >syslog, [%s]", output);
+		goto err;
+	}
+
+	if (!a_rule->pipe && (a_rule->pipe_buffer || a_rule->pipe_full
+			|| a_rule->pipe_spill[0] || a_rule->pipe_size)) {
+		zc_error("pipe options are only for a | output, [%s]", output);
+		goto err;
+	}
+
+	if (!a_rule->socket && (a_rule->socket_framing || a_rule->socket_backlog)) {
+		zc_error("socket options are only for >socket, [%s]", output);
+		goto err;
+	}
+
+	if (a_rule->rate[0] != '\0') {
+		a_rule->limit = zlog_limit_new(a_rule->rate, a_rule->rate_burst,
+			a_rule->rate_scope, a_rule->rate_report_period);
+		if (!a_rule->limit) {
+			zc_error("zlog_limit_new fail");
+			goto err;
+		}
+	} else if (a_rule->rate_burst || a_rule->rate_scope) {
+		zc_error("burst and rate_scope need a rate");
+		goto err;
+	}
+
+	if (a_rule->dedup_window) {
+		a_rule->dedup = zlog_dedup_new(a_rule->dedup_window);
+		if (!a_rule->dedup) {
+			zc_error("zlog_dedup_new fail");
+			goto err;
+		}
+	}
+
+	if (a_rule->backtrace_count) {
+		a_rule->backtrace = zlog_backtrace_new(a_rule->backtrace_count);
+		if (!a_rule->backtrace) {
+			zc_error("zlog_backtrace_new fail");
+			goto err;
+		}
+	}
+
 	//zlog_rule_profile(a_rule, ZC_DEBUG);
 	return a_rule;
 err:
@@ -1363,6 +2026,12 @@ void zlog_rule_del(zlog_rule_t * a_rule)
 		a_rule->fname_fds = NULL;
 	}
 
+	/* write what is buffered before the fd goes */
+	if (a_rule->stream) {
+		zlog_stream_del(a_rule->stream);
+		a_rule->stream = NULL;
+	}
+
 	if (a_rule->static_fd) {
 		fsync(a_rule->static_fd);
 		if (close(a_rule->static_fd)) {
@@ -1370,12 +2039,53 @@ void zlog_rule_del(zlog_rule_t * a_rule)
 		}
 	}
 
+	/* write what is buffered before the pipe goes */
+	if (a_rule->pipe) {
+		zlog_pipe_del(a_rule->pipe);
+		a_rule->pipe = NULL;
+	}
+
 	if (a_rule->pipe_fp) {
 		if (pclose(a_rule->pipe_fp) == -1) {
 			zc_error("pclose fail, errno[%d]", errno);
 		}
 	}
 
+	if (a_rule->flight) {
+		zlog_flight_del(a_rule->flight);
+		a_rule->flight = NULL;
+	}
+
+	if (a_rule->shm) {
+		zlog_shm_del(a_rule->shm);
+		a_rule->shm = NULL;
+	}
+
+	if (a_rule->socket) {
+		zlog_socket_del(a_rule->socket);
+		a_rule->socket = NULL;
+	}
+
+	if (a_rule->backtrace) {
+		zlog_backtrace_del(a_rule->backtrace);
+		a_rule->backtrace = NULL;
+	}
+
+	if (a_rule->limit) {
+		zlog_limit_del(a_rule->limit);
+		a_rule->limit = NULL;
+	}
+
+	if (a_rule->dedup) {
+		zlog_dedup_del(a_rule->dedup);
+		a_rule->dedup = NULL;
+	}
+
+	if (a_rule->syslog) {
+		zlog_syslog_del(a_rule->syslog);
+		a_rule->syslog = NULL;
+	}
+
 	if (a_rule->archive_path) {
 		free(a_rule->archive_path);
 		a_rule->archive_path = NULL;
@@ -1405,29 +2115,133 @@ void zlog_rule_del(zlog_rule_t * a_rule)
 }
 
 /*******************************************************************************/
+/* kept records are written one by one, as if each was logged now */
+static int zlog_rule_output_kept(const char *str, size_t len, void *arg)
+{
+	zlog_rule_t *a_rule = ((void **)arg)[0];
+	zlog_thread_t *a_thread = ((void **)arg)[1];
+	int rc;
+
+	zlog_buf_restart(a_thread->msg_buf);
+	if (zlog_buf_append(a_thread->msg_buf, str, len) < 0) {
+		zc_error("zlog_buf_append fail");
+		return -1;
+	}
+
+	a_thread->msg_kept = 1;
+	rc = a_rule->output(a_rule, a_thread);
+	a_thread->msg_kept = 0;
+	return rc;
+}
+
+/* a line of how many records were dropped, written as a kept one */
+static int zlog_rule_output_suppressed(zlog_rule_t * a_rule, zlog_thread_t * a_thread,
+		unsigned long nsuppressed)
+{
+	int len;
+	void *arg[2];
+	char line[MAXLEN_PATH + MAXLEN_CFG_NAME * 2 + 64];
+
+	switch (a_rule->rate_scope) {
+	case ZLOG_LIMIT_CATEGORY:
+		len = snprintf(line, sizeof(line), "zlog: %lu records of category[%s] dropped over rate[%s]\n",
+			nsuppressed, a_thread->event->category_name, a_rule->rate);
+		break;
+	case ZLOG_LIMIT_SITE:
+		len = snprintf(line, sizeof(line), "zlog: %lu records of [%s:%ld] dropped over rate[%s]\n",
+			nsuppressed, a_thread->event->file, a_thread->event->line, a_rule->rate);
+		break;
+	default:
+		len = snprintf(line, sizeof(line), "zlog: %lu records of rule[%s] dropped over rate[%s]\n",
+			nsuppressed, a_rule->category, a_rule->rate);
+		break;
+	}
+	if (len < 0 || len >= (int)sizeof(line)) len = sizeof(line) - 1;
+
+	arg[0] = a_rule;
+	arg[1] = a_thread;
+	return zlog_rule_output_kept(line, len, arg);
+}
+
+/* the last record went nrepeat times more, before this one */
+static int zlog_rule_output_repeated(zlog_rule_t * a_rule, zlog_thread_t * a_thread,
+		unsigned long nrepeat)
+{
+	int len;
+	void *arg[2];
+	char line[64];
+
+	len = snprintf(line, sizeof(line), "zlog: last record repeated %lu times\n", nrepeat);
+
+	arg[0] = a_rule;
+	arg[1] = a_thread;
+	return zlog_rule_output_kept(line, len, arg);
+}
+
+static int zlog_rule_output_or_keep(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
+{
+	void *arg[2];
+	unsigned long nsuppressed;
+	unsigned long nrepeat;
+
+	/* before anything is formatted */
+	if (a_rule->limit) {
+		if (!zlog_limit_take(a_rule->limit, a_thread->event, &nsuppressed)) return 0;
+		if (nsuppressed && zlog_rule_output_suppressed(a_rule, a_thread, nsuppressed)) {
+			zc_error("zlog_rule_output_suppressed fail");
+		}
+	}
+
+	if (a_rule->dedup) {
+		if (!zlog_dedup_check(a_rule->dedup, a_thread, &nrepeat)) return 0;
+		if (nrepeat && zlog_rule_output_repeated(a_rule, a_thread, nrepeat)) {
+			zc_error("zlog_rule_output_repeated fail");
+		}
+	}
+
+	if (!a_rule->backtrace) return a_rule->output(a_rule, a_thread);
+
+	/* nothing goes out below the trigger level */
+	if (a_thread->event->level < a_rule->backtrace_level) {
+		if (zlog_format_gen_msg(a_rule->format, a_thread)) {
+			zc_error("zlog_format_gen_msg fail");
+			return -1;
+		}
+		return zlog_backtrace_keep(a_rule->backtrace,
+			zlog_buf_str(a_thread->msg_buf), zlog_buf_len(a_thread->msg_buf));
+	}
+
+	arg[0] = a_rule;
+	arg[1] = a_thread;
+	if (zlog_backtrace_flush(a_rule->backtrace, zlog_rule_output_kept, arg)) {
+		zc_error("zlog_backtrace_flush fail");
+	}
+	return a_rule->output(a_rule, a_thread);
+}
+
 int zlog_rule_output(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
 {
 	switch (a_rule->compare_char) {
 	case '*' :
-		return a_rule->output(a_rule, a_thread);
+		return zlog_rule_output_or_keep(a_rule, a_thread);
 		break;
 	case '.' :
 		if (a_thread->event->level >= a_rule->level) {
-			return a_rule->output(a_rule, a_thread);
+			return zlog_rule_output_or_keep(a_rule, a_thread);
 		} else {
 			return 0;
 		}
 		break;
 	case '=' :
 		if (a_thread->event->level == a_rule->level) {
-			return a_rule->output(a_rule, a_thread);
+			return zlog_rule_output_or_keep(a_rule, a_thread);
 		} else {
 			return 0;
 		}
 		break;
 	case '!' :
 		if (a_thread->event->level != a_rule->level) {
-			return a_rule->output(a_rule, a_thread);
+			return zlog_rule_output_or_keep(a_rule, a_thread);
 		} else {
 			return 0;
 		}
@@ -1437,6 +2251,11 @@ int zlog_rule_output(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
 	return 0;
 }
 
+int zlog_rule_output_any_level(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
+{
+	return zlog_rule_output_or_keep(a_rule, a_thread);
+}
+
 /*******************************************************************************/
 int zlog_rule_is_wastebin(zlog_rule_t * a_rule)
 {
@@ -1450,34 +2269,35 @@ int zlog_rule_is_wastebin(zlog_rule_t * a_rule)
 }
 
 /*******************************************************************************/
-int zlog_rule_match_category(zlog_rule_t * a_rule, char *category)
+/* static files which are checked for an external move, see
+ * zlog_rule_check_reopen_static_file, rotated ones are reopened by us
+ */
+void zlog_rule_watch(zlog_rule_t * a_rule, zlog_watcher_t * a_watcher)
 {
-	zc_assert(a_rule, -1);
-	zc_assert(category, -1);
-
-	if (STRCMP(a_rule->category, ==, "*")) {
-		/* '*' match anything, so go on */
-		return 1;
-	} else if (STRCMP(a_rule->category, ==, category)) {
-		/* accurate compare */
-		return 1;
-	} else {
-		/* aa_ match aa_xx & aa, but not match aa1_xx */
-		size_t len;
-		len = strlen(a_rule->category);
+	zc_assert(a_rule,);
+	zc_assert(a_watcher,);
 
-		if (a_rule->category[len - 1] == '_') {
-			if (strlen(category) == len - 1) {
-				len--;
-			}
+	if (a_rule->output != zlog_rule_output_static_file_single
+		&& !(a_rule->output == zlog_rule_output_static_file_stream
+			&& a_rule->archive_max_size <= 0)) {
+		return;
+	}
 
-			if (STRNCMP(a_rule->category, ==, category, len)) {
-				return 1;
-			}
-		}
+	/* fail, it is polled as before */
+	if (zlog_watcher_add(a_watcher, a_rule->file_path, &(a_rule->watch_state))) {
+		return;
 	}
+	a_rule->watcher = a_watcher;
+	return;
+}
 
-	return 0;
+/*******************************************************************************/
+int zlog_rule_match_category(zlog_rule_t * a_rule, char *category)
+{
+	zc_assert(a_rule, -1);
+	zc_assert(category, -1);
+
+	return zlog_rule_trie_fit(a_rule->category, category);
 }
 
 /*******************************************************************************/
@@ -1494,6 +2314,8 @@ int zlog_rule_set_record(zlog_rule_t * a_rule, zc_hashtable_t *records)
 	a_record = zc_hashtable_get(records, a_rule->record_name);
 	if (a_record) {
 		a_rule->record_func = a_record->output;
+		a_rule->record_event_func = a_record->event_output;
+		a_rule->record_batch = a_record->batch;
 	}
 	return 0;
 }
@@ -22,6 +22,17 @@
 #include "thread.h"
 #include "rotater.h"
 #include "record.h"
+#include "batch.h"
+#include "stream.h"
+#include "watcher.h"
+#include "flight.h"
+#include "backtrace.h"
+#include "limit.h"
+#include "dedup.h"
+#include "pipe.h"
+#include "socket_client.h"
+#include "shm.h"
+#include "syslog_client.h"
 
 typedef struct zlog_rule_s zlog_rule_t;
 
@@ -48,6 +59,8 @@ struct zlog_rule_s {
 	dev_t static_dev;
 	ino_t static_ino;
 	int is_reopening;
+	zlog_watcher_t *watcher;	/* NULL, stat the path once a second */
+	volatile int watch_state;	/* ZLOG_WATCH_*, flipped by the watcher */
 
 	pthread_mutex_t lock_mutex;
 	zc_arraylist_t *fname_fds;
@@ -56,17 +69,64 @@ struct zlog_rule_s {
 	volatile size_t file_size;
 	long archive_max_size;
 	int archive_max_count;
+	size_t archive_max_total;	/* 0 means no limit on all archives */
+	long archive_max_age;		/* seconds, 0 means no limit */
 	char *archive_path;
 	zc_arraylist_t *archive_specs;
 
 	FILE *pipe_fp;
 	int pipe_fd;
+	/* [; pipe_buffer=1MB pipe_full=drop pipe_spill=aa.spill pipe_size=1MB] */
+	size_t pipe_buffer;
+	int pipe_full;
+	char pipe_spill[MAXLEN_PATH + 1];
+	size_t pipe_size;
+	zlog_pipe_t *pipe;
+
+	zlog_flight_t *flight;
+	zlog_shm_t *shm;
+
+	/* >socket "tcp:127.0.0.1:5140"; [; socket_framing=length socket_backlog=4MB] */
+	int socket_framing;
+	size_t socket_backlog;
+	zlog_socket_t *socket;
 
 	size_t fsync_period;
 	size_t fsync_count;
 
+	/* options after the format, [; compress flush=1s] */
+	int stream_compress;
+	int stream_buffered;		/* records are written by blocks, compressed or not */
+	int stream_lanes;		/* 1 for rule scope, more for thread scope */
+	size_t stream_block_size;
+	long stream_flush_period;
+	int stream_flush_level;
+	zlog_stream_t *stream;
+
+	/* [; backtrace=100 backtrace_level=ERROR], records below the level are kept */
+	size_t backtrace_count;
+	int backtrace_level;
+	zlog_backtrace_t *backtrace;
+
+	/* [; rate=100/s burst=200 rate_scope=site rate_report=10s] */
+	char rate[MAXLEN_CFG_NAME + 1];
+	long rate_burst;
+	int rate_scope;
+	long rate_report_period;	/* ms */
+	zlog_limit_t *limit;
+
+	/* [; dedup=5s], equal records after the first are counted in the window */
+	long dedup_window;		/* ms */
+	zlog_dedup_t *dedup;
+
 	zc_arraylist_t *levels;
 	int syslog_facility;
+	/* [; syslog_socket=/dev/log syslog_format=rfc5424 syslog_ident=app syslog_drop] */
+	char syslog_socket[MAXLEN_PATH + 1];
+	char syslog_ident[MAXLEN_CFG_NAME + 1];
+	int syslog_format;
+	int syslog_drop;
+	zlog_syslog_t *syslog;
 
 	zlog_format_t *format;
 	zlog_rule_output_fn output;
@@ -74,6 +134,8 @@ struct zlog_rule_s {
 	char *record_name;
 	char *record_path;
 	zlog_record_fn record_func;
+	zlog_record_event_fn record_event_func;
+	zlog_batch_t *record_batch;	/* of the record, when it takes batches */
 };
 
 zlog_rule_t *zlog_rule_new(char * line,
@@ -84,13 +146,18 @@ zlog_rule_t *zlog_rule_new(char * line,
 						   size_t fsync_period,
 						   long archive_max_size,
 						   int archive_max_count,
+						   size_t archive_max_total,
+						   long archive_max_age,
 						   int * time_cache_count);
 
 void zlog_rule_del(zlog_rule_t * a_rule);
 void zlog_rule_profile(zlog_rule_t * a_rule, int flag);
 int zlog_rule_match_category(zlog_rule_t * a_rule, char *category);
 int zlog_rule_is_wastebin(zlog_rule_t * a_rule);
+void zlog_rule_watch(zlog_rule_t * a_rule, zlog_watcher_t * a_watcher);
 int zlog_rule_set_record(zlog_rule_t * a_rule, zc_hashtable_t *records);
 int zlog_rule_output(zlog_rule_t * a_rule, zlog_thread_t * a_thread);
+/* for a rule of '.' whose category has a level lower than the rule */
+int zlog_rule_output_any_level(zlog_rule_t * a_rule, zlog_thread_t * a_thread);
 
 #endif
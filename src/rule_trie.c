@@ -0,0 +1,304 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rule_trie.h"
+#include "zc_defs.h"
+
+#define ZLOG_RULE_TRIE_FOUND	64
+
+void zlog_rule_trie_profile(zlog_rule_trie_t * a_trie, int flag)
+{
+	zc_assert(a_trie,);
+	zc_profile(flag, "--rule_trie[%p][nodes:%d][entries:%d][wastebin:%p]--",
+		a_trie,
+		a_trie->nnodes,
+		a_trie->nentries - 1,
+		a_trie->wastebin);
+	return;
+}
+
+/*******************************************************************************/
+void zlog_rule_trie_del(zlog_rule_trie_t * a_trie)
+{
+	zc_assert(a_trie,);
+	free(a_trie->nodes);
+	free(a_trie->entries);
+	zc_debug("zlog_rule_trie_del[%p]", a_trie);
+	free(a_trie);
+	return;
+}
+
+static int zlog_rule_trie_node_new(zlog_rule_trie_t * a_trie, unsigned char c)
+{
+	int n;
+	zlog_rule_trie_node_t *nodes;
+
+	if (a_trie->nnodes == a_trie->nodes_size) {
+		n = a_trie->nodes_size ? a_trie->nodes_size * 2 : 64;
+		nodes = realloc(a_trie->nodes, n * sizeof(zlog_rule_trie_node_t));
+		if (!nodes) {
+			zc_error("realloc fail, errno[%d]", errno);
+			return -1;
+		}
+		a_trie->nodes = nodes;
+		a_trie->nodes_size = n;
+	}
+	memset(&(a_trie->nodes[a_trie->nnodes]), 0x00, sizeof(zlog_rule_trie_node_t));
+	a_trie->nodes[a_trie->nnodes].c = c;
+	return a_trie->nnodes++;
+}
+
+static int zlog_rule_trie_child(zlog_rule_trie_t * a_trie, int node, unsigned char c)
+{
+	int i;
+
+	for (i = a_trie->nodes[node].child; i; i = a_trie->nodes[i].next) {
+		if (a_trie->nodes[i].c == c) return i;
+	}
+	return 0;
+}
+
+/* the node of the first len chars of s, made on the way */
+static int zlog_rule_trie_walk(zlog_rule_trie_t * a_trie, const char *s, size_t len)
+{
+	size_t i;
+	int node = 0;
+	int child;
+
+	for (i = 0; i < len; i++) {
+		child = zlog_rule_trie_child(a_trie, node, (unsigned char)s[i]);
+		if (!child) {
+			child = zlog_rule_trie_node_new(a_trie, (unsigned char)s[i]);
+			if (child < 0) return -1;
+			a_trie->nodes[child].next = a_trie->nodes[node].child;
+			a_trie->nodes[node].child = child;
+		}
+		node = child;
+	}
+	return node;
+}
+
+/* add the entry to a list of the node, as *list */
+static int zlog_rule_trie_entry_new(zlog_rule_trie_t * a_trie, int *list,
+	zlog_rule_t * a_rule, const char *glob)
+{
+	int n;
+	zlog_rule_trie_entry_t *entries;
+
+	if (a_trie->nentries == a_trie->entries_size) {
+		n = a_trie->entries_size * 2;
+		entries = realloc(a_trie->entries, n * sizeof(zlog_rule_trie_entry_t));
+		if (!entries) {
+			zc_error("realloc fail, errno[%d]", errno);
+			return -1;
+		}
+		a_trie->entries = entries;
+		a_trie->entries_size = n;
+	}
+	a_trie->entries[a_trie->nentries].rule = a_rule;
+	a_trie->entries[a_trie->nentries].glob = glob;
+	a_trie->entries[a_trie->nentries].next = *list;
+	*list = a_trie->nentries++;
+	return 0;
+}
+
+static int zlog_rule_trie_add(zlog_rule_trie_t * a_trie, zlog_rule_t * a_rule)
+{
+	int node;
+	size_t len;
+	const char *category = a_rule->category;
+	const char *wild;
+
+	/* '*' fits anything */
+	if (STRCMP(category, ==, "*")) {
+		return zlog_rule_trie_entry_new(a_trie, &(a_trie->nodes[0].prefix), a_rule, NULL);
+	}
+
+	wild = strpbrk(category, "*?");
+	len = wild ? (size_t)(wild - category) : strlen(category);
+
+	/* aa_ fits aa_xx & aa, but not aa1_xx */
+	if (!wild && len > 0 && category[len - 1] == '_') {
+		node = zlog_rule_trie_walk(a_trie, category, len - 1);
+		if (node < 0) return -1;
+		if (zlog_rule_trie_entry_new(a_trie, &(a_trie->nodes[node].exact), a_rule, NULL)) {
+			return -1;
+		}
+	}
+
+	node = zlog_rule_trie_walk(a_trie, category, len);
+	if (node < 0) return -1;
+	if (wild) {
+		return zlog_rule_trie_entry_new(a_trie, &(a_trie->nodes[node].glob), a_rule, wild);
+	} else if (len > 0 && category[len - 1] == '_') {
+		return zlog_rule_trie_entry_new(a_trie, &(a_trie->nodes[node].prefix), a_rule, NULL);
+	} else {
+		return zlog_rule_trie_entry_new(a_trie, &(a_trie->nodes[node].exact), a_rule, NULL);
+	}
+}
+
+zlog_rule_trie_t *zlog_rule_trie_new(zc_arraylist_t * rules)
+{
+	int i;
+	zlog_rule_t *a_rule;
+	zlog_rule_trie_t *a_trie;
+
+	zc_assert(rules, NULL);
+
+	a_trie = calloc(1, sizeof(zlog_rule_trie_t));
+	if (!a_trie) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+
+	/* entry 0 is the end of lists */
+	a_trie->entries_size = zc_arraylist_len(rules) + 2;
+	a_trie->entries = calloc(a_trie->entries_size, sizeof(zlog_rule_trie_entry_t));
+	if (!a_trie->entries) {
+		zc_error("calloc fail, errno[%d]", errno);
+		goto err;
+	}
+	a_trie->nentries = 1;
+
+	if (zlog_rule_trie_node_new(a_trie, '\0') < 0) {
+		zc_error("zlog_rule_trie_node_new fail");
+		goto err;
+	}
+
+	zc_arraylist_foreach(rules, i, a_rule) {
+		if (zlog_rule_trie_add(a_trie, a_rule)) {
+			zc_error("zlog_rule_trie_add fail");
+			goto err;
+		}
+		if (zlog_rule_is_wastebin(a_rule)) a_trie->wastebin = a_rule;
+	}
+
+	zlog_rule_trie_profile(a_trie, ZC_DEBUG);
+	return a_trie;
+err:
+	zlog_rule_trie_del(a_trie);
+	return NULL;
+}
+
+/*******************************************************************************/
+int zlog_rule_trie_glob(const char *pattern, const char *name)
+{
+	const char *star = NULL;
+	const char *back = NULL;
+
+	while (*name) {
+		if (*pattern == '*') {
+			star = pattern++;
+			back = name;
+		} else if (*pattern == '?' || *pattern == *name) {
+			pattern++;
+			name++;
+		} else if (star) {
+			/* the last * takes one more char */
+			pattern = star + 1;
+			name = ++back;
+		} else {
+			return 0;
+		}
+	}
+	while (*pattern == '*') pattern++;
+	return *pattern == '\0';
+}
+
+int zlog_rule_trie_fit(const char *category, const char *name)
+{
+	size_t len;
+
+	if (STRCMP(category, ==, "*")) return 1;
+	if (STRCMP(category, ==, name)) return 1;
+	if (strpbrk(category, "*?")) return zlog_rule_trie_glob(category, name);
+
+	/* aa_ fits aa_xx & aa, but not aa1_xx */
+	len = strlen(category);
+	if (len == 0 || category[len - 1] != '_') return 0;
+	if (strlen(name) == len - 1) len--;
+	return STRNCMP(category, ==, name, len);
+}
+
+static int zlog_rule_trie_found(int **found, int *nfound, int *size, int *buf, int entry)
+{
+	int *p;
+
+	if (*nfound == *size) {
+		p = malloc(*size * 2 * sizeof(int));
+		if (!p) {
+			zc_error("malloc fail, errno[%d]", errno);
+			return -1;
+		}
+		memcpy(p, *found, *nfound * sizeof(int));
+		if (*found != buf) free(*found);
+		*found = p;
+		*size *= 2;
+	}
+	(*found)[(*nfound)++] = entry;
+	return 0;
+}
+
+int zlog_rule_trie_match(zlog_rule_trie_t * a_trie, const char *name, zc_arraylist_t * fit_rules)
+{
+	int i;
+	int j;
+	int e;
+	int node = 0;
+	int buf[ZLOG_RULE_TRIE_FOUND];
+	int *found = buf;
+	int nfound = 0;
+	int size = ZLOG_RULE_TRIE_FOUND;
+	zlog_rule_trie_node_t *a_node;
+
+	zc_assert(a_trie, -1);
+	zc_assert(name, -1);
+
+	for (;;) {
+		a_node = &(a_trie->nodes[node]);
+		for (e = a_node->prefix; e; e = a_trie->entries[e].next) {
+			if (zlog_rule_trie_found(&found, &nfound, &size, buf, e)) goto err;
+		}
+		for (e = a_node->glob; e; e = a_trie->entries[e].next) {
+			if (!zlog_rule_trie_glob(a_trie->entries[e].glob, name)) continue;
+			if (zlog_rule_trie_found(&found, &nfound, &size, buf, e)) goto err;
+		}
+		if (*name == '\0') {
+			for (e = a_node->exact; e; e = a_trie->entries[e].next) {
+				if (zlog_rule_trie_found(&found, &nfound, &size, buf, e)) goto err;
+			}
+			break;
+		}
+		node = zlog_rule_trie_child(a_trie, node, (unsigned char)*name);
+		if (!node) break;
+		name++;
+	}
+
+	/* entries were made in the order of rules */
+	for (i = 1; i < nfound; i++) {
+		e = found[i];
+		for (j = i; j > 0 && found[j - 1] > e; j--) found[j] = found[j - 1];
+		found[j] = e;
+	}
+	for (i = 0; i < nfound; i++) {
+		if (zc_arraylist_add(fit_rules, a_trie->entries[found[i]].rule)) {
+			zc_error("zc_arraylist_add fail");
+			goto err;
+		}
+	}
+
+	if (found != buf) free(found);
+	return 0;
+err:
+	if (found != buf) free(found);
+	return -1;
+}
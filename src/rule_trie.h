@@ -0,0 +1,59 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_rule_trie_h
+#define __zlog_rule_trie_h
+
+#include "zc_defs.h"
+#include "rule.h"
+
+/* categories of rules as a trie by chars, a node has the rules which fit
+ *   exact    a name ending there, aa
+ *   prefix   each name going through there, aa_ and *
+ *   glob     names going through there, whose rest fits the glob, as
+ *            net_*_rx at the node of net_, * for any chars and ? for one
+ * so rules of a name are found in one walk of it
+ */
+typedef struct zlog_rule_trie_entry_s {
+	zlog_rule_t *rule;
+	const char *glob;		/* rest of the category of rule */
+	int next;			/* in the list of the node, 0 ends */
+} zlog_rule_trie_entry_t;
+
+typedef struct zlog_rule_trie_node_s {
+	unsigned char c;
+	int child;			/* first, 0 for none, as root is 0 */
+	int next;			/* sibling */
+	int exact;			/* entries, 0 for none */
+	int prefix;
+	int glob;
+} zlog_rule_trie_node_t;
+
+typedef struct zlog_rule_trie_s {
+	zlog_rule_trie_node_t *nodes;
+	int nnodes;
+	int nodes_size;
+	zlog_rule_trie_entry_t *entries;	/* in the order of rules, from 1 */
+	int nentries;
+	int entries_size;
+	zlog_rule_t *wastebin;		/* the last one, for a name no rule fits */
+} zlog_rule_trie_t;
+
+zlog_rule_trie_t *zlog_rule_trie_new(zc_arraylist_t * rules);
+void zlog_rule_trie_del(zlog_rule_trie_t * a_trie);
+void zlog_rule_trie_profile(zlog_rule_trie_t * a_trie, int flag);
+
+/* add rules fit for name to fit_rules, in the order of rules */
+int zlog_rule_trie_match(zlog_rule_trie_t * a_trie, const char *name, zc_arraylist_t * fit_rules);
+
+/* return 1 if name fits pattern of * and ? */
+int zlog_rule_trie_glob(const char *pattern, const char *name);
+/* return 1 if name fits one category of rule, *, aa, aa_ or a glob */
+int zlog_rule_trie_fit(const char *category, const char *name);
+
+#endif
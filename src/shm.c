@@ -0,0 +1,346 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+#include "zlog.h"
+#include "shm.h"
+#include "zc_defs.h"
+
+#define ZLOG_SHM_ALIGN(n)	(((n) + 7) & ~(size_t)7)
+
+void zlog_shm_profile(zlog_shm_t * a_shm, int flag)
+{
+	zc_assert(a_shm,);
+	zc_profile(flag, "--shm[%p][%s][%lu][reserve:%llu][read:%llu][dropped:%llu]--",
+		a_shm,
+		a_shm->name,
+		(unsigned long)a_shm->head->data_size,
+		(unsigned long long)a_shm->head->reserve,
+		(unsigned long long)a_shm->head->read,
+		(unsigned long long)a_shm->head->dropped);
+	return;
+}
+
+/*******************************************************************************/
+static int zlog_shm_map(const char *path, int flags, unsigned int perms,
+		size_t map_size, zlog_shm_head_t ** head, off_t * file_size)
+{
+	int fd;
+	struct stat stb;
+	zlog_shm_head_t a_head;
+
+	fd = open(path, flags, perms);
+	if (fd < 0) {
+		zc_error("open file[%s] fail, errno[%d]", path, errno);
+		return -1;
+	}
+	if (fstat(fd, &stb)) {
+		zc_error("fstat [%s] fail, errno[%d]", path, errno);
+		close(fd);
+		return -1;
+	}
+	*file_size = stb.st_size;
+	if (!map_size) {
+		map_size = stb.st_size;
+	} else if (stb.st_size != (off_t)map_size) {
+		/* writers and a reader may be on it, it is not cut under them */
+		if (stb.st_size >= (off_t)sizeof(zlog_shm_head_t)
+			&& pread(fd, &a_head, sizeof(a_head), 0) == (ssize_t)sizeof(a_head)
+			&& !memcmp(a_head.magic, ZLOG_SHM_MAGIC, sizeof(a_head.magic))) {
+			zc_error("[%s] is a shm file of [%ld] bytes, not [%ld], remove it to make it over",
+				path, (long)stb.st_size, (long)map_size);
+			close(fd);
+			return -1;
+		}
+		if (ftruncate(fd, map_size)) {
+			zc_error("ftruncate [%s] fail, errno[%d]", path, errno);
+			close(fd);
+			return -1;
+		}
+	}
+	if (map_size < ZLOG_SHM_HEAD_SIZE) {
+		zc_error("[%s] is not a shm file", path);
+		close(fd);
+		return -1;
+	}
+
+	*head = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (*head == MAP_FAILED) {
+		*head = NULL;
+		zc_error("mmap [%s] fail, errno[%d]", path, errno);
+		return -1;
+	}
+	return 0;
+}
+
+void zlog_shm_del(zlog_shm_t * a_shm)
+{
+	zc_assert(a_shm,);
+	if (a_shm->head) munmap(a_shm->head, a_shm->map_size);
+	zc_debug("zlog_shm_del[%p]", a_shm);
+	free(a_shm);
+	return;
+}
+
+zlog_shm_t *zlog_shm_new(const char *path, size_t data_size, unsigned int perms)
+{
+	off_t file_size;
+	zlog_shm_t *a_shm;
+
+	zc_assert(path, NULL);
+
+	data_size = ZLOG_SHM_ALIGN(data_size);
+	if (data_size == 0) {
+		zc_error("shm size of [%s] is 0", path);
+		return NULL;
+	}
+	if (strlen(path) > MAXLEN_PATH) {
+		zc_error("path[%s] is too long", path);
+		return NULL;
+	}
+
+	a_shm = calloc(1, sizeof(zlog_shm_t));
+	if (!a_shm) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	strcpy(a_shm->name, path);
+	a_shm->map_size = ZLOG_SHM_HEAD_SIZE + data_size;
+
+	if (zlog_shm_map(path, O_RDWR | O_CREAT, perms, a_shm->map_size,
+			&(a_shm->head), &file_size)) {
+		zc_error("zlog_shm_map fail");
+		goto err;
+	}
+	a_shm->data = (char *)a_shm->head + ZLOG_SHM_HEAD_SIZE;
+
+	/* shared with writers and a reader already there, or made over */
+	if (!memcmp(a_shm->head->magic, ZLOG_SHM_MAGIC, sizeof(a_shm->head->magic))
+		&& file_size == (off_t)a_shm->map_size) {
+		if (a_shm->head->head_size != ZLOG_SHM_HEAD_SIZE
+			|| a_shm->head->data_size != data_size) {
+			zc_error("[%s] is a shm file of head [%lu] and data [%lu], remove it to make it over",
+				path, (unsigned long)a_shm->head->head_size,
+				(unsigned long)a_shm->head->data_size);
+			goto err;
+		}
+	} else {
+		memset(a_shm->head, 0, a_shm->map_size);
+		a_shm->head->head_size = ZLOG_SHM_HEAD_SIZE;
+		a_shm->head->data_size = data_size;
+		zc_barrier();
+		memcpy(a_shm->head->magic, ZLOG_SHM_MAGIC, sizeof(a_shm->head->magic));
+	}
+
+	zc_fork_watch();
+	a_shm->pid = getpid();
+	a_shm->forks = zc_forks;
+
+	zlog_shm_profile(a_shm, ZC_DEBUG);
+	return a_shm;
+err:
+	zlog_shm_del(a_shm);
+	return NULL;
+}
+
+/*******************************************************************************/
+void zlog_shm_write(zlog_shm_t * a_shm, const char *str, size_t len)
+{
+	zlog_shm_head_t *a_head = a_shm->head;
+	uint64_t data_size = a_head->data_size;
+	uint64_t pos;
+	uint64_t read;
+	size_t off;
+	size_t pad;
+	size_t need = ZLOG_SHM_ALIGN(sizeof(zlog_shm_slot_t) + len);
+	zlog_shm_slot_t *a_slot;
+
+	if (need > data_size || len >= ZLOG_SHM_PAD) {
+		ATOM_F_ADD(&(a_head->dropped), 1);
+		return;
+	}
+
+	do {
+		/* read first, it is never after reserve then */
+		read = a_head->read;
+		zc_barrier();
+		pos = a_head->reserve;
+		off = pos % data_size;
+		pad = (data_size - off < need) ? data_size - off : 0;
+		if (pos + pad + need - read > data_size) {
+			ATOM_F_ADD(&(a_head->dropped), 1);
+			return;
+		}
+	} while (!ATOM_CASB(&(a_head->reserve), pos, pos + pad + need));
+
+	if (pad) {
+		a_slot = (zlog_shm_slot_t *)(a_shm->data + off);
+		a_slot->len = ZLOG_SHM_PAD;
+		zc_barrier();
+		a_slot->size = pad;
+		off = 0;
+	}
+
+	/* a reader can tell whether we are still there */
+	if (zc_forked(a_shm->forks)) {
+		a_shm->pid = getpid();
+		zc_barrier();
+		a_shm->forks = zc_forks;
+	}
+	a_slot = (zlog_shm_slot_t *)(a_shm->data + off);
+	a_slot->len = a_shm->pid;
+	zc_barrier();
+	a_slot->size = need | ZLOG_SHM_BUSY;
+
+	memcpy(a_slot + 1, str, len);
+	a_slot->len = len;
+	zc_barrier();
+	a_slot->size = need;
+}
+
+/*******************************************************************************/
+struct zlog_shm_reader_s {
+	size_t map_size;
+	zlog_shm_head_t *head;
+	char *data;
+	uint64_t cursor;		/* read up to here, not given back yet */
+	uint64_t busy_at;		/* cursor of a busy slot seen at the last next */
+	int busy;
+};
+
+zlog_shm_reader_t *zlog_shm_open(const char *path)
+{
+	off_t file_size;
+	zlog_shm_reader_t *a_reader;
+
+	a_reader = calloc(1, sizeof(zlog_shm_reader_t));
+	if (!a_reader) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+
+	if (zlog_shm_map(path, O_RDWR, 0, 0, &(a_reader->head), &file_size)) {
+		zc_error("zlog_shm_map fail");
+		free(a_reader);
+		return NULL;
+	}
+	a_reader->map_size = file_size;
+	if (memcmp(a_reader->head->magic, ZLOG_SHM_MAGIC, sizeof(a_reader->head->magic))
+		|| a_reader->head->head_size != ZLOG_SHM_HEAD_SIZE
+		|| file_size != (off_t)(ZLOG_SHM_HEAD_SIZE + a_reader->head->data_size)) {
+		zc_error("[%s] is not a shm file", path);
+		zlog_shm_close(a_reader);
+		return NULL;
+	}
+	a_reader->data = (char *)a_reader->head + ZLOG_SHM_HEAD_SIZE;
+	a_reader->cursor = a_reader->head->read;
+	return a_reader;
+}
+
+void zlog_shm_close(zlog_shm_reader_t * a_reader)
+{
+	zc_assert(a_reader,);
+	munmap(a_reader->head, a_reader->map_size);
+	free(a_reader);
+}
+
+/* busy here at the last next too, and its writer is gone */
+static int zlog_shm_stale(zlog_shm_reader_t * a_reader, zlog_shm_slot_t * a_slot)
+{
+	if (!a_reader->busy || a_reader->busy_at != a_reader->cursor) {
+		a_reader->busy = 1;
+		a_reader->busy_at = a_reader->cursor;
+		return 0;
+	}
+	return kill((pid_t)a_slot->len, 0) && errno == ESRCH;
+}
+
+int zlog_shm_next(zlog_shm_reader_t * a_reader, const char **rec, size_t *len)
+{
+	uint64_t data_size;
+	zlog_shm_slot_t *a_slot;
+	uint32_t size;
+	int stale;
+
+	zc_assert(a_reader, -1);
+	data_size = a_reader->head->data_size;
+
+	for (;;) {
+		stale = 0;
+
+		/* a whole lap read, the rest is not given back yet */
+		if (a_reader->cursor - a_reader->head->read >= data_size) return 0;
+
+		a_slot = (zlog_shm_slot_t *)(a_reader->data + a_reader->cursor % data_size);
+		size = a_slot->size;
+		if (!size) return 0;
+		zc_barrier();
+
+		if (size & ZLOG_SHM_BUSY) {
+			if (!zlog_shm_stale(a_reader, a_slot)) return 0;
+			zc_error("writer[%u] of slot at [%llu] is gone, skip it",
+				a_slot->len, (unsigned long long)a_reader->cursor);
+			ATOM_F_ADD(&(a_reader->head->dropped), 1);
+			size &= ~ZLOG_SHM_BUSY;
+			stale = 1;
+		}
+
+		if (size % 8 || size > data_size - a_reader->cursor % data_size) {
+			zc_error("slot at [%llu] is corrupted", (unsigned long long)a_reader->cursor);
+			return -1;
+		}
+		a_reader->cursor += size;
+		if (stale || a_slot->len == ZLOG_SHM_PAD) continue;
+
+		*rec = (const char *)(a_slot + 1);
+		*len = a_slot->len;
+		return 1;
+	}
+}
+
+void zlog_shm_done(zlog_shm_reader_t * a_reader)
+{
+	uint64_t data_size;
+	uint64_t read;
+	size_t off;
+	size_t n;
+
+	zc_assert(a_reader,);
+	data_size = a_reader->head->data_size;
+	read = a_reader->head->read;
+	off = read % data_size;
+	n = a_reader->cursor - read;
+
+	/* zero for the next writers, before they may take it */
+	if (off + n > data_size) {
+		memset(a_reader->data + off, 0, data_size - off);
+		memset(a_reader->data, 0, off + n - data_size);
+	} else {
+		memset(a_reader->data + off, 0, n);
+	}
+	zc_barrier();
+	a_reader->head->read = a_reader->cursor;
+}
+
+unsigned long zlog_shm_dropped(zlog_shm_reader_t * a_reader)
+{
+	zc_assert(a_reader, 0);
+	return (unsigned long)a_reader->head->dropped;
+}
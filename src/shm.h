@@ -0,0 +1,93 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_shm_h
+#define __zlog_shm_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "zc_defs.h"
+
+/* a shm file is one page of head, then data_size bytes of ring, mapped
+ * shared by any number of writers, processes and threads, and one reader
+ *
+ * head, numbers in host byte order
+ *   0  magic "zlogshm1"
+ *   8  head_size, 4 bytes
+ *  16  data_size, 8 bytes, a multiple of 8
+ *  24  reserve, 8 bytes, bytes ever reserved by writers
+ *  32  dropped, 8 bytes, records which found no room
+ *  64  read, 8 bytes, bytes ever given back by the reader
+ *
+ * a slot starts at a multiple of 8 and never wraps
+ *   0  size, 4 bytes, of the whole slot, 0 until the writer has it,
+ *      or'ed with ZLOG_SHM_BUSY while the record is copied in
+ *   4  len, 4 bytes, of the record, ZLOG_SHM_PAD when the slot only
+ *      fills the end of the ring, the pid of the writer while busy
+ *   8  the record, then up to 7 bytes to the next slot
+ *
+ * a writer takes [reserve, reserve + size) by compare and swap, when it
+ * is within read + data_size, sets its pid and size with ZLOG_SHM_BUSY,
+ * copies the record, then sets len and size
+ * the reader reads slots from read while size is not 0, then zeroes
+ * what it has read and moves read past it, so data not reserved is zero
+ *
+ * a busy slot whose writer process is gone, seen twice by the reader, is
+ * skipped and counted in dropped, so writers and the reader should be in
+ * the same pid namespace. a writer killed between its compare and swap
+ * and setting size, a few instructions, still stops the reader there
+ *
+ * a ring is only made over when the file is not one, a ring of another
+ * size is refused, as it may be in use
+ */
+#define ZLOG_SHM_MAGIC		"zlogshm1"
+#define ZLOG_SHM_HEAD_SIZE	4096
+#define ZLOG_SHM_DEFAULT_SIZE	(16 * 1024 * 1024)
+#define ZLOG_SHM_PAD		0xFFFFFFFFU
+#define ZLOG_SHM_BUSY		1U
+
+typedef struct zlog_shm_head_s {
+	char magic[8];
+	uint32_t head_size;
+	uint32_t reserved;
+	uint64_t data_size;
+	volatile uint64_t reserve;
+	volatile uint64_t dropped;
+	char pad[24];			/* read is on a line of its own */
+	volatile uint64_t read;
+} zlog_shm_head_t;
+
+typedef struct zlog_shm_slot_s {
+	volatile uint32_t size;
+	uint32_t len;
+} zlog_shm_slot_t;
+
+typedef struct zlog_shm_s {
+	char name[MAXLEN_PATH + 1];
+	size_t map_size;
+	zlog_shm_head_t *head;
+	char *data;
+	pid_t pid;			/* put in busy slots */
+	unsigned long forks;		/* of zc_forks at pid */
+} zlog_shm_t;
+
+/* map path, a shm file of the same size is shared as it is, with what
+ * other writers and the reader have done, a shm file of another size is
+ * refused, anything else is made over as an empty ring of data_size
+ * a forked child writes to the same ring, with its own pid
+ */
+zlog_shm_t *zlog_shm_new(const char *path, size_t data_size, unsigned int perms);
+void zlog_shm_del(zlog_shm_t * a_shm);
+void zlog_shm_profile(zlog_shm_t * a_shm, int flag);
+
+/* never waits, a record which finds no room is counted in dropped */
+void zlog_shm_write(zlog_shm_t * a_shm, const char *str, size_t len);
+
+#endif
@@ -0,0 +1,631 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE	/* sendmmsg */
+#endif
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+#include "socket_client.h"
+#include "zc_defs.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define ZLOG_SOCKET_PAD	0xFFFFFFFFU	/* the rest of the ring is skipped */
+
+/* a record in the backlog, as the sender sees it */
+typedef struct zlog_socket_rec_s {
+	char *hdr;			/* 4 bytes of length, then the record */
+	uint32_t len;
+	size_t next;			/* position after it */
+	size_t span;			/* bytes it frees, pads before it too */
+} zlog_socket_rec_t;
+
+static const char *zlog_socket_type_str[] = { "unix", "unixgram", "tcp", "udp" };
+
+void zlog_socket_profile(zlog_socket_t * a_socket, int flag)
+{
+	zc_assert(a_socket,);
+	zc_profile(flag, "--socket[%p][%s][%s][backlog:%ld/%ld][sent:%lu][dropped:%lu][connects:%lu]--",
+		a_socket,
+		a_socket->addr,
+		a_socket->framing == ZLOG_SOCKET_LENGTH ? "length" : "newline",
+		(long)a_socket->used,
+		(long)a_socket->size,
+		a_socket->nsent,
+		a_socket->ndropped,
+		a_socket->nconnects);
+	return;
+}
+
+/*******************************************************************************/
+static void zlog_socket_after(struct timespec *ts, long ms)
+{
+	clock_gettime(CLOCK_REALTIME, ts);
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+static int zlog_socket_passed(const struct timespec *ts)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	return now.tv_sec > ts->tv_sec
+		|| (now.tv_sec == ts->tv_sec && now.tv_nsec >= ts->tv_nsec);
+}
+
+static int zlog_socket_is_stream(zlog_socket_t * a_socket)
+{
+	return a_socket->type == ZLOG_SOCKET_UNIX || a_socket->type == ZLOG_SOCKET_TCP;
+}
+
+/* the part after unix: or tcp: */
+static const char *zlog_socket_target(zlog_socket_t * a_socket)
+{
+	return a_socket->addr + strlen(zlog_socket_type_str[a_socket->type]) + 1;
+}
+
+static int zlog_socket_open_unix(zlog_socket_t * a_socket, int socktype)
+{
+	int fd;
+	struct sockaddr_un sun;
+	const char *path = zlog_socket_target(a_socket);
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	strncpy(sun.sun_path, path, sizeof(sun.sun_path) - 1);
+
+	fd = socket(AF_UNIX, socktype, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr *)&sun, sizeof(sun))) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int zlog_socket_open_inet(zlog_socket_t * a_socket, int socktype)
+{
+	int fd = -1;
+	int rc;
+	char host[MAXLEN_PATH + 1];
+	char *port;
+	struct addrinfo hints;
+	struct addrinfo *res;
+	struct addrinfo *ai;
+
+	/* host:port, [v6]:port */
+	strcpy(host, zlog_socket_target(a_socket));
+	port = strrchr(host, ':');
+	*port++ = '\0';
+	if (host[0] == '[') {
+		memmove(host, host + 1, strlen(host));
+		host[strlen(host) - 1] = '\0';
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = socktype;
+	rc = getaddrinfo(host, port, &hints, &res);
+	if (rc) {
+		zc_error("getaddrinfo [%s] fail, %s", a_socket->addr, gai_strerror(rc));
+		return -1;
+	}
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0) continue;
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	return fd;
+}
+
+/* return 0 when connected */
+static int zlog_socket_connect(zlog_socket_t * a_socket)
+{
+	int fd;
+	struct timeval tv;
+
+	switch (a_socket->type) {
+	case ZLOG_SOCKET_UNIX:
+		fd = zlog_socket_open_unix(a_socket, SOCK_STREAM);
+		break;
+	case ZLOG_SOCKET_UNIXGRAM:
+		fd = zlog_socket_open_unix(a_socket, SOCK_DGRAM);
+		break;
+	case ZLOG_SOCKET_TCP:
+		fd = zlog_socket_open_inet(a_socket, SOCK_STREAM);
+		break;
+	default:
+		fd = zlog_socket_open_inet(a_socket, SOCK_DGRAM);
+		break;
+	}
+	if (fd < 0) return -1;
+
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+	{
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+	}
+#endif
+	/* a peer which takes nothing is found at fini */
+	tv.tv_sec = ZLOG_SOCKET_STALL_MS / 1000;
+	tv.tv_usec = (ZLOG_SOCKET_STALL_MS % 1000) * 1000;
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	a_socket->fd = fd;
+	a_socket->partial = 0;
+	a_socket->nconnects++;
+	return 0;
+}
+
+static void zlog_socket_disconnect(zlog_socket_t * a_socket)
+{
+	if (a_socket->fd >= 0) {
+		close(a_socket->fd);
+		a_socket->fd = -1;
+	}
+	a_socket->partial = 0;
+}
+
+/*******************************************************************************/
+/* called with lock_mutex held, return 0 when there is no room
+ * the record is tag then str
+ */
+static int zlog_socket_put(zlog_socket_t * a_socket,
+		const char *tag, size_t tag_len, const char *str, size_t len)
+{
+	size_t need;
+	size_t room;
+	uint32_t hdr;
+
+	len += tag_len;
+	need = 4 + len;
+	if (len >= ZLOG_SOCKET_PAD || need > a_socket->size) return 0;
+
+	if (!a_socket->used) a_socket->head = a_socket->tail = 0;
+	if (a_socket->used == a_socket->size) return 0;
+
+	if (a_socket->tail >= a_socket->head) {
+		room = a_socket->size - a_socket->tail;
+		if (room < need) {
+			/* wrap, the rest of the end is a pad */
+			if (a_socket->head < need) return 0;
+			if (room >= 4) {
+				hdr = ZLOG_SOCKET_PAD;
+				memcpy(a_socket->buf + a_socket->tail, &hdr, 4);
+			}
+			a_socket->used += room;
+			a_socket->tail = 0;
+		}
+	} else if (a_socket->head - a_socket->tail < need) {
+		return 0;
+	}
+
+	hdr = htonl((uint32_t)len);
+	memcpy(a_socket->buf + a_socket->tail, &hdr, 4);
+	if (tag_len) memcpy(a_socket->buf + a_socket->tail + 4, tag, tag_len);
+	memcpy(a_socket->buf + a_socket->tail + 4 + tag_len, str, len - tag_len);
+	a_socket->tail += need;
+	a_socket->used += need;
+	return 1;
+}
+
+/* called with lock_mutex held, the first nrec records from head */
+static int zlog_socket_peek(zlog_socket_t * a_socket, zlog_socket_rec_t * recs, int nrec)
+{
+	int n = 0;
+	size_t pos = a_socket->head;
+	size_t left = a_socket->used;
+	size_t span = 0;
+	uint32_t hdr;
+
+	while (left && n < nrec) {
+		if (a_socket->size - pos < 4) {
+			hdr = ZLOG_SOCKET_PAD;
+		} else {
+			memcpy(&hdr, a_socket->buf + pos, 4);
+		}
+		if (hdr == ZLOG_SOCKET_PAD) {
+			span += a_socket->size - pos;
+			left -= a_socket->size - pos;
+			pos = 0;
+			continue;
+		}
+		recs[n].hdr = a_socket->buf + pos;
+		recs[n].len = ntohl(hdr);
+		pos += 4 + recs[n].len;
+		span += 4 + recs[n].len;
+		left -= 4 + recs[n].len;
+		recs[n].next = pos;
+		recs[n].span = span;
+		span = 0;
+		n++;
+	}
+	return n;
+}
+
+/* called with lock_mutex held */
+static void zlog_socket_consume(zlog_socket_t * a_socket, zlog_socket_rec_t * recs, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		a_socket->used -= recs[i].span;
+	}
+	if (n > 0) a_socket->head = recs[n - 1].next;
+}
+
+/* called with lock_mutex held, after the backlog is empty */
+static void zlog_socket_report(zlog_socket_t * a_socket)
+{
+	int len;
+	char line[128];
+
+	if (a_socket->ndropped != a_socket->nreported) {
+		len = snprintf(line, sizeof(line), "zlog: %lu records dropped, socket backlog was full\n",
+			a_socket->ndropped - a_socket->nreported);
+		a_socket->nreported = a_socket->ndropped;
+		zlog_socket_put(a_socket, a_socket->report_tag, a_socket->report_tag_len, line, len);
+	}
+}
+
+/*******************************************************************************/
+/* return records sent whole, -1 when the connection is gone, -2 when the
+ * peer takes nothing in time, -3 when the first can never be sent
+ * on a stream a part of a record is in partial
+ */
+static int zlog_socket_send_stream(zlog_socket_t * a_socket, zlog_socket_rec_t * recs, int n)
+{
+	int i;
+	int done;
+	ssize_t nsend;
+	struct iovec iov[ZLOG_SOCKET_BATCH];
+	struct msghdr msg;
+
+	for (i = 0; i < n; i++) {
+		if (a_socket->framing == ZLOG_SOCKET_LENGTH) {
+			iov[i].iov_base = recs[i].hdr;
+			iov[i].iov_len = 4 + recs[i].len;
+		} else {
+			iov[i].iov_base = recs[i].hdr + 4;
+			iov[i].iov_len = recs[i].len;
+		}
+	}
+	iov[0].iov_base = (char *)iov[0].iov_base + a_socket->partial;
+	iov[0].iov_len -= a_socket->partial;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = n;
+	do {
+		nsend = sendmsg(a_socket->fd, &msg, MSG_NOSIGNAL);
+	} while (nsend < 0 && errno == EINTR);
+	if (nsend < 0) {
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? -2 : -1;
+	}
+
+	for (done = 0; done < n && (size_t)nsend >= iov[done].iov_len; done++) {
+		nsend -= iov[done].iov_len;
+	}
+	if (done < n) {
+		a_socket->partial = (done == 0 ? a_socket->partial : 0) + nsend;
+	} else {
+		a_socket->partial = 0;
+	}
+	return done;
+}
+
+static int zlog_socket_send_dgram(zlog_socket_t * a_socket, zlog_socket_rec_t * recs, int n)
+{
+	int i;
+	int done;
+	struct iovec iov[ZLOG_SOCKET_BATCH];
+#if defined(__linux__)
+	struct mmsghdr msgs[ZLOG_SOCKET_BATCH];
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < n; i++) {
+		iov[i].iov_base = recs[i].hdr + 4;
+		iov[i].iov_len = recs[i].len;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	do {
+		done = sendmmsg(a_socket->fd, msgs, n, MSG_NOSIGNAL);
+	} while (done < 0 && errno == EINTR);
+#else
+	struct msghdr msg;
+
+	for (done = 0, i = 0; i < n; i++, done++) {
+		iov[i].iov_base = recs[i].hdr + 4;
+		iov[i].iov_len = recs[i].len;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov[i];
+		msg.msg_iovlen = 1;
+		if (sendmsg(a_socket->fd, &msg, MSG_NOSIGNAL) < 0) {
+			if (errno == EINTR) {
+				i--;
+				done--;
+				continue;
+			}
+			if (done == 0) done = -1;
+			break;
+		}
+	}
+#endif
+	if (done >= 0) return done;
+	if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) return -2;
+	if (errno == EMSGSIZE) return -3;
+	return -1;
+}
+
+/*******************************************************************************/
+static void *zlog_socket_send_loop(void *arg)
+{
+	zlog_socket_t *a_socket = arg;
+	zlog_socket_rec_t recs[ZLOG_SOCKET_BATCH];
+	int n;
+	int rc;
+
+	pthread_mutex_lock(&(a_socket->lock_mutex));
+	for (;;) {
+		while (!a_socket->used && !a_socket->stopping) {
+			pthread_cond_wait(&(a_socket->cond), &(a_socket->lock_mutex));
+		}
+		if (!a_socket->used) break;
+		if (a_socket->stopping && zlog_socket_passed(&(a_socket->stop_at))) {
+			zc_error("[%s] is not taking records, [%ld] bytes lost",
+				a_socket->addr, (long)a_socket->used);
+			break;
+		}
+
+		if (a_socket->fd < 0) {
+			if (!zlog_socket_passed(&(a_socket->retry_at))) {
+				pthread_cond_timedwait(&(a_socket->cond), &(a_socket->lock_mutex),
+					&(a_socket->retry_at));
+				continue;
+			}
+			pthread_mutex_unlock(&(a_socket->lock_mutex));
+			rc = zlog_socket_connect(a_socket);
+			pthread_mutex_lock(&(a_socket->lock_mutex));
+			if (rc) {
+				zlog_socket_after(&(a_socket->retry_at), a_socket->retry_ms);
+				if (!a_socket->stopping) a_socket->retry_ms *= 2;
+				if (a_socket->retry_ms > ZLOG_SOCKET_RETRY_MAX_MS) {
+					a_socket->retry_ms = ZLOG_SOCKET_RETRY_MAX_MS;
+				}
+				continue;
+			}
+			a_socket->retry_ms = ZLOG_SOCKET_RETRY_MIN_MS;
+		}
+
+		/* only this thread frees, what is peeked stays while unlocked */
+		n = zlog_socket_peek(a_socket, recs, ZLOG_SOCKET_BATCH);
+		pthread_mutex_unlock(&(a_socket->lock_mutex));
+
+		if (zlog_socket_is_stream(a_socket)) {
+			rc = zlog_socket_send_stream(a_socket, recs, n);
+		} else {
+			rc = zlog_socket_send_dgram(a_socket, recs, n);
+		}
+
+		pthread_mutex_lock(&(a_socket->lock_mutex));
+		if (rc == -1) {
+			zc_error("send to [%s] fail, errno[%d], connect again", a_socket->addr, errno);
+			zlog_socket_disconnect(a_socket);
+			zlog_socket_after(&(a_socket->retry_at), a_socket->retry_ms);
+			continue;
+		}
+		if (rc == -3) {
+			zc_error("record of [%lu] bytes is too large for [%s]",
+				(unsigned long)recs[0].len, a_socket->addr);
+			zlog_socket_consume(a_socket, recs, 1);
+			a_socket->ndropped++;
+		} else if (rc > 0) {
+			zlog_socket_consume(a_socket, recs, rc);
+			a_socket->nsent += rc;
+		}
+		if (rc == -3 || rc > 0) {
+			if (!a_socket->used) zlog_socket_report(a_socket);
+		}
+	}
+	pthread_mutex_unlock(&(a_socket->lock_mutex));
+	return NULL;
+}
+
+/*******************************************************************************/
+static int zlog_socket_start(zlog_socket_t * a_socket)
+{
+	int rc;
+
+	rc = pthread_create(&(a_socket->tid), NULL, zlog_socket_send_loop, a_socket);
+	if (rc) {
+		zc_error("pthread_create fail, rc[%d]", rc);
+		return -1;
+	}
+	a_socket->started = 1;
+	return 0;
+}
+
+/* the backlog of the parent is sent by the parent, start over empty
+ * on a connection of our own
+ */
+static int zlog_socket_atfork_reset(void *arg)
+{
+	zlog_socket_t *a_socket = arg;
+
+	if (pthread_mutex_init(&(a_socket->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		return -1;
+	}
+	if (pthread_cond_init(&(a_socket->cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		return -1;
+	}
+	zlog_socket_disconnect(a_socket);
+	a_socket->head = a_socket->tail = a_socket->used = 0;
+	a_socket->retry_ms = ZLOG_SOCKET_RETRY_MIN_MS;
+	a_socket->started = 0;
+	a_socket->stopping = 0;
+	return zlog_socket_start(a_socket);
+}
+
+int zlog_socket_write_tagged(zlog_socket_t * a_socket,
+		const char *tag, size_t tag_len, const char *str, size_t len)
+{
+	if (zc_forked(a_socket->forks)
+		&& zc_fork_reset(&(a_socket->forks), zlog_socket_atfork_reset, a_socket)) {
+		zc_error("zlog_socket_atfork_reset fail");
+		return -1;
+	}
+
+	pthread_mutex_lock(&(a_socket->lock_mutex));
+	if (zlog_socket_put(a_socket, tag, tag_len, str, len)) {
+		pthread_cond_signal(&(a_socket->cond));
+	} else {
+		a_socket->ndropped++;
+	}
+	pthread_mutex_unlock(&(a_socket->lock_mutex));
+	return 0;
+}
+
+int zlog_socket_write(zlog_socket_t * a_socket, const char *str, size_t len)
+{
+	return zlog_socket_write_tagged(a_socket, NULL, 0, str, len);
+}
+
+/*******************************************************************************/
+void zlog_socket_del(zlog_socket_t * a_socket)
+{
+	zc_assert(a_socket,);
+
+	if (a_socket->started && !zc_forked(a_socket->forks)) {
+		pthread_mutex_lock(&(a_socket->lock_mutex));
+		a_socket->stopping = 1;
+		zlog_socket_after(&(a_socket->stop_at), ZLOG_SOCKET_STALL_MS);
+		/* no backoff at fini, the time is short */
+		a_socket->retry_ms = ZLOG_SOCKET_RETRY_MIN_MS;
+		clock_gettime(CLOCK_REALTIME, &(a_socket->retry_at));
+		pthread_cond_broadcast(&(a_socket->cond));
+		pthread_mutex_unlock(&(a_socket->lock_mutex));
+		pthread_join(a_socket->tid, NULL);
+	}
+
+	if (a_socket->fd >= 0) close(a_socket->fd);
+	pthread_cond_destroy(&(a_socket->cond));
+	pthread_mutex_destroy(&(a_socket->lock_mutex));
+	free(a_socket->buf);
+	zc_debug("zlog_socket_del[%p]", a_socket);
+	free(a_socket);
+	return;
+}
+
+/* return ZLOG_SOCKET_* of addr, -1 when it is none of them */
+static int zlog_socket_parse(const char *addr)
+{
+	int i;
+	size_t n;
+	const char *p;
+
+	for (i = 0; i < (int)(sizeof(zlog_socket_type_str) / sizeof(zlog_socket_type_str[0])); i++) {
+		n = strlen(zlog_socket_type_str[i]);
+		if (STRNCMP(addr, ==, zlog_socket_type_str[i], n) && addr[n] == ':') break;
+	}
+	if (i == sizeof(zlog_socket_type_str) / sizeof(zlog_socket_type_str[0])) return -1;
+
+	p = addr + strlen(zlog_socket_type_str[i]) + 1;
+	if (i == ZLOG_SOCKET_UNIX || i == ZLOG_SOCKET_UNIXGRAM) {
+		if (*p == '\0' || strlen(p) >= sizeof(((struct sockaddr_un *)0)->sun_path)) return -1;
+	} else {
+		p = strrchr(p, ':');
+		if (!p || p[1] == '\0') return -1;
+	}
+	return i;
+}
+
+zlog_socket_t *zlog_socket_new(const char *addr, int framing, size_t backlog)
+{
+	zlog_socket_t *a_socket;
+
+	zc_assert(addr, NULL);
+
+	if (strlen(addr) > MAXLEN_PATH) {
+		zc_error("socket address[%s] is too long", addr);
+		return NULL;
+	}
+
+	a_socket = calloc(1, sizeof(zlog_socket_t));
+	if (!a_socket) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	strcpy(a_socket->addr, addr);
+	a_socket->type = zlog_socket_parse(addr);
+	a_socket->framing = framing;
+	a_socket->fd = -1;
+	zc_fork_watch();
+	a_socket->forks = zc_forks;
+	a_socket->size = backlog ? backlog : ZLOG_SOCKET_DEFAULT_BACKLOG;
+	a_socket->retry_ms = ZLOG_SOCKET_RETRY_MIN_MS;
+
+	if (a_socket->type < 0) {
+		zc_error("socket address[%s] should be unix:path, unixgram:path, "
+			"tcp:host:port or udp:host:port", addr);
+		free(a_socket);
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&(a_socket->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_socket);
+		return NULL;
+	}
+	if (pthread_cond_init(&(a_socket->cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		pthread_mutex_destroy(&(a_socket->lock_mutex));
+		free(a_socket);
+		return NULL;
+	}
+
+	a_socket->buf = malloc(a_socket->size);
+	if (!a_socket->buf) {
+		zc_error("malloc fail, errno[%d]", errno);
+		goto err;
+	}
+
+	if (zlog_socket_start(a_socket)) goto err;
+
+	zlog_socket_profile(a_socket, ZC_DEBUG);
+	return a_socket;
+err:
+	zlog_socket_del(a_socket);
+	return NULL;
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_socket_client_h
+#define __zlog_socket_client_h
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "zc_defs.h"
+
+/* address of >socket "unix:/run/aa.sock" */
+#define ZLOG_SOCKET_UNIX	0	/* unix:/path, stream */
+#define ZLOG_SOCKET_UNIXGRAM	1	/* unixgram:/path, datagram */
+#define ZLOG_SOCKET_TCP		2	/* tcp:host:port */
+#define ZLOG_SOCKET_UDP		3	/* udp:host:port */
+
+/* on a stream, records are sent as they are, ended by the %n of the format,
+ * or each after 4 bytes of its length in network order
+ * a datagram is one record, either way
+ */
+#define ZLOG_SOCKET_NEWLINE	0
+#define ZLOG_SOCKET_LENGTH	1
+
+#define ZLOG_SOCKET_DEFAULT_BACKLOG	(4 * 1024 * 1024)
+#define ZLOG_SOCKET_BATCH	64	/* records in one sendmsg or sendmmsg */
+#define ZLOG_SOCKET_RETRY_MIN_MS	100
+#define ZLOG_SOCKET_RETRY_MAX_MS	10000
+#define ZLOG_SOCKET_STALL_MS	5000	/* at fini, the peer is given up after this */
+
+/* records wait in the backlog, each after a 4 byte length in network order,
+ * a sender thread sends them by batches, connects, and connects again with
+ * a backoff when the peer is gone, the backlog is kept meanwhile
+ * a record which does not fit in the backlog is dropped and counted
+ */
+typedef struct zlog_socket_s {
+	char addr[MAXLEN_PATH + 1];
+	int type;			/* ZLOG_SOCKET_UNIX ... */
+	int framing;			/* ZLOG_SOCKET_NEWLINE or LENGTH */
+	int fd;
+	unsigned long forks;		/* of zc_forks, the backlog of the parent is not ours */
+
+	pthread_mutex_t lock_mutex;
+	pthread_cond_t cond;		/* a record came, or stopping */
+	char *buf;			/* ring, a record does not wrap */
+	size_t size;
+	size_t head;
+	size_t tail;
+	size_t used;			/* bytes from head to tail, pads too */
+	size_t partial;			/* bytes of the record at head sent on the stream */
+
+	pthread_t tid;
+	int started;
+	int stopping;
+	struct timespec stop_at;	/* the backlog is given up after this */
+	struct timespec retry_at;
+	long retry_ms;			/* doubles each failed connect */
+
+	unsigned long nsent;
+	unsigned long ndropped;
+	unsigned long nreported;	/* of ndropped, sent as a record */
+	unsigned long nconnects;
+
+	char report_tag[16];		/* put before the line of how many were dropped */
+	size_t report_tag_len;
+} zlog_socket_t;
+
+/* addr is one of the forms above, backlog 0 is the default
+ * the peer need not be there yet
+ */
+zlog_socket_t *zlog_socket_new(const char *addr, int framing, size_t backlog);
+/* what is in the backlog is sent first, unless the peer takes nothing
+ * in ZLOG_SOCKET_STALL_MS, or can not be connected in that time
+ */
+void zlog_socket_del(zlog_socket_t * a_socket);
+void zlog_socket_profile(zlog_socket_t * a_socket, int flag);
+
+/* copy a record into the backlog, never waits for the peer */
+int zlog_socket_write(zlog_socket_t * a_socket, const char *str, size_t len);
+/* the same, a record of tag and str */
+int zlog_socket_write_tagged(zlog_socket_t * a_socket,
+		const char *tag, size_t tag_len, const char *str, size_t len);
+
+#endif
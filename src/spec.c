@@ -25,6 +25,7 @@
 
 
 #define ZLOG_DEFAULT_TIME_FMT "%F %T"
+#define ZLOG_JSON_TIME_FMT "%Y-%m-%dT%H:%M:%S"
 #define	ZLOG_HEX_HEAD  \
 	"\n             0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F    0123456789ABCDEF"
 
@@ -32,20 +33,22 @@
 void zlog_spec_profile(zlog_spec_t * a_spec, int flag)
 {
 	zc_assert(a_spec,);
-	zc_profile(flag, "----spec[%p][%.*s][%s|%d][%s,%ld,%ld][%s]----",
+	zc_profile(flag, "----spec[%p][%.*s][%s|%d][%s,%ld,%ld][%s:%d][%s]----",
 		a_spec,
 		a_spec->len, a_spec->str,
 		a_spec->time_fmt,
 		a_spec->time_cache_index,
 		a_spec->print_fmt, (long)a_spec->max_width, (long)a_spec->min_width,
-		a_spec->mdc_key);
+		a_spec->mdc_key, a_spec->mdc_id,
+		a_spec->kv_key);
 	return;
 }
 
 /*******************************************************************************/
 /* implementation of write function */
 
-static int zlog_spec_write_time(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
+/* the time string of this spec, made again only when the second changes */
+static zlog_time_cache_t *zlog_spec_time_cache(zlog_spec_t * a_spec, zlog_thread_t * a_thread)
 {
 	zlog_time_cache_t * a_cache = a_thread->event->time_caches + a_spec->time_cache_index;
 	time_t now_sec = a_thread->event->time_stamp.tv_sec;
@@ -72,6 +75,13 @@ static int zlog_spec_write_time(zlog_spec_t * a_spec, zlog_thread_t * a_thread,
 		a_thread->cur_time_str = a_cache->str;
 	}
 
+	return a_cache;
+}
+
+static int zlog_spec_write_time(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
+{
+	zlog_time_cache_t * a_cache = zlog_spec_time_cache(a_spec, a_thread);
+
 	return zlog_buf_append(a_buf, a_cache->str, a_cache->len);
 }
 
@@ -121,10 +131,15 @@ static int zlog_spec_write_mdc(zlog_spec_t * a_spec, zlog_thread_t * a_thread, z
 {
 	zlog_mdc_kv_t *a_mdc_kv;
 
-	a_mdc_kv = zlog_mdc_get_kv(a_thread->mdc, a_spec->mdc_key);
-	if (!a_mdc_kv) {
-		zc_error("zlog_mdc_get_kv key[%s] fail", a_spec->mdc_key);
-		return 0;
+	if (a_spec->mdc_id >= 0) {
+		a_mdc_kv = zlog_mdc_get_kv_by_id(a_thread->mdc, a_spec->mdc_id);
+		if (!a_mdc_kv) {
+			zc_error("mdc key[%s] is not put", a_spec->mdc_key);
+			return 0;
+		}
+	} else {
+		a_mdc_kv = zlog_mdc_get_kv(a_thread->mdc, a_spec->mdc_key);
+		if (!a_mdc_kv) return 0;
 	}
 
 	a_thread->cur_mdc_kv = a_mdc_kv;
@@ -132,6 +147,19 @@ static int zlog_spec_write_mdc(zlog_spec_t * a_spec, zlog_thread_t * a_thread, z
 	return zlog_buf_append(a_buf, a_mdc_kv->value, a_mdc_kv->value_len);
 }
 
+/* %k, the fields of zlog_kv() as logfmt */
+static int zlog_spec_write_kv(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
+{
+	return zlog_kv_write_logfmt(a_buf, a_thread->event->fields, a_thread->event->field_count);
+}
+
+/* %k(key), the value of one */
+static int zlog_spec_write_kv_value(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
+{
+	return zlog_kv_write_value(a_buf, a_thread->event->fields, a_thread->event->field_count,
+		a_spec->kv_key);
+}
+
 static int zlog_spec_write_str(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
 {
 	return zlog_buf_append(a_buf, a_spec->str, a_spec->len);
@@ -242,6 +270,11 @@ static int zlog_spec_write_level_uppercase(zlog_spec_t * a_spec, zlog_thread_t *
 
 static int zlog_spec_write_usrmsg(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
 {
+	if (a_thread->usr_msg_ready && a_buf != a_thread->usr_msg_buf) {
+		return zlog_buf_append(a_buf,
+			zlog_buf_str(a_thread->usr_msg_buf), zlog_buf_len(a_thread->usr_msg_buf));
+	}
+
 	if (a_thread->event->generate_cmd == ZLOG_FMT) {
 		if (a_thread->event->str_format) {
 			return zlog_buf_vprintf(a_buf,
@@ -331,6 +364,17 @@ static int zlog_spec_write_usrmsg(zlog_spec_t * a_spec, zlog_thread_t * a_thread
 		}
 
 		return 0;
+	} else if (a_thread->event->generate_cmd == ZLOG_KV) {
+		/* the message, then the fields as logfmt */
+		int rc;
+		const char *msg = a_thread->event->str_format;
+
+		if (!msg) msg = "msg=(null)";
+		rc = zlog_buf_append(a_buf, msg, strlen(msg));
+		if (rc || !a_thread->event->field_count) return rc;
+		rc = zlog_buf_append(a_buf, " ", 1);
+		if (rc) return rc;
+		return zlog_kv_write_logfmt(a_buf, a_thread->event->fields, a_thread->event->field_count);
 	}
 
 	return 0;
@@ -364,6 +408,89 @@ static int zlog_spec_gen_msg_reformat(zlog_spec_t * a_spec, zlog_thread_t * a_th
 		a_spec->left_adjust, a_spec->min_width, a_spec->max_width);
 }
 
+int zlog_spec_gen_usrmsg(zlog_thread_t * a_thread)
+{
+	if (a_thread->usr_msg_ready) return 0;
+
+	zlog_buf_restart(a_thread->usr_msg_buf);
+	if (zlog_spec_write_usrmsg(NULL, a_thread, a_thread->usr_msg_buf) < 0) {
+		zc_error("zlog_spec_write_usrmsg fail");
+		return -1;
+	}
+	a_thread->usr_msg_ready = 1;
+	return 0;
+}
+
+/* %j, %m escaped for the inside of a json string */
+static int zlog_spec_write_usrmsg_json(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
+{
+	if (zlog_spec_gen_usrmsg(a_thread)) {
+		zc_error("zlog_spec_gen_usrmsg fail");
+		return -1;
+	}
+	return zlog_buf_append_json(a_buf,
+		zlog_buf_str(a_thread->usr_msg_buf), zlog_buf_len(a_thread->usr_msg_buf));
+}
+
+#define zlog_spec_json_key(a_buf, key) zlog_buf_append(a_buf, key, sizeof(key) - 1)
+
+/* %J, the event as a json object of one line
+ * {"time":"2012-12-13T16:12:40.123456","level":"INFO","category":"cat",
+ *  "file":"a.c","line":10,"func":"main","pid":12,"tid":34,"msg":"hello"}
+ * fields of zlog_kv() come after msg
+ */
+static int zlog_spec_write_json(zlog_spec_t * a_spec, zlog_thread_t * a_thread, zlog_buf_t * a_buf)
+{
+	int rc;
+	zlog_event_t *a_event = a_thread->event;
+	zlog_time_cache_t *a_cache;
+	zlog_level_t *a_level;
+	const char *msg;
+	size_t msg_len;
+
+	/* fields of zlog_kv() are members of the object, not in msg */
+	if (a_event->generate_cmd == ZLOG_KV) {
+		msg = a_event->str_format ? a_event->str_format : "";
+		msg_len = strlen(msg);
+	} else {
+		if (zlog_spec_gen_usrmsg(a_thread)) {
+			zc_error("zlog_spec_gen_usrmsg fail");
+			return -1;
+		}
+		msg = zlog_buf_str(a_thread->usr_msg_buf);
+		msg_len = zlog_buf_len(a_thread->usr_msg_buf);
+	}
+	a_cache = zlog_spec_time_cache(a_spec, a_thread);
+	a_level = zlog_level_list_get(zlog_env_conf->levels, a_event->level);
+
+	if ((rc = zlog_spec_json_key(a_buf, "{\"time\":\""))) return rc;
+	if ((rc = zlog_buf_append_json(a_buf, a_cache->str, a_cache->len))) return rc;
+	/* %J without a time format, microseconds after the seconds */
+	if (a_spec->str[a_spec->len - 1] == 'J') {
+		if ((rc = zlog_buf_append(a_buf, ".", 1))) return rc;
+		if ((rc = zlog_buf_printf_dec32(a_buf, a_event->time_stamp.tv_usec, 6))) return rc;
+	}
+	if ((rc = zlog_spec_json_key(a_buf, "\",\"level\":\""))) return rc;
+	if ((rc = zlog_buf_append_json(a_buf, a_level->str_uppercase, a_level->str_len))) return rc;
+	if ((rc = zlog_spec_json_key(a_buf, "\",\"category\":\""))) return rc;
+	if ((rc = zlog_buf_append_json(a_buf, a_event->category_name, a_event->category_name_len))) return rc;
+	if ((rc = zlog_spec_json_key(a_buf, "\",\"file\":\""))) return rc;
+	if ((rc = zlog_buf_append_json(a_buf, a_event->file, a_event->file_len))) return rc;
+	if ((rc = zlog_spec_json_key(a_buf, "\",\"line\":"))) return rc;
+	if ((rc = zlog_buf_printf_dec64(a_buf, a_event->line, 0))) return rc;
+	if ((rc = zlog_spec_json_key(a_buf, ",\"func\":\""))) return rc;
+	if ((rc = zlog_buf_append_json(a_buf, a_event->func, a_event->func_len))) return rc;
+	if ((rc = zlog_spec_json_key(a_buf, "\",\"pid\":"))) return rc;
+	if ((rc = zlog_buf_append(a_buf, a_event->pid_str, a_event->pid_str_len))) return rc;
+	if ((rc = zlog_spec_json_key(a_buf, ",\"tid\":"))) return rc;
+	if ((rc = zlog_buf_append(a_buf, a_event->tid_str, a_event->tid_str_len))) return rc;
+	if ((rc = zlog_spec_json_key(a_buf, ",\"msg\":\""))) return rc;
+	if ((rc = zlog_buf_append_json(a_buf, msg, msg_len))) return rc;
+	if ((rc = zlog_buf_append(a_buf, "\"", 1))) return rc;
+	if ((rc = zlog_kv_write_json(a_buf, a_event->fields, a_event->field_count))) return rc;
+	return zlog_buf_append(a_buf, "}", 1);
+}
+
 /*******************************************************************************/
 static int zlog_spec_gen_path_direct(zlog_spec_t * a_spec, zlog_thread_t * a_thread)
 {
@@ -532,6 +659,59 @@ zlog_spec_t *zlog_spec_new(char *pattern_start, char **pattern_next,
 			break;
 		}
 
+		if (*p == 'J') {
+			/* %J or %J(%s), time of the object as %d() takes it */
+			if (*(p+1) != '(') {
+				strcpy(a_spec->time_fmt, ZLOG_JSON_TIME_FMT);
+				p++;
+			} else {
+				nread = 0;
+				nscan = sscanf(p, "J(%[^)])%n", a_spec->time_fmt, &nread);
+				if (nscan != 1) {
+					zc_error("in string[%s] time format of %%J is empty", a_spec->str);
+					goto err;
+				}
+				p += nread;
+				if (*(p - 1) != ')') {
+					zc_error("in string[%s] can't find match \')\'", a_spec->str);
+					goto err;
+				}
+			}
+
+			a_spec->time_cache_index = *time_cache_count;
+			(*time_cache_count)++;
+			a_spec->write_buf = zlog_spec_write_json;
+
+			*pattern_next = p;
+			a_spec->len = p - a_spec->str;
+			break;
+		}
+
+		if (*p == 'k') {
+			/* %k or %k(key) */
+			if (*(p+1) != '(') {
+				p++;
+				a_spec->write_buf = zlog_spec_write_kv;
+			} else {
+				nread = 0;
+				nscan = sscanf(p, "k(%[^)])%n", a_spec->kv_key, &nread);
+				if (nscan != 1) {
+					zc_error("in string[%s] key of %%k() is empty", a_spec->str);
+					goto err;
+				}
+				p += nread;
+				if (*(p - 1) != ')') {
+					zc_error("in string[%s] can't find match \')\'", a_spec->str);
+					goto err;
+				}
+				a_spec->write_buf = zlog_spec_write_kv_value;
+			}
+
+			*pattern_next = p;
+			a_spec->len = p - a_spec->str;
+			break;
+		}
+
 		if (*p == 'M') {
 			nread = 0;
 			nscan = sscanf(p, "M(%[^)])%n", a_spec->mdc_key, &nread);
@@ -547,6 +727,9 @@ zlog_spec_t *zlog_spec_new(char *pattern_start, char **pattern_next,
 				goto err;
 			}
 
+			/* -1 when all ids are taken, then it is found by name */
+			a_spec->mdc_id = zlog_mdc_key_intern(a_spec->mdc_key);
+
 			*path_spec_flag |= PATH_USE_MDC;
 			*pattern_next = p;
 			a_spec->len = p - a_spec->str;
@@ -597,6 +780,9 @@ zlog_spec_t *zlog_spec_new(char *pattern_start, char **pattern_next,
 		case 'm':
 			a_spec->write_buf = zlog_spec_write_usrmsg;
 			break;
+		case 'j':
+			a_spec->write_buf = zlog_spec_write_usrmsg_json;
+			break;
 		case 'n':
 			a_spec->write_buf = zlog_spec_write_newline;
 			break;
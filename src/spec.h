@@ -39,6 +39,8 @@ struct zlog_spec_s {
 	char time_fmt[MAXLEN_CFG_NAME + 1];
 	int time_cache_index;
 	char mdc_key[MAXLEN_CFG_NAME + 1];
+	int mdc_id;			/* of mdc_key, interned by zlog_spec_new, or -1 */
+	char kv_key[MAXLEN_CFG_NAME + 1];
 
 	char print_fmt[16 + 1];
 	int left_adjust;
@@ -56,6 +58,11 @@ zlog_spec_t *zlog_spec_new(char *pattern_start, char **pattern_end,
 void zlog_spec_del(zlog_spec_t * a_spec);
 void zlog_spec_profile(zlog_spec_t * a_spec, int flag);
 
+/* render %m of the event into usr_msg_buf of a_thread, once for all rules
+ * and specs of it, %m takes it from there then
+ */
+int zlog_spec_gen_usrmsg(zlog_thread_t * a_thread);
+
 #define zlog_spec_gen_msg(a_spec, a_thread) \
 	a_spec->gen_msg(a_spec, a_thread)
 
@@ -0,0 +1,540 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "stream.h"
+#include "compress.h"
+#include "crash.h"
+#include "zc_defs.h"
+
+void zlog_stream_profile(zlog_stream_t * a_stream, int flag)
+{
+	zc_assert(a_stream,);
+	zc_profile(flag, "--stream[%p][%s][fd:%d][block:%ld][flush:%ld][compress:%d][lanes:%d][pending:%d]--",
+		a_stream,
+		a_stream->name,
+		*(a_stream->fd),
+		(long)a_stream->block_size,
+		a_stream->flush_period,
+		a_stream->compress,
+		a_stream->nlanes,
+		a_stream->npending);
+	if (a_stream->worker) zlog_worker_profile(a_stream->worker, flag);
+	return;
+}
+
+/*******************************************************************************/
+/* called with lock_mutex held */
+static zlog_stream_block_t *zlog_stream_block_get(zlog_stream_t * a_stream, size_t len)
+{
+	zlog_stream_block_t *a_block;
+	size_t size;
+
+	if (len <= a_stream->block_size && a_stream->free_blocks) {
+		a_block = a_stream->free_blocks;
+		a_stream->free_blocks = a_block->next;
+		a_block->next = NULL;
+		a_block->len = 0;
+		return a_block;
+	}
+
+	/* a record larger than block_size gets a block of its own */
+	size = len > a_stream->block_size ? len : a_stream->block_size;
+	a_block = malloc(sizeof(zlog_stream_block_t) + size);
+	if (!a_block) {
+		zc_error("malloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	a_block->stream = a_stream;
+	a_block->next = NULL;
+	a_block->size = size;
+	a_block->len = 0;
+	return a_block;
+}
+
+/* called with lock_mutex held */
+static void zlog_stream_block_put(zlog_stream_t * a_stream, zlog_stream_block_t * a_block)
+{
+	if (a_block->size != a_stream->block_size) {
+		free(a_block);
+		return;
+	}
+	a_block->next = a_stream->free_blocks;
+	a_stream->free_blocks = a_block;
+}
+
+static void zlog_stream_block_free_list(zlog_stream_block_t * a_block)
+{
+	zlog_stream_block_t *next;
+
+	for (; a_block; a_block = next) {
+		next = a_block->next;
+		free(a_block);
+	}
+}
+
+/* called with lock_mutex of a_lane held, return 1 if a block is sealed */
+static int zlog_stream_seal(zlog_stream_t * a_stream, zlog_stream_lane_t * a_lane)
+{
+	zlog_stream_block_t *a_block = a_lane->block;
+
+	if (!a_block || a_block->len == 0) return 0;
+
+	a_lane->block = NULL;
+	pthread_mutex_lock(&(a_stream->lock_mutex));
+	if (a_stream->tail) {
+		a_stream->tail->next = a_block;
+	} else {
+		a_stream->head = a_block;
+	}
+	a_stream->tail = a_block;
+	a_stream->npending++;
+	pthread_mutex_unlock(&(a_stream->lock_mutex));
+	return 1;
+}
+
+static int zlog_stream_seal_all(zlog_stream_t * a_stream)
+{
+	int i;
+	int nsealed = 0;
+	zlog_stream_lane_t *a_lane;
+
+	for (i = 0; i < a_stream->nlanes; i++) {
+		a_lane = &(a_stream->lanes[i]);
+		pthread_mutex_lock(&(a_lane->lock_mutex));
+		nsealed += zlog_stream_seal(a_stream, a_lane);
+		pthread_mutex_unlock(&(a_lane->lock_mutex));
+	}
+	return nsealed;
+}
+
+static int zlog_stream_write_fd(int fd, const unsigned char *buf, size_t len)
+{
+	ssize_t nwrite;
+
+	while (len > 0) {
+		nwrite = write(fd, buf, len);
+		if (nwrite < 0) {
+			if (errno == EINTR) continue;
+			zc_error("write fail, errno[%d]", errno);
+			return -1;
+		}
+		buf += nwrite;
+		len -= nwrite;
+	}
+	return 0;
+}
+
+/* write out all sealed blocks, in worker or, when it can't, in caller */
+static void zlog_stream_drain(zlog_stream_t * a_stream)
+{
+	long nzip;
+	zlog_stream_block_t *a_block;
+
+	pthread_mutex_lock(&(a_stream->write_mutex));
+	for (;;) {
+		/* a crash flush writes them out */
+		if (!ATOM_CASB(&(a_stream->writing), 0, 1)) break;
+
+		pthread_mutex_lock(&(a_stream->lock_mutex));
+		a_block = a_stream->head;
+		if (a_block) {
+			a_stream->head = a_block->next;
+			if (!a_stream->head) a_stream->tail = NULL;
+		}
+		pthread_mutex_unlock(&(a_stream->lock_mutex));
+		if (!a_block) {
+			ATOM_CASB(&(a_stream->writing), 1, 0);
+			break;
+		}
+
+		if (!a_stream->compress) {
+			if (zlog_stream_write_fd(*(a_stream->fd),
+					(unsigned char *)a_block->data, a_block->len) == 0) {
+				ATOM_ADD_F(a_stream->file_size, a_block->len);
+			}
+		} else {
+			/* one frame, one write, a reader never sees half a frame */
+			nzip = zlog_compress_frame(a_block->data, a_block->len,
+					&(a_stream->zbuf), &(a_stream->zbuf_size));
+			if (nzip < 0) {
+				zc_error("zlog_compress_frame fail, [%ld] bytes lost", (long)a_block->len);
+			} else if (zlog_stream_write_fd(*(a_stream->fd), a_stream->zbuf, nzip) == 0) {
+				ATOM_ADD_F(a_stream->file_size, nzip);
+			}
+		}
+
+		pthread_mutex_lock(&(a_stream->lock_mutex));
+		zlog_stream_block_put(a_stream, a_block);
+		a_stream->npending--;
+		pthread_cond_broadcast(&(a_stream->done_cond));
+		pthread_mutex_unlock(&(a_stream->lock_mutex));
+		ATOM_CASB(&(a_stream->writing), 1, 0);
+	}
+	pthread_mutex_unlock(&(a_stream->write_mutex));
+}
+
+static void zlog_stream_drain_run(zlog_worker_t * a_worker, void *arg)
+{
+	zlog_stream_drain(arg);
+}
+
+/* every flush_period, seal what has been waiting */
+static void zlog_stream_tick(zlog_worker_t * a_worker, void *arg)
+{
+	zlog_stream_t *a_stream = arg;
+
+	if (zlog_stream_seal_all(a_stream)) zlog_stream_drain(a_stream);
+}
+
+/* blocks of the parent are written by the parent, start over empty */
+static int zlog_stream_atfork_reset(void *arg)
+{
+	int i;
+	zlog_stream_t *a_stream = arg;
+
+	if (pthread_mutex_init(&(a_stream->lock_mutex), NULL)
+		|| pthread_mutex_init(&(a_stream->write_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		return -1;
+	}
+	if (pthread_cond_init(&(a_stream->done_cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		return -1;
+	}
+
+	for (i = 0; i < a_stream->nlanes; i++) {
+		if (pthread_mutex_init(&(a_stream->lanes[i].lock_mutex), NULL)) {
+			zc_error("pthread_mutex_init fail, errno[%d]", errno);
+			return -1;
+		}
+		zlog_stream_block_free_list(a_stream->lanes[i].block);
+		a_stream->lanes[i].block = NULL;
+	}
+
+	zlog_stream_block_free_list(a_stream->head);
+	a_stream->head = a_stream->tail = NULL;
+	a_stream->npending = 0;
+	return 0;
+}
+
+/*******************************************************************************/
+int zlog_stream_write(zlog_stream_t * a_stream, const void *owner,
+		const char *str, size_t len, int flush)
+{
+	int nsealed = 0;
+	int is_new = 0;
+	zlog_stream_lane_t *a_lane;
+
+	zc_assert(a_stream, -1);
+	zc_assert(str, -1);
+
+	if (zc_forked(a_stream->forks)
+		&& zc_fork_reset(&(a_stream->forks), zlog_stream_atfork_reset, a_stream)) {
+		zc_error("zlog_stream_atfork_reset fail");
+		return -1;
+	}
+
+	/* records other threads wrote before it go ahead of a flushed one */
+	if (flush && a_stream->nlanes > 1) {
+		nsealed += zlog_stream_seal_all(a_stream);
+	}
+
+	a_lane = &(a_stream->lanes[((uintptr_t)owner >> 4) % a_stream->nlanes]);
+
+	pthread_mutex_lock(&(a_lane->lock_mutex));
+	if (a_lane->block && a_lane->block->len + len > a_lane->block->size) {
+		nsealed += zlog_stream_seal(a_stream, a_lane);
+	}
+	if (!a_lane->block) {
+		pthread_mutex_lock(&(a_stream->lock_mutex));
+		a_lane->block = zlog_stream_block_get(a_stream, len);
+		pthread_mutex_unlock(&(a_stream->lock_mutex));
+		if (!a_lane->block) {
+			pthread_mutex_unlock(&(a_lane->lock_mutex));
+			return -1;
+		}
+		is_new = 1;
+	}
+
+	memcpy(a_lane->block->data + a_lane->block->len, str, len);
+	a_lane->block->len += len;
+
+	if (flush || a_lane->block->len == a_lane->block->size) {
+		nsealed += zlog_stream_seal(a_stream, a_lane);
+	}
+	pthread_mutex_unlock(&(a_lane->lock_mutex));
+
+	/* a thread to flush on time, started again after fork */
+	if (is_new && zlog_worker_start(a_stream->worker)) {
+		zc_error("zlog_worker_start fail");
+	}
+
+	if (!nsealed) return 0;
+
+	/* on disk when we return, with all sealed before it */
+	if (flush) {
+		zlog_stream_drain(a_stream);
+		return 0;
+	}
+
+	if (zlog_worker_submit(a_stream->worker, zlog_stream_drain_run, NULL, a_stream)) {
+		zc_warn("zlog_worker_submit fail, write in caller");
+		zlog_stream_drain(a_stream);
+		return 0;
+	}
+
+	/* writer is behind, wait rather than grow without limit */
+	pthread_mutex_lock(&(a_stream->lock_mutex));
+	while (a_stream->npending > ZLOG_STREAM_MAX_PENDING) {
+		pthread_cond_wait(&(a_stream->done_cond), &(a_stream->lock_mutex));
+	}
+	pthread_mutex_unlock(&(a_stream->lock_mutex));
+
+	return 0;
+}
+
+/*******************************************************************************/
+/* streams of this process, written out at exit when zlog_fini is not called */
+static zlog_stream_t *zlog_streams = NULL;
+static pthread_mutex_t zlog_streams_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t zlog_streams_once = PTHREAD_ONCE_INIT;
+
+static void zlog_stream_flush_at_exit(void)
+{
+	zlog_stream_t *a_stream;
+
+	pthread_mutex_lock(&zlog_streams_mutex);
+	for (a_stream = zlog_streams; a_stream; a_stream = a_stream->next) {
+		if (zc_forked(a_stream->forks)) continue;
+		zlog_stream_seal_all(a_stream);
+		zlog_stream_drain(a_stream);
+	}
+	pthread_mutex_unlock(&zlog_streams_mutex);
+}
+
+/* from a signal handler, no lock is taken and nothing is allocated,
+ * what a writer is putting out right now is not seen here
+ */
+static void zlog_stream_crash_write(zlog_stream_t * a_stream, zlog_stream_block_t * a_block)
+{
+	ssize_t nwrite;
+	const char *p;
+	size_t len;
+
+	if (!a_block || a_block->len == 0) return;
+
+	if (a_stream->compress) {
+		zlog_compress_stored_fd(*(a_stream->fd), a_block->data, a_block->len);
+		return;
+	}
+
+	for (p = a_block->data, len = a_block->len; len > 0; p += nwrite, len -= nwrite) {
+		nwrite = write(*(a_stream->fd), p, len);
+		if (nwrite < 0) {
+			if (errno == EINTR) {
+				nwrite = 0;
+				continue;
+			}
+			return;
+		}
+	}
+}
+
+void zlog_stream_crash_flush(void)
+{
+	int i;
+	zlog_stream_t *a_stream;
+	zlog_stream_block_t *a_block;
+
+	for (a_stream = zlog_streams; a_stream; a_stream = a_stream->next) {
+		if (zc_forked(a_stream->forks)) continue;
+		/* the drain finishes its block and takes no more */
+		zlog_crash_claim(&(a_stream->writing));
+
+		/* sealed ones are older than those being filled */
+		for (a_block = a_stream->head; a_block; a_block = a_block->next) {
+			zlog_stream_crash_write(a_stream, a_block);
+		}
+		for (i = 0; i < a_stream->nlanes; i++) {
+			zlog_stream_crash_write(a_stream, a_stream->lanes[i].block);
+		}
+	}
+}
+
+static void zlog_streams_atfork_child(void)
+{
+	pthread_mutex_init(&zlog_streams_mutex, NULL);
+}
+
+static void zlog_streams_init(void)
+{
+	if (atexit(zlog_stream_flush_at_exit)) {
+		zc_error("atexit fail, errno[%d]", errno);
+	}
+	pthread_atfork(NULL, NULL, zlog_streams_atfork_child);
+}
+
+static void zlog_stream_register(zlog_stream_t * a_stream)
+{
+	pthread_once(&zlog_streams_once, zlog_streams_init);
+
+	pthread_mutex_lock(&zlog_streams_mutex);
+	a_stream->next = zlog_streams;
+	zlog_streams = a_stream;
+	pthread_mutex_unlock(&zlog_streams_mutex);
+}
+
+static void zlog_stream_unregister(zlog_stream_t * a_stream)
+{
+	zlog_stream_t **p;
+
+	pthread_mutex_lock(&zlog_streams_mutex);
+	for (p = &zlog_streams; *p; p = &((*p)->next)) {
+		if (*p == a_stream) {
+			*p = a_stream->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&zlog_streams_mutex);
+}
+
+/*******************************************************************************/
+void zlog_stream_del(zlog_stream_t * a_stream)
+{
+	int i;
+
+	zc_assert(a_stream,);
+
+	zlog_stream_unregister(a_stream);
+
+	if (!zc_forked(a_stream->forks)) {
+		zlog_stream_seal_all(a_stream);
+
+		if (a_stream->worker) {
+			zlog_worker_del(a_stream->worker);
+			a_stream->worker = NULL;
+		}
+
+		/* whatever the worker has not written yet */
+		zlog_stream_drain(a_stream);
+	} else if (a_stream->worker) {
+		zlog_worker_del(a_stream->worker);
+		a_stream->worker = NULL;
+	}
+
+	for (i = 0; i < a_stream->nlanes; i++) {
+		zlog_stream_block_free_list(a_stream->lanes[i].block);
+		pthread_mutex_destroy(&(a_stream->lanes[i].lock_mutex));
+	}
+	free(a_stream->lanes);
+	zlog_stream_block_free_list(a_stream->head);
+	zlog_stream_block_free_list(a_stream->free_blocks);
+	free(a_stream->zbuf);
+
+	pthread_cond_destroy(&(a_stream->done_cond));
+	pthread_mutex_destroy(&(a_stream->write_mutex));
+	pthread_mutex_destroy(&(a_stream->lock_mutex));
+	zc_debug("zlog_stream_del[%p]", a_stream);
+	free(a_stream);
+	return;
+}
+
+zlog_stream_t *zlog_stream_new(const char *name, int *fd, volatile size_t *file_size,
+		size_t block_size, long flush_period, int compress, int nlanes)
+{
+	int i;
+	zlog_stream_t *a_stream;
+
+	zc_assert(name, NULL);
+	zc_assert(fd, NULL);
+	zc_assert(file_size, NULL);
+
+	if (block_size == 0) {
+		zc_error("block_size should be > 0");
+		return NULL;
+	}
+	if (flush_period <= 0) {
+		zc_error("flush_period[%ld] should be > 0", flush_period);
+		return NULL;
+	}
+	if (nlanes <= 0) {
+		zc_error("nlanes[%d] should be > 0", nlanes);
+		return NULL;
+	}
+
+	a_stream = calloc(1, sizeof(zlog_stream_t));
+	if (!a_stream) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&(a_stream->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_stream);
+		return NULL;
+	}
+	if (pthread_mutex_init(&(a_stream->write_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		pthread_mutex_destroy(&(a_stream->lock_mutex));
+		free(a_stream);
+		return NULL;
+	}
+	if (pthread_cond_init(&(a_stream->done_cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		pthread_mutex_destroy(&(a_stream->write_mutex));
+		pthread_mutex_destroy(&(a_stream->lock_mutex));
+		free(a_stream);
+		return NULL;
+	}
+
+	snprintf(a_stream->name, sizeof(a_stream->name), "%s", name);
+	a_stream->fd = fd;
+	a_stream->file_size = file_size;
+	a_stream->block_size = block_size;
+	a_stream->flush_period = flush_period;
+	a_stream->compress = compress;
+	zc_fork_watch();
+	a_stream->forks = zc_forks;
+
+	a_stream->lanes = calloc(nlanes, sizeof(zlog_stream_lane_t));
+	if (!a_stream->lanes) {
+		zc_error("calloc fail, errno[%d]", errno);
+		zlog_stream_del(a_stream);
+		return NULL;
+	}
+	for (i = 0; i < nlanes; i++) {
+		if (pthread_mutex_init(&(a_stream->lanes[i].lock_mutex), NULL)) {
+			zc_error("pthread_mutex_init fail, errno[%d]", errno);
+			zlog_stream_del(a_stream);
+			return NULL;
+		}
+		a_stream->nlanes++;
+	}
+
+	a_stream->worker = zlog_worker_new(name, 1, 0);
+	if (!a_stream->worker) {
+		zc_error("zlog_worker_new fail");
+		zlog_stream_del(a_stream);
+		return NULL;
+	}
+	zlog_worker_set_tick(a_stream->worker, flush_period, zlog_stream_tick, a_stream);
+	zlog_stream_register(a_stream);
+
+	zlog_stream_profile(a_stream, ZC_DEBUG);
+	return a_stream;
+}
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_stream_h
+#define __zlog_stream_h
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "zc_defs.h"
+#include "worker.h"
+
+/* records are gathered into blocks, which are written by a background
+ * thread with one write each, when full, on time or at exit.
+ * compressed, each block is one gzip member or lz4 frame,
+ * so a file is readable up to the last block after a crash
+ */
+
+#define ZLOG_STREAM_DEFAULT_BLOCK_SIZE	(256 * 1024)
+#define ZLOG_STREAM_DEFAULT_FLUSH	1000	/* ms */
+#define ZLOG_STREAM_MAX_PENDING		4	/* blocks waiting for the writer */
+#define ZLOG_STREAM_THREAD_LANES	16	/* blocks filled at the same time, per thread scope */
+
+typedef struct zlog_stream_block_s {
+	struct zlog_stream_s *stream;
+	struct zlog_stream_block_s *next;
+	size_t size;
+	size_t len;
+	char data[];
+} zlog_stream_block_t;
+
+/* a thread always fills the same lane, so its records keep their order */
+typedef struct zlog_stream_lane_s {
+	pthread_mutex_t lock_mutex;
+	zlog_stream_block_t *block;		/* being filled */
+} zlog_stream_lane_t;
+
+typedef struct zlog_stream_s {
+	char name[MAXLEN_PATH + 1];
+	int *fd;				/* rule's static_fd, which rotate and reopen may dup2 */
+	volatile size_t *file_size;		/* rule's, grows by bytes written */
+	size_t block_size;
+	long flush_period;			/* ms */
+	int compress;				/* 0, blocks are written as they are */
+	int nlanes;
+	zlog_stream_lane_t *lanes;
+
+	pthread_mutex_t lock_mutex;		/* after a lane's, if both */
+	pthread_cond_t done_cond;
+	zlog_stream_block_t *head;		/* sealed, in order of writing */
+	zlog_stream_block_t *tail;
+	zlog_stream_block_t *free_blocks;
+	int npending;
+
+	zlog_worker_t *worker;
+	pthread_mutex_t write_mutex;		/* one writer at a time, so blocks keep their order */
+	int writing;				/* of zlog_crash_claim, for each block taken */
+	unsigned char *zbuf;			/* under write_mutex */
+	size_t zbuf_size;
+
+	unsigned long forks;			/* of zc_forks, blocks of the parent are not ours */
+	struct zlog_stream_s *next;		/* in the list flushed at exit */
+} zlog_stream_t;
+
+/* nlanes is 1 for a buffer shared by all threads of a rule */
+zlog_stream_t *zlog_stream_new(const char *name, int *fd, volatile size_t *file_size,
+		size_t block_size, long flush_period, int compress, int nlanes);
+void zlog_stream_del(zlog_stream_t * a_stream);
+void zlog_stream_profile(zlog_stream_t * a_stream, int flag);
+
+/* append a whole record, never split between blocks, to the lane of owner,
+ * flush writes it out before return, after what all lanes hold, e.g. for
+ * error records
+ */
+int zlog_stream_write(zlog_stream_t * a_stream, const void *owner,
+		const char *str, size_t len, int flush);
+
+/* write whatever is buffered by all streams, async-signal-safe,
+ * for a crash handler, the process is not expected to go on,
+ * as the drain of each stream is stopped
+ */
+void zlog_stream_crash_flush(void);
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "syslog_client.h"
+#include "zc_defs.h"
+
+void zlog_syslog_profile(zlog_syslog_t * a_syslog, int flag)
+{
+	zc_assert(a_syslog,);
+	zc_profile(flag, "--syslog[%p][%s][%s][format:%d][drop:%d][fd:%d][dropped:%lu]--",
+		a_syslog,
+		a_syslog->path,
+		a_syslog->ident,
+		a_syslog->format,
+		a_syslog->drop,
+		a_syslog->fd,
+		a_syslog->ndropped);
+	return;
+}
+
+/*******************************************************************************/
+/* basename of argv[0], as libc syslog does */
+static void zlog_syslog_default_ident(char *ident, size_t size)
+{
+	int fd;
+	ssize_t nread;
+	char cmdline[MAXLEN_PATH + 1];
+	char *p;
+
+	strcpy(ident, "zlog");
+
+	fd = open("/proc/self/cmdline", O_RDONLY);
+	if (fd < 0) return;
+	nread = read(fd, cmdline, sizeof(cmdline) - 1);
+	close(fd);
+	if (nread <= 0) return;
+	cmdline[nread] = '\0';
+
+	p = strrchr(cmdline, '/');
+	p = p ? p + 1 : cmdline;
+	if (*p != '\0' && strlen(p) < size) strcpy(ident, p);
+}
+
+/* called with lock_mutex held, a datagram socket may be connected again */
+static int zlog_syslog_connect(zlog_syslog_t * a_syslog)
+{
+	struct sockaddr_un addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, a_syslog->path);
+
+	a_syslog->connect_at = time(NULL);
+	if (connect(a_syslog->fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		zc_debug("connect [%s] fail, errno[%d]", a_syslog->path, errno);
+		return -1;
+	}
+	return 0;
+}
+
+void zlog_syslog_del(zlog_syslog_t * a_syslog)
+{
+	zc_assert(a_syslog,);
+	if (a_syslog->fd >= 0) close(a_syslog->fd);
+	pthread_mutex_destroy(&(a_syslog->lock_mutex));
+	zc_debug("zlog_syslog_del[%p]", a_syslog);
+	free(a_syslog);
+	return;
+}
+
+zlog_syslog_t *zlog_syslog_new(const char *path, const char *ident, int format, int drop)
+{
+	zlog_syslog_t *a_syslog;
+
+	if (!path || *path == '\0') path = ZLOG_SYSLOG_DEFAULT_PATH;
+	if (strlen(path) > sizeof(((struct sockaddr_un *)0)->sun_path) - 1) {
+		zc_error("syslog socket path[%s] is too long", path);
+		return NULL;
+	}
+	if (ident && strlen(ident) > MAXLEN_CFG_NAME) {
+		zc_error("syslog ident[%s] is too long", ident);
+		return NULL;
+	}
+
+	a_syslog = calloc(1, sizeof(zlog_syslog_t));
+	if (!a_syslog) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	strcpy(a_syslog->path, path);
+	if (ident && *ident != '\0') {
+		strcpy(a_syslog->ident, ident);
+	} else {
+		zlog_syslog_default_ident(a_syslog->ident, sizeof(a_syslog->ident));
+	}
+	a_syslog->format = format;
+	a_syslog->drop = drop;
+
+	if (pthread_mutex_init(&(a_syslog->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_syslog);
+		return NULL;
+	}
+
+	/* the fd stays the same for life, a new daemon is connected to on it */
+	a_syslog->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (a_syslog->fd < 0) {
+		zc_error("socket fail, errno[%d]", errno);
+		goto err;
+	}
+	fcntl(a_syslog->fd, F_SETFD, FD_CLOEXEC);
+
+	pthread_mutex_lock(&(a_syslog->lock_mutex));
+	zlog_syslog_connect(a_syslog);
+	pthread_mutex_unlock(&(a_syslog->lock_mutex));
+
+	zlog_syslog_profile(a_syslog, ZC_DEBUG);
+	return a_syslog;
+err:
+	zlog_syslog_del(a_syslog);
+	return NULL;
+}
+
+/*******************************************************************************/
+static size_t zlog_syslog_header(zlog_syslog_t * a_syslog, int pri, zlog_event_t * a_event,
+		char *hdr, size_t size)
+{
+	int len;
+	char stamp[64];
+	char zone[8];
+
+	/* same cache as %d */
+	if (!a_event->time_stamp.tv_sec) {
+		gettimeofday(&(a_event->time_stamp), NULL);
+	}
+	if (a_event->time_local_sec != a_event->time_stamp.tv_sec) {
+		localtime_r(&(a_event->time_stamp.tv_sec), &(a_event->time_local));
+		a_event->time_local_sec = a_event->time_stamp.tv_sec;
+	}
+
+	if (a_syslog->format == ZLOG_SYSLOG_RFC5424) {
+		/* 2018-05-01T10:20:30.123456+08:00 */
+		strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &(a_event->time_local));
+		if (strftime(zone, sizeof(zone), "%z", &(a_event->time_local)) != 5) {
+			strcpy(zone, "+0000");
+		}
+		len = snprintf(hdr, size, "<%d>1 %s.%06ld%.3s:%s %s %s %ld - - ",
+			pri, stamp, (long)a_event->time_stamp.tv_usec, zone, zone + 3,
+			a_event->host_name_len ? a_event->host_name : "-",
+			a_syslog->ident, (long)a_event->pid);
+	} else {
+		strftime(stamp, sizeof(stamp), "%b %e %H:%M:%S", &(a_event->time_local));
+		len = snprintf(hdr, size, "<%d>%s %s[%ld]: ",
+			pri, stamp, a_syslog->ident, (long)a_event->pid);
+	}
+
+	if (len < 0) return 0;
+	return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+int zlog_syslog_send(zlog_syslog_t * a_syslog, int pri, zlog_event_t * a_event,
+		const char *msg, size_t len)
+{
+	int retry = 1;
+	char hdr[MAXLEN_CFG_NAME + 256 + 128];
+	struct iovec iov[2];
+	struct msghdr mh;
+
+	/* the daemon ends a record by the datagram */
+	while (len > 0 && (msg[len - 1] == '\n' || msg[len - 1] == '\r')) len--;
+
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = zlog_syslog_header(a_syslog, pri, a_event, hdr, sizeof(hdr));
+	iov[1].iov_base = (void *)msg;
+	iov[1].iov_len = len;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = iov;
+	mh.msg_iovlen = 2;
+
+	for (;;) {
+		if (sendmsg(a_syslog->fd, &mh, a_syslog->drop ? MSG_DONTWAIT : 0) >= 0) {
+			return 0;
+		}
+
+		switch (errno) {
+		case EINTR:
+			continue;
+		case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+		case EWOULDBLOCK:
+#endif
+		case ENOBUFS:
+			/* the daemon is behind, only with drop */
+			ATOM_ADD_F(&(a_syslog->ndropped), 1);
+			return 0;
+		case ENOTCONN:
+		case ECONNREFUSED:
+		case ECONNRESET:
+		case EDESTADDRREQ:
+		case ENOENT:
+		case EPIPE:
+			/* the daemon was restarted, or is not there yet */
+			if (retry && a_syslog->connect_at != time(NULL)) {
+				retry = 0;
+				pthread_mutex_lock(&(a_syslog->lock_mutex));
+				zlog_syslog_connect(a_syslog);
+				pthread_mutex_unlock(&(a_syslog->lock_mutex));
+				continue;
+			}
+			ATOM_ADD_F(&(a_syslog->ndropped), 1);
+			return 0;
+		default:
+			zc_error("sendmsg to [%s] fail, errno[%d]", a_syslog->path, errno);
+			return -1;
+		}
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_syslog_client_h
+#define __zlog_syslog_client_h
+
+#include <time.h>
+#include <pthread.h>
+
+#include "zc_defs.h"
+#include "event.h"
+
+#define ZLOG_SYSLOG_DEFAULT_PATH	"/dev/log"
+
+#define ZLOG_SYSLOG_RFC3164	0	/* <pri>Mmm dd hh:mm:ss ident[pid]: msg */
+#define ZLOG_SYSLOG_RFC5424	1	/* <pri>1 time host ident pid - - msg */
+
+/* one connected datagram socket for all threads of a rule, a send is one
+ * record, whole or not at all, so no lock is taken for it
+ */
+typedef struct zlog_syslog_s {
+	char path[MAXLEN_PATH + 1];
+	char ident[MAXLEN_CFG_NAME + 1];
+	int format;
+	int drop;			/* do not wait when the daemon is behind */
+	int fd;
+
+	pthread_mutex_t lock_mutex;	/* for connect */
+	volatile time_t connect_at;	/* last try, once a second at most */
+	volatile unsigned long ndropped;
+} zlog_syslog_t;
+
+/* path NULL or "" is /dev/log, ident NULL or "" is the program name
+ * a daemon which is not there yet is not an error, records are dropped
+ * until it is
+ */
+zlog_syslog_t *zlog_syslog_new(const char *path, const char *ident, int format, int drop);
+void zlog_syslog_del(zlog_syslog_t * a_syslog);
+void zlog_syslog_profile(zlog_syslog_t * a_syslog, int flag);
+
+/* send msg, a record rendered already, with a header of pri and a_event
+ * return 0 when sent or dropped, -1 on fail
+ */
+int zlog_syslog_send(zlog_syslog_t * a_syslog, int pri, zlog_event_t * a_event,
+		const char *msg, size_t len);
+
+#endif
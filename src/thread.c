@@ -63,6 +63,9 @@ void zlog_thread_del(zlog_thread_t * a_thread)
 	if (a_thread->msg_buf)
 		zlog_buf_del(a_thread->msg_buf);
 
+	if (a_thread->usr_msg_buf)
+		zlog_buf_del(a_thread->usr_msg_buf);
+
 	if (a_thread->fname_fds) {
 		zc_arraylist_del(a_thread->fname_fds);
 		a_thread->fname_fds = NULL;
@@ -135,6 +138,12 @@ zlog_thread_t *zlog_thread_new(int init_version, size_t buf_size_min, size_t buf
 		goto err;
 	}
 
+	a_thread->usr_msg_buf = zlog_buf_new(buf_size_min, buf_size_max, "...");
+	if (!a_thread->usr_msg_buf) {
+		zc_error("zlog_buf_new fail");
+		goto err;
+	}
+
 	//zlog_thread_profile(a_thread, ZC_DEBUG);
 	return a_thread;
 err:
@@ -147,6 +156,7 @@ int zlog_thread_rebuild_msg_buf(zlog_thread_t * a_thread, size_t buf_size_min, s
 {
 	zlog_buf_t *pre_msg_buf_new = NULL;
 	zlog_buf_t *msg_buf_new = NULL;
+	zlog_buf_t *usr_msg_buf_new = NULL;
 	zc_assert(a_thread, -1);
 
 	if ( (a_thread->msg_buf->size_min == buf_size_min)
@@ -167,16 +177,26 @@ int zlog_thread_rebuild_msg_buf(zlog_thread_t * a_thread, size_t buf_size_min, s
 		goto err;
 	}
 
+	usr_msg_buf_new = zlog_buf_new(buf_size_min, buf_size_max, "...");
+	if (!usr_msg_buf_new) {
+		zc_error("zlog_buf_new fail");
+		goto err;
+	}
+
 	zlog_buf_del(a_thread->pre_msg_buf);
 	a_thread->pre_msg_buf = pre_msg_buf_new;
 
 	zlog_buf_del(a_thread->msg_buf);
 	a_thread->msg_buf = msg_buf_new;
 
+	zlog_buf_del(a_thread->usr_msg_buf);
+	a_thread->usr_msg_buf = usr_msg_buf_new;
+
 	return 0;
 err:
 	if (pre_msg_buf_new) zlog_buf_del(pre_msg_buf_new);
 	if (msg_buf_new) zlog_buf_del(msg_buf_new);
+	if (usr_msg_buf_new) zlog_buf_del(usr_msg_buf_new);
 	return -1;
 }
 
@@ -15,6 +15,8 @@
 #include "mdc.h"
 #include "rotater_head.h"
 
+#define ZLOG_THREAD_CATEGORIES	32
+
 typedef struct {
 	int init_version;
 	zlog_mdc_t *mdc;
@@ -25,6 +27,9 @@ typedef struct {
 	zlog_buf_t *archive_path_buf;
 	zlog_buf_t *pre_msg_buf;
 	zlog_buf_t *msg_buf;
+	int msg_kept;		/* msg_buf is a record kept by backtrace, not to format */
+	zlog_buf_t *usr_msg_buf;	/* %m of this event, rendered once for all rules */
+	int usr_msg_ready;
 
 	zc_arraylist_t *fname_fds;
 	int fd;
@@ -33,6 +38,11 @@ typedef struct {
 	char *cur_time_str;
 	zlog_rotater_t *rotater;
 	volatile size_t file_size;
+
+	/* got by zlog_get_category, by hash of name */
+	struct zlog_category_s *categories[ZLOG_THREAD_CATEGORIES];
+	char category_names[ZLOG_THREAD_CATEGORIES][MAXLEN_CFG_NAME + 1];
+	int categories_version;
 } zlog_thread_t;
 
 
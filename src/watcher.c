@@ -0,0 +1,301 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "watcher.h"
+#include "zc_defs.h"
+
+void zlog_watcher_profile(zlog_watcher_t * a_watcher, int flag)
+{
+	int i;
+	zlog_watch_t *a_watch;
+
+	zc_assert(a_watcher,);
+	zc_profile(flag, "--watcher[%p][fd:%d][started:%d][dead:%d][forks:%lu/%lu]--",
+		a_watcher,
+		a_watcher->fd,
+		a_watcher->started,
+		a_watcher->dead,
+		a_watcher->forks,
+		zc_forks);
+	zc_arraylist_foreach(a_watcher->watches, i, a_watch) {
+		zc_profile(flag, "---watch[%d][%s][%d]---", a_watch->wd, a_watch->name, *(a_watch->state));
+	}
+	return;
+}
+
+/*******************************************************************************/
+#ifdef __linux__
+
+#define ZLOG_WATCH_DIR_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+			| IN_DELETE_SELF | IN_MOVE_SELF)
+
+static void zlog_watcher_dispatch(zlog_watcher_t * a_watcher, struct inotify_event *ev)
+{
+	int i;
+	zlog_watch_t *a_watch;
+
+	zc_arraylist_foreach(a_watcher->watches, i, a_watch) {
+		if (ev->mask & IN_Q_OVERFLOW) {
+			/* events are lost, check all */
+			ATOM_CASB(a_watch->state, ZLOG_WATCH_QUIET, ZLOG_WATCH_CHANGED);
+		} else if (ev->wd != a_watch->wd) {
+			continue;
+		} else if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT)) {
+			/* the dir is gone or renamed, path means something else now */
+			*(a_watch->state) = ZLOG_WATCH_LOST;
+		} else if (ev->len && STRCMP(ev->name, ==, a_watch->name)) {
+			ATOM_CASB(a_watch->state, ZLOG_WATCH_QUIET, ZLOG_WATCH_CHANGED);
+		}
+	}
+}
+
+static void *zlog_watcher_loop(void *arg)
+{
+	int i;
+	ssize_t len;
+	char *p;
+	struct inotify_event *ev;
+	struct pollfd fds[2];
+	zlog_watch_t *a_watch;
+	zlog_watcher_t *a_watcher = arg;
+	union {
+		struct inotify_event ev;
+		char buf[4096];
+	} events;
+
+	for (;;) {
+		fds[0].fd = a_watcher->fd;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		fds[1].fd = a_watcher->stop_fd[0];
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) continue;
+			zc_error("poll fail, errno[%d]", errno);
+			break;
+		}
+		if (fds[1].revents) break;
+		if (!fds[0].revents) continue;
+
+		len = read(a_watcher->fd, events.buf, sizeof(events.buf));
+		if (len < 0) {
+			if (errno == EINTR || errno == EAGAIN) continue;
+			zc_error("read inotify fail, errno[%d]", errno);
+			break;
+		}
+
+		for (p = events.buf; p < events.buf + len; p += sizeof(struct inotify_event) + ev->len) {
+			ev = (struct inotify_event *)p;
+			zlog_watcher_dispatch(a_watcher, ev);
+		}
+	}
+
+	/* nobody flips the states any more, go back to stat */
+	zc_arraylist_foreach(a_watcher->watches, i, a_watch) {
+		*(a_watch->state) = ZLOG_WATCH_LOST;
+	}
+	a_watcher->dead = 1;
+	return NULL;
+}
+
+int zlog_watcher_add(zlog_watcher_t * a_watcher, const char *path, volatile int *state)
+{
+	const char *p;
+	char dir[MAXLEN_PATH + 1];
+	zlog_watch_t *a_watch;
+
+	zc_assert(a_watcher, -1);
+	zc_assert(path, -1);
+	zc_assert(state, -1);
+
+	if (a_watcher->started) {
+		zc_error("watcher is started, can not add [%s]", path);
+		return -1;
+	}
+
+	/* aa.log in . or /var/log/aa.log in /var/log */
+	p = strrchr(path, '/');
+	if (!p) {
+		strcpy(dir, ".");
+		p = path;
+	} else if (p == path) {
+		strcpy(dir, "/");
+		p++;
+	} else {
+		if (p - path > MAXLEN_PATH) {
+			zc_error("path[%s] is too long", path);
+			return -1;
+		}
+		memcpy(dir, path, p - path);
+		dir[p - path] = '\0';
+		p++;
+	}
+	if (*p == '\0' || strlen(p) > MAXLEN_PATH) {
+		zc_error("no file name in path[%s]", path);
+		return -1;
+	}
+
+	a_watch = calloc(1, sizeof(zlog_watch_t));
+	if (!a_watch) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return -1;
+	}
+	strcpy(a_watch->name, p);
+	a_watch->state = state;
+
+	/* same dir gives the same wd */
+	a_watch->wd = inotify_add_watch(a_watcher->fd, dir, ZLOG_WATCH_DIR_MASK);
+	if (a_watch->wd < 0) {
+		zc_warn("inotify_add_watch[%s] fail, errno[%d], poll it", dir, errno);
+		free(a_watch);
+		return -1;
+	}
+
+	if (zc_arraylist_add(a_watcher->watches, a_watch)) {
+		zc_error("zc_arraylist_add fail");
+		free(a_watch);
+		return -1;
+	}
+
+	/* anything before the watch is missed, check once */
+	*state = ZLOG_WATCH_CHANGED;
+	return 0;
+}
+
+int zlog_watcher_start(zlog_watcher_t * a_watcher)
+{
+	int rc;
+
+	zc_assert(a_watcher, -1);
+
+	if (a_watcher->started || zc_arraylist_len(a_watcher->watches) == 0) {
+		return 0;
+	}
+
+	rc = pthread_create(&(a_watcher->tid), NULL, zlog_watcher_loop, a_watcher);
+	if (rc) {
+		zc_error("pthread_create fail, rc[%d]", rc);
+		a_watcher->dead = 1;
+		return -1;
+	}
+	a_watcher->started = 1;
+	return 0;
+}
+
+/*******************************************************************************/
+void zlog_watcher_del(zlog_watcher_t * a_watcher)
+{
+	zc_assert(a_watcher,);
+
+	/* the thread only runs in the process which started it */
+	if (a_watcher->started && !zc_forked(a_watcher->forks)) {
+		if (write(a_watcher->stop_fd[1], "", 1) < 0) {
+			zc_error("write stop fail, errno[%d]", errno);
+		}
+		pthread_join(a_watcher->tid, NULL);
+	}
+
+	if (a_watcher->watches) zc_arraylist_del(a_watcher->watches);
+	if (a_watcher->stop_fd[0] >= 0) close(a_watcher->stop_fd[0]);
+	if (a_watcher->stop_fd[1] >= 0) close(a_watcher->stop_fd[1]);
+	if (a_watcher->fd >= 0) close(a_watcher->fd);
+	zc_debug("zlog_watcher_del[%p]", a_watcher);
+	free(a_watcher);
+	return;
+}
+
+zlog_watcher_t *zlog_watcher_new(void)
+{
+	zlog_watcher_t *a_watcher;
+
+	zc_fork_watch();
+
+	a_watcher = calloc(1, sizeof(zlog_watcher_t));
+	if (!a_watcher) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+	a_watcher->fd = -1;
+	a_watcher->stop_fd[0] = -1;
+	a_watcher->stop_fd[1] = -1;
+	a_watcher->forks = zc_forks;
+
+	a_watcher->watches = zc_arraylist_new(free, ARRAY_LIST_DEFAULT_SIZE);
+	if (!a_watcher->watches) {
+		zc_error("zc_arraylist_new fail");
+		goto err;
+	}
+
+	a_watcher->fd = inotify_init();
+	if (a_watcher->fd < 0) {
+		zc_warn("inotify_init fail, errno[%d], poll files", errno);
+		goto err;
+	}
+
+	if (pipe(a_watcher->stop_fd)) {
+		zc_error("pipe fail, errno[%d]", errno);
+		goto err;
+	}
+
+	/* not passed to exec */
+	fcntl(a_watcher->fd, F_SETFD, FD_CLOEXEC);
+	fcntl(a_watcher->stop_fd[0], F_SETFD, FD_CLOEXEC);
+	fcntl(a_watcher->stop_fd[1], F_SETFD, FD_CLOEXEC);
+	fcntl(a_watcher->fd, F_SETFL, O_NONBLOCK);
+
+	zlog_watcher_profile(a_watcher, ZC_DEBUG);
+	return a_watcher;
+err:
+	zlog_watcher_del(a_watcher);
+	return NULL;
+}
+
+#else /* no inotify, every rule polls */
+
+int zlog_watcher_add(zlog_watcher_t * a_watcher, const char *path, volatile int *state)
+{
+	return -1;
+}
+
+int zlog_watcher_start(zlog_watcher_t * a_watcher)
+{
+	return 0;
+}
+
+void zlog_watcher_del(zlog_watcher_t * a_watcher)
+{
+	zc_assert(a_watcher,);
+	if (a_watcher->watches) zc_arraylist_del(a_watcher->watches);
+	free(a_watcher);
+	return;
+}
+
+zlog_watcher_t *zlog_watcher_new(void)
+{
+	zc_fork_watch();
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_watcher_h
+#define __zlog_watcher_h
+
+#include <pthread.h>
+
+#include "zc_defs.h"
+
+/* state of a watched path, polled by the caller when lost */
+#define ZLOG_WATCH_LOST		0	/* not watched, stat it as before */
+#define ZLOG_WATCH_QUIET	1	/* nothing happened to the path */
+#define ZLOG_WATCH_CHANGED	2	/* created, moved or deleted, check it */
+
+typedef struct zlog_watch_s {
+	int wd;
+	char name[MAXLEN_PATH + 1];	/* file name in the watched dir */
+	volatile int *state;
+} zlog_watch_t;
+
+typedef struct zlog_watcher_s {
+	int fd;				/* inotify */
+	int stop_fd[2];			/* pipe, wakes the thread to exit */
+	zc_arraylist_t *watches;
+	pthread_t tid;
+	int started;
+	volatile int dead;		/* thread is gone, all are polled */
+	unsigned long forks;		/* of zc_forks at new, the thread does not run in a child */
+} zlog_watcher_t;
+
+/* return NULL when inotify is not there, the caller polls then */
+zlog_watcher_t *zlog_watcher_new(void);
+void zlog_watcher_del(zlog_watcher_t * a_watcher);
+void zlog_watcher_profile(zlog_watcher_t * a_watcher, int flag);
+
+/* watch the dir of path, *state is set to ZLOG_WATCH_CHANGED at once,
+ * and each time path is created, moved or deleted, or to ZLOG_WATCH_LOST
+ * when the dir itself goes away
+ * must be called before zlog_watcher_start
+ */
+int zlog_watcher_add(zlog_watcher_t * a_watcher, const char *path, volatile int *state);
+/* start the thread, nothing is done when there is no watch */
+int zlog_watcher_start(zlog_watcher_t * a_watcher);
+
+#define zlog_watcher_is_alive(a_watcher) \
+	(!(a_watcher)->dead && !zc_forked((a_watcher)->forks))
+
+#endif
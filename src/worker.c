@@ -0,0 +1,332 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "worker.h"
+#include "zc_defs.h"
+
+void zlog_worker_profile(zlog_worker_t * a_worker, int flag)
+{
+	zc_assert(a_worker,);
+	zc_profile(flag, "--worker[%p][%s][%d/%d threads,%d idle][nice:%d][%ld jobs][tick:%ld,%p][%d]--",
+		a_worker,
+		a_worker->name,
+		a_worker->nthreads,
+		a_worker->max_threads,
+		a_worker->nidle,
+		a_worker->nice,
+		(long)a_worker->njobs,
+		a_worker->tick_period,
+		a_worker->tick,
+		a_worker->stop);
+	return;
+}
+
+/*******************************************************************************/
+static void zlog_worker_drop_jobs(zlog_worker_t * a_worker)
+{
+	zlog_worker_job_t *a_job;
+
+	while ((a_job = a_worker->head)) {
+		a_worker->head = a_job->next;
+		if (a_job->del) a_job->del(a_job->arg);
+		free(a_job);
+	}
+	a_worker->tail = NULL;
+	a_worker->njobs = 0;
+}
+
+static void zlog_worker_lower_priority(zlog_worker_t * a_worker)
+{
+#ifdef __linux__
+	/* on linux nice value is per thread, addressed by kernel tid */
+	if (a_worker->nice > 0 &&
+		setpriority(PRIO_PROCESS, syscall(SYS_gettid), a_worker->nice)) {
+		zc_warn("setpriority fail, errno[%d]", errno);
+	}
+#endif
+	return;
+}
+
+static void zlog_worker_timespec_add(struct timespec *ts, long ms)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	ts->tv_sec = tv.tv_sec + ms / 1000;
+	ts->tv_nsec = tv.tv_usec * 1000 + (ms % 1000) * 1000000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+static void *zlog_worker_loop(void *arg)
+{
+	zlog_worker_t *a_worker = arg;
+	zlog_worker_job_t *a_job;
+	struct timespec next_tick;
+
+	zlog_worker_lower_priority(a_worker);
+
+	pthread_mutex_lock(&(a_worker->lock_mutex));
+	zlog_worker_timespec_add(&next_tick, a_worker->tick_period);
+	for (;;) {
+		while (!a_worker->head && !a_worker->stop) {
+			a_worker->nidle++;
+			if (!a_worker->tick) {
+				pthread_cond_wait(&(a_worker->job_cond), &(a_worker->lock_mutex));
+			} else if (pthread_cond_timedwait(&(a_worker->job_cond),
+					&(a_worker->lock_mutex), &next_tick) == ETIMEDOUT) {
+				a_worker->nidle--;
+				pthread_mutex_unlock(&(a_worker->lock_mutex));
+				a_worker->tick(a_worker, a_worker->tick_arg);
+				pthread_mutex_lock(&(a_worker->lock_mutex));
+				zlog_worker_timespec_add(&next_tick, a_worker->tick_period);
+				continue;
+			}
+			a_worker->nidle--;
+		}
+		if (a_worker->stop) break;
+
+		a_job = a_worker->head;
+		a_worker->head = a_job->next;
+		if (!a_worker->head) a_worker->tail = NULL;
+		a_worker->njobs--;
+		pthread_mutex_unlock(&(a_worker->lock_mutex));
+
+		a_job->run(a_worker, a_job->arg);
+		if (a_job->del) a_job->del(a_job->arg);
+		free(a_job);
+
+		pthread_mutex_lock(&(a_worker->lock_mutex));
+	}
+	pthread_mutex_unlock(&(a_worker->lock_mutex));
+
+	return NULL;
+}
+
+/* the parent's threads and lock state do not survive fork,
+ * start over empty, the parent still runs its own copy of queued jobs
+ */
+static int zlog_worker_atfork_reset(void *arg)
+{
+	zlog_worker_t *a_worker = arg;
+
+	zlog_worker_drop_jobs(a_worker);
+	a_worker->nthreads = 0;
+	a_worker->nidle = 0;
+
+	if (pthread_mutex_init(&(a_worker->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		return -1;
+	}
+	if (pthread_cond_init(&(a_worker->job_cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		return -1;
+	}
+	return 0;
+}
+
+int zlog_worker_submit(zlog_worker_t * a_worker,
+		zlog_worker_run_fn run, zlog_worker_del_fn del, void *arg)
+{
+	int rc = 0;
+	zlog_worker_job_t *a_job;
+
+	zc_assert(a_worker, -1);
+	zc_assert(run, -1);
+
+	if (zc_forked(a_worker->forks)
+		&& zc_fork_reset(&(a_worker->forks), zlog_worker_atfork_reset, a_worker)) {
+		zc_error("zlog_worker_atfork_reset fail");
+		goto err;
+	}
+
+	a_job = calloc(1, sizeof(zlog_worker_job_t));
+	if (!a_job) {
+		zc_error("calloc fail, errno[%d]", errno);
+		goto err;
+	}
+	a_job->run = run;
+	a_job->del = del;
+	a_job->arg = arg;
+
+	pthread_mutex_lock(&(a_worker->lock_mutex));
+	if (a_worker->stop) {
+		pthread_mutex_unlock(&(a_worker->lock_mutex));
+		free(a_job);
+		goto err;
+	}
+
+	if (a_worker->tail) {
+		a_worker->tail->next = a_job;
+	} else {
+		a_worker->head = a_job;
+	}
+	a_worker->tail = a_job;
+	a_worker->njobs++;
+
+	/* threads are started lazily, and never more than max_threads */
+	if ((size_t)a_worker->nidle < a_worker->njobs
+		&& a_worker->nthreads < a_worker->max_threads) {
+		rc = pthread_create(&(a_worker->threads[a_worker->nthreads]), NULL,
+				zlog_worker_loop, a_worker);
+		if (rc) {
+			zc_error("pthread_create fail, rc[%d]", rc);
+		} else {
+			a_worker->nthreads++;
+		}
+	}
+
+	pthread_cond_signal(&(a_worker->job_cond));
+	pthread_mutex_unlock(&(a_worker->lock_mutex));
+
+	/* no thread at all, job would never run */
+	if (rc && a_worker->nthreads == 0) {
+		zc_error("no worker thread for [%s], job dropped", a_worker->name);
+		pthread_mutex_lock(&(a_worker->lock_mutex));
+		zlog_worker_drop_jobs(a_worker);
+		pthread_mutex_unlock(&(a_worker->lock_mutex));
+		return -1;
+	}
+
+	return 0;
+err:
+	if (del) del(arg);
+	return -1;
+}
+
+void zlog_worker_set_tick(zlog_worker_t * a_worker,
+		long tick_period, zlog_worker_run_fn tick, void *tick_arg)
+{
+	zc_assert(a_worker,);
+	zc_assert(tick_period > 0,);
+
+	a_worker->tick_period = tick_period;
+	a_worker->tick = tick;
+	a_worker->tick_arg = tick_arg;
+	return;
+}
+
+int zlog_worker_start(zlog_worker_t * a_worker)
+{
+	int rc = 0;
+
+	zc_assert(a_worker, -1);
+
+	if (zc_forked(a_worker->forks)
+		&& zc_fork_reset(&(a_worker->forks), zlog_worker_atfork_reset, a_worker)) {
+		zc_error("zlog_worker_atfork_reset fail");
+		return -1;
+	}
+
+	pthread_mutex_lock(&(a_worker->lock_mutex));
+	if (a_worker->nthreads == 0 && !a_worker->stop) {
+		rc = pthread_create(&(a_worker->threads[0]), NULL, zlog_worker_loop, a_worker);
+		if (rc) {
+			zc_error("pthread_create fail, rc[%d]", rc);
+		} else {
+			a_worker->nthreads++;
+		}
+	}
+	pthread_mutex_unlock(&(a_worker->lock_mutex));
+
+	return rc ? -1 : 0;
+}
+
+/*******************************************************************************/
+void zlog_worker_del(zlog_worker_t * a_worker)
+{
+	int i;
+
+	zc_assert(a_worker,);
+
+	if (!zc_forked(a_worker->forks)) {
+		pthread_mutex_lock(&(a_worker->lock_mutex));
+		a_worker->stop = 1;
+		pthread_cond_broadcast(&(a_worker->job_cond));
+		pthread_mutex_unlock(&(a_worker->lock_mutex));
+
+		/* running jobs check zlog_worker_is_stopping() and give up soon */
+		for (i = 0; i < a_worker->nthreads; i++) {
+			pthread_join(a_worker->threads[i], NULL);
+		}
+		zlog_worker_drop_jobs(a_worker);
+	} else {
+		/* created in parent, nothing runs here */
+		zlog_worker_atfork_reset(a_worker);
+	}
+
+	pthread_cond_destroy(&(a_worker->job_cond));
+	pthread_mutex_destroy(&(a_worker->lock_mutex));
+	free(a_worker->threads);
+	zc_debug("zlog_worker_del[%p]", a_worker);
+	free(a_worker);
+	return;
+}
+
+zlog_worker_t *zlog_worker_new(const char *name, int max_threads, int nice)
+{
+	zlog_worker_t *a_worker;
+
+	zc_assert(name, NULL);
+
+	if (max_threads <= 0) {
+		zc_error("max_threads[%d] should be > 0", max_threads);
+		return NULL;
+	}
+
+	a_worker = calloc(1, sizeof(zlog_worker_t));
+	if (!a_worker) {
+		zc_error("calloc fail, errno[%d]", errno);
+		return NULL;
+	}
+
+	a_worker->threads = calloc(max_threads, sizeof(pthread_t));
+	if (!a_worker->threads) {
+		zc_error("calloc fail, errno[%d]", errno);
+		free(a_worker);
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&(a_worker->lock_mutex), NULL)) {
+		zc_error("pthread_mutex_init fail, errno[%d]", errno);
+		free(a_worker->threads);
+		free(a_worker);
+		return NULL;
+	}
+
+	if (pthread_cond_init(&(a_worker->job_cond), NULL)) {
+		zc_error("pthread_cond_init fail, errno[%d]", errno);
+		pthread_mutex_destroy(&(a_worker->lock_mutex));
+		free(a_worker->threads);
+		free(a_worker);
+		return NULL;
+	}
+
+	snprintf(a_worker->name, sizeof(a_worker->name), "%s", name);
+	a_worker->max_threads = max_threads;
+	a_worker->nice = nice;
+	zc_fork_watch();
+	a_worker->forks = zc_forks;
+
+	zlog_worker_profile(a_worker, ZC_DEBUG);
+	return a_worker;
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlog_worker_h
+#define __zlog_worker_h
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "zc_defs.h"
+
+typedef struct zlog_worker_s zlog_worker_t;
+
+/* run a job in the worker thread, a_worker can be asked whether it is stopping */
+typedef void (*zlog_worker_run_fn) (zlog_worker_t * a_worker, void *arg);
+/* release a job's arg, called after run, or instead of run when the job is dropped */
+typedef void (*zlog_worker_del_fn) (void *arg);
+
+typedef struct zlog_worker_job_s {
+	zlog_worker_run_fn run;
+	zlog_worker_del_fn del;
+	void *arg;
+	struct zlog_worker_job_s *next;
+} zlog_worker_job_t;
+
+struct zlog_worker_s {
+	char name[MAXLEN_CFG_NAME + 1];
+	pthread_mutex_t lock_mutex;
+	pthread_cond_t job_cond;
+
+	int max_threads;		/* cap on jobs running at the same time */
+	int nice;			/* added to the priority of worker threads */
+	pthread_t *threads;
+	int nthreads;
+	int nidle;
+
+	zlog_worker_job_t *head;
+	zlog_worker_job_t *tail;
+	size_t njobs;
+
+	long tick_period;		/* ms, 0 means no tick */
+	zlog_worker_run_fn tick;
+	void *tick_arg;
+
+	volatile int stop;
+	unsigned long forks;		/* of zc_forks, threads are not inherited through fork */
+};
+
+zlog_worker_t *zlog_worker_new(const char *name, int max_threads, int nice);
+void zlog_worker_del(zlog_worker_t * a_worker);
+void zlog_worker_profile(zlog_worker_t * a_worker, int flag);
+
+int zlog_worker_submit(zlog_worker_t * a_worker,
+		zlog_worker_run_fn run, zlog_worker_del_fn del, void *arg);
+
+/* call tick in a worker thread every tick_period ms, when it is not busy with jobs,
+ * must be set before any thread starts
+ */
+void zlog_worker_set_tick(zlog_worker_t * a_worker,
+		long tick_period, zlog_worker_run_fn tick, void *tick_arg);
+/* make sure a thread is there to tick, also after fork */
+int zlog_worker_start(zlog_worker_t * a_worker);
+
+#define zlog_worker_is_stopping(a_worker) ((a_worker)->stop)
+
+#endif
@@ -129,6 +129,22 @@ int zc_arraylist_add(zc_arraylist_t * a_list, void *data)
 	return zc_arraylist_set(a_list, a_list->len, data);
 }
 
+void zc_arraylist_remove(zc_arraylist_t * a_list, int idx)
+{
+	if (idx < 0 || idx >= a_list->len)
+		return;
+
+	if (a_list->array[idx] && a_list->del)
+		a_list->del(a_list->array[idx]);
+
+	memmove(a_list->array + idx, a_list->array + idx + 1,
+		(a_list->len - idx - 1) * sizeof(void *));
+	a_list->len--;
+	a_list->array[a_list->len] = NULL;
+
+	return;
+}
+
 /* assum idx < len */
 static int zc_arraylist_insert_inner(zc_arraylist_t * a_list, int idx,
 				     void *data)
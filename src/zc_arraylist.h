@@ -30,6 +30,7 @@ int zc_arraylist_reduce_size(zc_arraylist_t *a_list);
 
 int zc_arraylist_set(zc_arraylist_t * a_list, int i, void *data);
 int zc_arraylist_add(zc_arraylist_t * a_list, void *data);
+void zc_arraylist_remove(zc_arraylist_t * a_list, int idx);
 int zc_arraylist_sortadd(zc_arraylist_t * a_list, zc_arraylist_cmp_fn cmp,
 			 void *data);
 
@@ -17,6 +17,44 @@
 				   + __GNUC_PATCHLEVEL__)
 
 #if (GCC_VERSION >= 40700)
+/* issues a full memory barrier. */
+#define zc_barrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#define ATOM_SET(ptr, value)        __atomic_exchange_n(ptr, value, __ATOMIC_ACQUIRE)
+
+#define _INT_USLEEP (2)
+#define ATOM_LOCK(ptr)                 \
+    while(ATOM_SET(ptr, 1)) {          \
+        usleep(_INT_USLEEP);           \
+    }
+
+#define ATOM_UNLOCK(ptr)            __atomic_store_n(ptr, 0, __ATOMIC_RELEASE)
+
+/* The “bool” version returns true if the comparison is successful and newval is
+ * written. The “val” version returns the contents of *ptr before the operation.
+ */
+#define ATOM_CAS(ptr, oldval, newval)  \
+	__sync_val_compare_and_swap(ptr, oldval, newval)
+
+#define ATOM_CASB(ptr, oldval, newval) \
+	__sync_bool_compare_and_swap(ptr, oldval, newval)
+
+/* perform the operation suggested by the name, and return the new value.
+ */
+#define ATOM_ADD_F(ptr, value)      __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_SUB_F(ptr, value)      __atomic_sub_fetch(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_OR_F(ptr, value)       __atomic_or_fetch(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_AND_F(ptr, value)      __atomic_and_fetch(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_XOR_F(ptr, value)      __atomic_xor_fetch(ptr, value, __ATOMIC_SEQ_CST)
+
+/* perform the operation suggested by the name, and returns the value that had
+ * previously been in memory.
+ */
+#define ATOM_F_ADD(ptr, value)      __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_F_SUB(ptr, value)      __atomic_fetch_sub(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_F_OR(ptr, value)       __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_F_AND(ptr, value)      __atomic_fetch_and(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOM_F_XOR(ptr, value)      __atomic_fetch_xor(ptr, value, __ATOMIC_SEQ_CST)
 
 #elif (GCC_VERSION >= 40102)
 /* issues a full memory barrier. */
@@ -12,6 +12,7 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "zc_defs.h"
 
@@ -75,6 +76,37 @@ size_t zc_parse_byte_size(char *astring)
 	return (res);
 }
 
+long zc_parse_duration_ms(char *astring)
+{
+	/* Parse duration in milliseconds depending on the suffix.
+	 * Valid suffixes are ms, s, m, h and d, no suffix means seconds */
+	char *p;
+	long res;
+
+	zc_assert(astring, 0);
+
+	res = strtol(astring, &p, 10);
+	if (res <= 0)
+		return 0;
+
+	while (isspace(*p)) p++;
+
+	if (STRICMP(p, ==, "ms")) {
+		return res;
+	} else if (*p == '\0' || STRICMP(p, ==, "s")) {
+		return res * 1000;
+	} else if (STRICMP(p, ==, "m")) {
+		return res * 60 * 1000;
+	} else if (STRICMP(p, ==, "h")) {
+		return res * 60 * 60 * 1000;
+	} else if (STRICMP(p, ==, "d")) {
+		return res * 24 * 60 * 60 * 1000;
+	}
+
+	zc_error("Wrong suffix parsing duration for string [%s]", astring);
+	return -1;
+}
+
 /*******************************************************************************/
 int zc_str_replace_env(char *str, size_t str_size)
 {
@@ -174,3 +206,40 @@ char *zc_strndup(const char *s, size_t n)
 
 	return memcpy(new_s, s, len);
 }
+
+/*******************************************************************************/
+volatile unsigned long zc_forks = 0;
+static pthread_mutex_t zc_fork_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t zc_fork_once = PTHREAD_ONCE_INIT;
+
+static void zc_fork_child(void)
+{
+	pthread_mutex_init(&zc_fork_mutex, NULL);
+	zc_forks++;
+}
+
+static void zc_fork_init(void)
+{
+	pthread_atfork(NULL, NULL, zc_fork_child);
+}
+
+void zc_fork_watch(void)
+{
+	pthread_once(&zc_fork_once, zc_fork_init);
+}
+
+int zc_fork_reset(unsigned long *forks, zc_fork_reset_fn reset, void *arg)
+{
+	int rc = 0;
+
+	pthread_mutex_lock(&zc_fork_mutex);
+	if (*forks != zc_forks) {
+		rc = reset(arg);
+		if (rc == 0) {
+			zc_barrier();
+			*forks = zc_forks;
+		}
+	}
+	pthread_mutex_unlock(&zc_fork_mutex);
+	return rc;
+}
@@ -9,12 +9,27 @@
 #define __zc_util_h
 
 size_t zc_parse_byte_size(char *astring);
+long zc_parse_duration_ms(char *astring);
 int zc_str_replace_env(char *str, size_t str_size);
 
 size_t zc_strnlen(const char *s, size_t maxlen);
 char *zc_strdup(const char *s);
 char *zc_strndup(const char *s, size_t n);
 
+/* bumped in a forked child by one pthread_atfork handler, an object keeps
+ * it as of when it was made or reset, so a different value tells it is in
+ * a child, with the locks and without the threads of the parent
+ */
+extern volatile unsigned long zc_forks;
+/* call once before an object keeps zc_forks */
+void zc_fork_watch(void);
+#define zc_forked(forks) ((forks) != zc_forks)
+/* reset(arg) once in a child, by the first thread to get here, the
+ * others wait for it, then *forks is zc_forks, return what reset does
+ */
+typedef int (*zc_fork_reset_fn) (void *arg);
+int zc_fork_reset(unsigned long *forks, zc_fork_reset_fn reset, void *arg);
+
 #define zc_max(a,b) ((a) > (b) ? (a) : (b))
 #define zc_min(a,b) ((a) < (b) ? (a) : (b))
 
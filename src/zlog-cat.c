@@ -0,0 +1,81 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "compress.h"
+#include "flight.h"
+#include "version.h"
+
+
+int main(int argc, char *argv[])
+{
+	int rc = 0;
+	int op;
+	int fd;
+	int rc_flight;
+	static const char *help = 
+		"usage: zlog-cat [log files]...\n"
+		"\tdecode compressed archives and streaming logs to stdout,\n"
+		"\treads stdin when no file is given\n"
+		"\t-h,\tshow help message\n"
+		"zlog version: " ZLOG_VERSION "\n";
+
+	while((op = getopt(argc, argv, "h")) > 0) {
+		if (op == 'h') {
+			fputs(help, stdout);
+			return 0;
+		} else {
+			fputs(help, stderr);
+			return -1;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	setenv("ZLOG_PROFILE_ERROR", "/dev/stderr", 1);
+
+	if (argc == 0) {
+		if (zlog_decompress_fd(STDIN_FILENO, STDOUT_FILENO)) {
+			fprintf(stderr, "---[stdin] decode fail, see error message above\n");
+			exit(2);
+		}
+		exit(0);
+	}
+
+	while (argc > 0) {
+		fd = open(*argv, O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "---[%s] open fail, %s\n", *argv, strerror(errno));
+			rc = 2;
+		} else {
+			rc_flight = zlog_flight_dump_fd(fd, STDOUT_FILENO);
+			if (rc_flight < 0) {
+				fprintf(stderr, "---[%s] flight dump fail, see error message above\n", *argv);
+				rc = 2;
+			} else if (rc_flight > 0 && zlog_decompress_fd(fd, STDOUT_FILENO)) {
+				fprintf(stderr, "---[%s] decode fail, see error message above\n", *argv);
+				rc = 2;
+			}
+			close(fd);
+		}
+		argc--;
+		argv++;
+	}
+
+	exit(rc);
+}
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <errno.h>
 #include <pthread.h>
 
 #include "conf.h"
@@ -20,6 +21,7 @@
 #include "mdc.h"
 #include "zc_defs.h"
 #include "rule.h"
+#include "crash.h"
 #include "version.h"
 
 /*******************************************************************************/
@@ -31,10 +33,20 @@ zlog_conf_t *zlog_env_conf;
 static pthread_key_t zlog_thread_key;
 static zc_hashtable_t *zlog_env_categories;
 static zc_hashtable_t *zlog_env_records;
+/* levels set by zlog_set_category_level_match, for categories made later,
+ * changed under the read lock and level_mutex
+ */
+static zc_arraylist_t *zlog_env_level_patterns;
+static pthread_mutex_t zlog_env_level_mutex = PTHREAD_MUTEX_INITIALIZER;
 static zlog_category_t *zlog_default_category;
 static size_t zlog_env_reload_conf_count;
 static int zlog_env_is_init = 0;
 static int zlog_env_init_version = 0;
+/* of zlog_env_categories, a new one each init and 0 when there is none,
+ * read without the lock by zlog_get_category
+ */
+static volatile int zlog_env_categories_version = 0;
+static int zlog_env_categories_count = 0;
 
 /*******************************************************************************/
 /* inner no need thread-safe */
@@ -47,11 +59,17 @@ static void zlog_fini_inner(void)
 	 * also key not init will cause a core dump
 	 */
 
+	zlog_env_categories_version = 0;
+	zc_barrier();
 	if (zlog_env_categories) zlog_category_table_del(zlog_env_categories);
 	zlog_env_categories = NULL;
 	zlog_default_category = NULL;
 	if (zlog_env_records) zlog_record_table_del(zlog_env_records);
 	zlog_env_records = NULL;
+	if (zlog_env_level_patterns) zc_arraylist_del(zlog_env_level_patterns);
+	zlog_env_level_patterns = NULL;
+	/* before the streams it writes go away */
+	zlog_crash_set(0);
 	if (zlog_env_conf) zlog_conf_del(zlog_env_conf);
 	zlog_env_conf = NULL;
 	return;
@@ -96,11 +114,17 @@ static int zlog_init_inner(const char *confpath)
 		goto err;
 	}
 
+	if (zlog_crash_set(zlog_env_conf->crash_flush)) {
+		zc_error("zlog_crash_set fail");
+		goto err;
+	}
+
 	zlog_env_categories = zlog_category_table_new();
 	if (!zlog_env_categories) {
 		zc_error("zlog_category_table_new fail");
 		goto err;
 	}
+	zlog_env_categories_version = ++zlog_env_categories_count;
 
 	zlog_env_records = zlog_record_table_new();
 	if (!zlog_env_records) {
@@ -108,12 +132,45 @@ static int zlog_init_inner(const char *confpath)
 		goto err;
 	}
 
+	zlog_env_level_patterns = zc_arraylist_new(free, ARRAY_LIST_DEFAULT_SIZE);
+	if (!zlog_env_level_patterns) {
+		zc_error("zc_arraylist_new fail");
+		goto err;
+	}
+
 	return 0;
 err:
 	zlog_fini_inner();
 	return -1;
 }
 
+/*******************************************************************************/
+typedef struct zlog_level_pattern_s {
+	char pattern[MAXLEN_CFG_NAME + 1];
+	int level;
+} zlog_level_pattern_t;
+
+/* under the write lock, a new category takes the levels set by pattern */
+static zlog_category_t *zlog_fetch_category(const char *cname)
+{
+	int i;
+	int is_new;
+	zlog_category_t *a_category;
+	zlog_level_pattern_t *a_pattern;
+
+	is_new = (zc_hashtable_get(zlog_env_categories, cname) == NULL);
+	a_category = zlog_category_table_fetch_category(zlog_env_categories,
+				cname, zlog_env_conf->rule_trie);
+	if (!a_category || !is_new) return a_category;
+
+	zc_arraylist_foreach(zlog_env_level_patterns, i, a_pattern) {
+		if (zlog_rule_trie_fit(a_pattern->pattern, cname)) {
+			zlog_category_set_level(a_category, a_pattern->level);
+		}
+	}
+	return a_category;
+}
+
 /*******************************************************************************/
 int zlog_init(const char *confpath)
 {
@@ -181,12 +238,9 @@ int dzlog_init(const char *confpath, const char *cname)
 		goto err;
 	}
 
-	zlog_default_category = zlog_category_table_fetch_category(
-				zlog_env_categories,
-				cname,
-				zlog_env_conf->rules);
+	zlog_default_category = zlog_fetch_category(cname);
 	if (!zlog_default_category) {
-		zc_error("zlog_category_table_fetch_category[%s] fail", cname);
+		zc_error("zlog_fetch_category[%s] fail", cname);
 		goto err;
 	}
 
@@ -258,7 +312,7 @@ int zlog_reload(const char *confpath)
 		zlog_rule_set_record(a_rule, zlog_env_records);
 	}
 
-	if (zlog_category_table_update_rules(zlog_env_categories, new_conf->rules)) {
+	if (zlog_category_table_update_rules(zlog_env_categories, new_conf->rule_trie)) {
 		c_up = 0;
 		zc_error("zlog_category_table_update fail");
 		goto err;
@@ -271,6 +325,9 @@ int zlog_reload(const char *confpath)
 	if (c_up) zlog_category_table_commit_rules(zlog_env_categories);
 	zlog_conf_del(zlog_env_conf);
 	zlog_env_conf = new_conf;
+	if (zlog_crash_set(zlog_env_conf->crash_flush)) {
+		zc_error("zlog_crash_set fail, crash flush is not changed");
+	}
 	zc_debug("------zlog_reload success, total init verison[%d] ------", zlog_env_init_version);
 	rc = pthread_rwlock_unlock(&zlog_env_lock);
 	if (rc) {
@@ -331,60 +388,66 @@ exit:
 }
 
 /*******************************************************************************/
-zlog_category_t *zlog_get_category(const char *cname)
+int zlog_set_category_level(zlog_category_t *category, int level)
 {
 	int rc = 0;
-	zlog_category_t *a_category = NULL;
 
-	zc_assert(cname, NULL);
-	zc_debug("------zlog_get_category[%s] start------", cname);
-	rc = pthread_rwlock_wrlock(&zlog_env_lock);
+	zc_assert(category, -1);
+	if (level < -1 || level > 254) {
+		zc_error("level[%d] is not -1 or in [0,254]", level);
+		return -1;
+	}
+
+	/* loggers go on, only one level is set at a time */
+	rc = pthread_rwlock_rdlock(&zlog_env_lock);
 	if (rc) {
-		zc_error("pthread_rwlock_wrlock fail, rc[%d]", rc);
-		return NULL;
+		zc_error("pthread_rwlock_rdlock fail, rc[%d]", rc);
+		return -1;
 	}
 
 	if (!zlog_env_is_init) {
 		zc_error("never call zlog_init() or dzlog_init() before");
-		a_category = NULL;
 		goto err;
 	}
 
-	a_category = zlog_category_table_fetch_category(
-				zlog_env_categories,
-				cname,
-				zlog_env_conf->rules);
-	if (!a_category) {
-		zc_error("zlog_category_table_fetch_category[%s] fail", cname);
-		goto err;
-	}
+	pthread_mutex_lock(&zlog_env_level_mutex);
+	zlog_category_set_level(category, level);
+	pthread_mutex_unlock(&zlog_env_level_mutex);
 
-	zc_debug("------zlog_get_category[%s] success, end------ ", cname);
 	rc = pthread_rwlock_unlock(&zlog_env_lock);
 	if (rc) {
 		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
-		return NULL;
+		return -1;
 	}
-	return a_category;
+	return 0;
 err:
-	zc_error("------zlog_get_category[%s] fail, end------ ", cname);
 	rc = pthread_rwlock_unlock(&zlog_env_lock);
 	if (rc) {
 		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
-		return NULL;
+		return -1;
 	}
-	return NULL;
+	return -1;
 }
 
-int dzlog_set_category(const char *cname)
+int zlog_set_category_level_match(const char *pattern, int level)
 {
+	int i;
 	int rc = 0;
-	zc_assert(cname, -1);
+	zlog_level_pattern_t *a_pattern;
 
-	zc_debug("------dzlog_set_category[%s] start------", cname);
-	rc = pthread_rwlock_wrlock(&zlog_env_lock);
+	zc_assert(pattern, -1);
+	if (level < -1 || level > 254) {
+		zc_error("level[%d] is not -1 or in [0,254]", level);
+		return -1;
+	}
+	if (strlen(pattern) > MAXLEN_CFG_NAME) {
+		zc_error("pattern[%s] is longer than [%d]", pattern, MAXLEN_CFG_NAME);
+		return -1;
+	}
+
+	rc = pthread_rwlock_rdlock(&zlog_env_lock);
 	if (rc) {
-		zc_error("pthread_rwlock_wrlock fail, rc[%d]", rc);
+		zc_error("pthread_rwlock_rdlock fail, rc[%d]", rc);
 		return -1;
 	}
 
@@ -393,16 +456,33 @@ int dzlog_set_category(const char *cname)
 		goto err;
 	}
 
-	zlog_default_category = zlog_category_table_fetch_category(
-				zlog_env_categories,
-				cname,
-				zlog_env_conf->rules);
-	if (!zlog_default_category) {
-		zc_error("zlog_category_table_fetch_category[%s] fail", cname);
+	pthread_mutex_lock(&zlog_env_level_mutex);
+
+	/* set again, it goes last to win over the ones before */
+	zc_arraylist_foreach(zlog_env_level_patterns, i, a_pattern) {
+		if (STRCMP(a_pattern->pattern, ==, pattern)) {
+			zc_arraylist_remove(zlog_env_level_patterns, i);
+			break;
+		}
+	}
+	a_pattern = calloc(1, sizeof(zlog_level_pattern_t));
+	if (!a_pattern) {
+		zc_error("calloc fail, errno[%d]", errno);
+		pthread_mutex_unlock(&zlog_env_level_mutex);
+		goto err;
+	}
+	strcpy(a_pattern->pattern, pattern);
+	a_pattern->level = level;
+	if (zc_arraylist_add(zlog_env_level_patterns, a_pattern)) {
+		zc_error("zc_arraylist_add fail");
+		free(a_pattern);
+		pthread_mutex_unlock(&zlog_env_level_mutex);
 		goto err;
 	}
 
-	zc_debug("------dzlog_set_category[%s] end, success------ ", cname);
+	zlog_category_table_set_level(zlog_env_categories, pattern, level);
+	pthread_mutex_unlock(&zlog_env_level_mutex);
+
 	rc = pthread_rwlock_unlock(&zlog_env_lock);
 	if (rc) {
 		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
@@ -410,7 +490,6 @@ int dzlog_set_category(const char *cname)
 	}
 	return 0;
 err:
-	zc_error("------dzlog_set_category[%s] end, fail------ ", cname);
 	rc = pthread_rwlock_unlock(&zlog_env_lock);
 	if (rc) {
 		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
@@ -459,6 +538,139 @@ err:
 	}  \
 } while (0)
 
+/*******************************************************************************/
+zlog_category_t *zlog_get_category(const char *cname)
+{
+	int rc = 0;
+	int version;
+	unsigned int i;
+	zlog_thread_t *a_thread;
+	zlog_category_t *a_category = NULL;
+
+	zc_assert(cname, NULL);
+
+	/* categories stay till zlog_fini, over reload too, so the one this
+	 * thread got before is taken without the lock, by a name of the thread,
+	 * the category is not read as zlog_fini may be freeing it
+	 */
+	i = zc_hashtable_str_hash(cname) % ZLOG_THREAD_CATEGORIES;
+	version = zlog_env_categories_version;
+	zc_barrier();
+	if (version) {
+		a_thread = pthread_getspecific(zlog_thread_key);
+		if (a_thread && a_thread->categories_version == version
+			&& a_thread->categories[i]
+			&& STRCMP(a_thread->category_names[i], ==, cname)) {
+			a_category = a_thread->categories[i];
+			/* zlog_fini did not begin meanwhile */
+			zc_barrier();
+			if (zlog_env_categories_version == version) return a_category;
+		}
+	}
+
+	zc_debug("------zlog_get_category[%s] start------", cname);
+	rc = pthread_rwlock_rdlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_rdlock fail, rc[%d]", rc);
+		return NULL;
+	}
+
+	if (!zlog_env_is_init) {
+		zc_error("never call zlog_init() or dzlog_init() before");
+		goto err;
+	}
+
+	a_category = zc_hashtable_get(zlog_env_categories, cname);
+	if (!a_category) {
+		/* only a new category needs the write lock */
+		rc = pthread_rwlock_unlock(&zlog_env_lock);
+		if (rc) {
+			zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+			return NULL;
+		}
+		rc = pthread_rwlock_wrlock(&zlog_env_lock);
+		if (rc) {
+			zc_error("pthread_rwlock_wrlock fail, rc[%d]", rc);
+			return NULL;
+		}
+
+		if (!zlog_env_is_init) {
+			zc_error("never call zlog_init() or dzlog_init() before");
+			goto err;
+		}
+
+		a_category = zlog_fetch_category(cname);
+		if (!a_category) {
+			zc_error("zlog_fetch_category[%s] fail", cname);
+			goto err;
+		}
+	}
+
+	zlog_fetch_thread(a_thread, err);
+	if (a_thread->categories_version != zlog_env_categories_version) {
+		memset(a_thread->categories, 0x00, sizeof(a_thread->categories));
+		a_thread->categories_version = zlog_env_categories_version;
+	}
+	a_thread->categories[i] = a_category;
+	strcpy(a_thread->category_names[i], a_category->name);
+
+	zc_debug("------zlog_get_category[%s] success, end------ ", cname);
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return NULL;
+	}
+	return a_category;
+err:
+	zc_error("------zlog_get_category[%s] fail, end------ ", cname);
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return NULL;
+	}
+	return NULL;
+}
+
+int dzlog_set_category(const char *cname)
+{
+	int rc = 0;
+	zc_assert(cname, -1);
+
+	zc_debug("------dzlog_set_category[%s] start------", cname);
+	rc = pthread_rwlock_wrlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_wrlock fail, rc[%d]", rc);
+		return -1;
+	}
+
+	if (!zlog_env_is_init) {
+		zc_error("never call zlog_init() or dzlog_init() before");
+		goto err;
+	}
+
+	zlog_default_category = zlog_fetch_category(cname);
+	if (!zlog_default_category) {
+		zc_error("zlog_fetch_category[%s] fail", cname);
+		goto err;
+	}
+
+	zc_debug("------dzlog_set_category[%s] end, success------ ", cname);
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return 0;
+err:
+	zc_error("------dzlog_set_category[%s] end, fail------ ", cname);
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return -1;
+}
+
 /*******************************************************************************/
 void zlog_reset_pidtid(void)
 {
@@ -636,6 +848,157 @@ exit:
 	return;
 }
 
+zlog_mdc_snap_t *zlog_mdc_snapshot(void)
+{
+	int rc = 0;
+	zlog_mdc_snap_t *a_snap = NULL;
+	zlog_thread_t *a_thread;
+
+	rc = pthread_rwlock_rdlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_rdlock fail, rc[%d]", rc);
+		return NULL;
+	}
+
+	if (!zlog_env_is_init) {
+		zc_error("never call zlog_init() or dzlog_init() before");
+		goto exit;
+	}
+
+	zlog_fetch_thread(a_thread, exit);
+
+	a_snap = zlog_mdc_snap(a_thread->mdc);
+	if (!a_snap) zc_error("zlog_mdc_snap fail");
+
+exit:
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+	}
+	return a_snap;
+}
+
+int zlog_mdc_restore(zlog_mdc_snap_t *snapshot)
+{
+	int rc = 0;
+	zlog_thread_t *a_thread;
+
+	rc = pthread_rwlock_rdlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_rdlock fail, rc[%d]", rc);
+		return -1;
+	}
+
+	if (!zlog_env_is_init) {
+		zc_error("never call zlog_init() or dzlog_init() before");
+		goto err;
+	}
+
+	zlog_fetch_thread(a_thread, err);
+
+	zlog_mdc_use(a_thread->mdc, snapshot);
+
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return 0;
+err:
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return -1;
+}
+
+void zlog_mdc_release(zlog_mdc_snap_t *snapshot)
+{
+	zlog_mdc_snap_release(snapshot);
+	return;
+}
+
+int zlog_mdc_push(void)
+{
+	int rc = 0;
+	zlog_thread_t *a_thread;
+
+	rc = pthread_rwlock_rdlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_rdlock fail, rc[%d]", rc);
+		return -1;
+	}
+
+	if (!zlog_env_is_init) {
+		zc_error("never call zlog_init() or dzlog_init() before");
+		goto err;
+	}
+
+	zlog_fetch_thread(a_thread, err);
+
+	if (zlog_mdc_push_snap(a_thread->mdc)) {
+		zc_error("zlog_mdc_push_snap fail");
+		goto err;
+	}
+
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return 0;
+err:
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return -1;
+}
+
+int zlog_mdc_pop(void)
+{
+	int rc = 0;
+	zlog_thread_t *a_thread;
+
+	rc = pthread_rwlock_rdlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_rdlock fail, rc[%d]", rc);
+		return -1;
+	}
+
+	if (!zlog_env_is_init) {
+		zc_error("never call zlog_init() or dzlog_init() before");
+		goto err;
+	}
+
+	a_thread = pthread_getspecific(zlog_thread_key);
+	if (!a_thread) {
+		zc_error("thread not found, maybe not use zlog_mdc_push before");
+		goto err;
+	}
+
+	if (zlog_mdc_pop_snap(a_thread->mdc)) {
+		zc_error("zlog_mdc_pop_snap fail");
+		goto err;
+	}
+
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return 0;
+err:
+	rc = pthread_rwlock_unlock(&zlog_env_lock);
+	if (rc) {
+		zc_error("pthread_rwlock_unlock fail, rc=[%d]", rc);
+		return -1;
+	}
+	return -1;
+}
+
 /*******************************************************************************/
 void vzlog(zlog_category_t * category,
 	const char *file, size_t filelen,
@@ -849,6 +1212,51 @@ reload:
 	return;
 }
 
+/*******************************************************************************/
+void zlog_kv_array(zlog_category_t * category,
+	const char *file, size_t filelen, const char *func, size_t funclen,
+	long line, int level,
+	const char *msg, const zlog_field_t *fields, size_t count)
+{
+	zlog_thread_t *a_thread;
+
+	if (category && zlog_category_needless_level(category, level)) return;
+
+	pthread_rwlock_rdlock(&zlog_env_lock);
+
+	if (!zlog_env_is_init) {
+		zc_error("never call zlog_init() or dzlog_init() before");
+		goto exit;
+	}
+
+	zlog_fetch_thread(a_thread, exit);
+
+	zlog_event_set_kv(a_thread->event, category->name, category->name_len,
+		file, filelen, func, funclen, line, level,
+		msg, fields, count);
+	if (zlog_category_output(category, a_thread)) {
+		zc_error("zlog_output fail, srcfile[%s], srcline[%ld]", file, line);
+		goto exit;
+	}
+
+	if (zlog_env_conf->reload_conf_period &&
+		++zlog_env_reload_conf_count > zlog_env_conf->reload_conf_period ) {
+		/* under the protection of lock read env conf */
+		goto reload;
+	}
+
+exit:
+	pthread_rwlock_unlock(&zlog_env_lock);
+	return;
+reload:
+	pthread_rwlock_unlock(&zlog_env_lock);
+	/* will be wrlock, so after unlock */
+	if (zlog_reload((char *)-1)) {
+		zc_error("reach reload-conf-period but zlog_reload fail, zlog-chk-conf [file] see detail");
+	}
+	return;
+}
+
 /*******************************************************************************/
 void zlog(zlog_category_t * category,
 	const char *file, size_t filelen, const char *func, size_t funclen,
@@ -984,48 +1392,54 @@ void zlog_profile(void)
 }
 
 /*******************************************************************************/
-int zlog_set_record(const char *rname, zlog_record_fn record_output)
+/* a_record takes the place of the one of its name, in rules too */
+static int zlog_put_record(zlog_record_t *a_record)
 {
-	int rc = 0;
+	int rc = -1;
 	int rd = 0;
 	zlog_rule_t *a_rule;
-	zlog_record_t *a_record;
 	int i = 0;
-
-	zc_assert(rname, -1);
-	zc_assert(record_output, -1);
+	zc_hashtable_entry_t *a_entry;
+	zlog_record_t *old_record = NULL;
 
 	rd = pthread_rwlock_wrlock(&zlog_env_lock);
 	if (rd) {
 		zc_error("pthread_rwlock_rdlock fail, rd[%d]", rd);
+		zlog_record_del(a_record);
 		return -1;
 	}
 
 	if (!zlog_env_is_init) {
 		zc_error("never call zlog_init() or dzlog_init() before");
-		goto zlog_set_record_exit;
-	}
-
-	a_record = zlog_record_new(rname, record_output);
-	if (!a_record) {
-		rc = -1;
-		zc_error("zlog_record_new fail");
-		goto zlog_set_record_exit;
+		zlog_record_del(a_record);
+		goto zlog_put_record_exit;
 	}
 
-	rc = zc_hashtable_put(zlog_env_records, a_record->name, a_record);
-	if (rc) {
-		zlog_record_del(a_record);
-		zc_error("zc_hashtable_put fail");
-		goto zlog_set_record_exit;
+	/* the one it takes the place of is deleted out of lock,
+	 * that waits for a batch callback, which may log
+	 */
+	a_entry = zc_hashtable_get_entry(zlog_env_records, a_record->name);
+	if (a_entry) {
+		old_record = a_entry->value;
+		a_entry->key = a_record->name;
+		a_entry->value = a_record;
+		rc = 0;
+	} else {
+		rc = zc_hashtable_put(zlog_env_records, a_record->name, a_record);
+		if (rc) {
+			zlog_record_del(a_record);
+			zc_error("zc_hashtable_put fail");
+			goto zlog_put_record_exit;
+		}
 	}
 
 	zc_arraylist_foreach(zlog_env_conf->rules, i, a_rule) {
 		zlog_rule_set_record(a_rule, zlog_env_records);
 	}
 
-zlog_set_record_exit:
+zlog_put_record_exit:
 	rd = pthread_rwlock_unlock(&zlog_env_lock);
+	if (old_record) zlog_record_del(old_record);
 	if (rd) {
 		zc_error("pthread_rwlock_unlock fail, rd=[%d]", rd);
 		return -1;
@@ -1033,6 +1447,52 @@ zlog_set_record_exit:
 	return rc;
 }
 
+int zlog_set_record(const char *rname, zlog_record_fn record_output)
+{
+	zlog_record_t *a_record;
+
+	zc_assert(rname, -1);
+	zc_assert(record_output, -1);
+
+	a_record = zlog_record_new(rname, record_output);
+	if (!a_record) {
+		zc_error("zlog_record_new fail");
+		return -1;
+	}
+	return zlog_put_record(a_record);
+}
+
+int zlog_set_record_event(const char *rname, zlog_record_event_fn record_output)
+{
+	zlog_record_t *a_record;
+
+	zc_assert(rname, -1);
+	zc_assert(record_output, -1);
+
+	a_record = zlog_record_new_event(rname, record_output);
+	if (!a_record) {
+		zc_error("zlog_record_new_event fail");
+		return -1;
+	}
+	return zlog_put_record(a_record);
+}
+
+int zlog_set_record_batch(const char *rname, zlog_record_batch_fn record_output,
+		size_t batch_size, long latency_ms)
+{
+	zlog_record_t *a_record;
+
+	zc_assert(rname, -1);
+	zc_assert(record_output, -1);
+
+	a_record = zlog_record_new_batch(rname, record_output, batch_size, latency_ms);
+	if (!a_record) {
+		zc_error("zlog_record_new_batch fail");
+		return -1;
+	}
+	return zlog_put_record(a_record);
+}
+
 /*******************************************************************************/
 int zlog_level_enabled(zlog_category_t *category, const int level)
 {
@@ -30,9 +30,23 @@ void zlog_fini(void);
 
 void zlog_profile(void);
 
+/* a category is valid till zlog_fini, calling this in one thread while
+ * another calls zlog_fini is not supported
+ */
 zlog_category_t *zlog_get_category(const char *cname);
 int zlog_level_enabled(zlog_category_t *category, const int level);
 
+/* records of category below level are dropped, and its rules of the
+ * lowest level, as my_cat.INFO, take the ones at level and above, rules
+ * of higher levels and of = and ! keep their own, -1 goes back to the
+ * levels of rules, no conf is read and it stays over zlog_reload
+ */
+int zlog_set_category_level(zlog_category_t *category, int level);
+/* the same for categories whose name fits pattern as a rule category,
+ * aa, aa_, * or a glob as net_*_rx, now and made later
+ */
+int zlog_set_category_level_match(const char *pattern, int level);
+
 /* for multi-process application, if did not call exec*() in the child process
  * immediately after fork(), caller need to call this function in the child
  * process to reset the process id and thread id before logging, to make sure
@@ -40,11 +54,30 @@ int zlog_level_enabled(zlog_category_t *category, const int level);
  */
 void zlog_reset_pidtid(void);
 
+/* the value of zlog_get_mdc() stays until its key is put again or removed,
+ * or the mdc of the thread is cleaned, restored or popped
+ */
 int zlog_put_mdc(const char *key, const char *value);
 char *zlog_get_mdc(const char *key);
 void zlog_remove_mdc(const char *key);
 void zlog_clean_mdc(void);
 
+/* mdc of the thread as it is now, read only and shared, for a task which
+ * goes on in other threads, each zlog_mdc_snapshot() needs one
+ * zlog_mdc_release(), even after zlog_fini()
+ */
+typedef struct zlog_mdc_snap_s zlog_mdc_snapshot_t;
+zlog_mdc_snapshot_t *zlog_mdc_snapshot(void);
+/* the thread has the mdc of snapshot, NULL cleans it, the first put or
+ * remove after that copies it
+ */
+int zlog_mdc_restore(zlog_mdc_snapshot_t *snapshot);
+void zlog_mdc_release(zlog_mdc_snapshot_t *snapshot);
+
+/* zlog_mdc_pop() gives back the mdc of the thread at zlog_mdc_push() */
+int zlog_mdc_push(void);
+int zlog_mdc_pop(void);
+
 void zlog(zlog_category_t * category,
 	const char *file, size_t filelen,
 	const char *func, size_t funclen,
@@ -61,6 +94,35 @@ void hzlog(zlog_category_t * category,
 	long line, int level,
 	const void *buf, size_t buflen);
 
+/* a typed field of zlog_kv(), put in the record as it is, no printf
+ * %m is the message then the fields as key=value, %k all fields as
+ * key=value, %k(key) the value of one, %J has them as members
+ */
+typedef enum {
+	ZLOG_FIELD_INT = 1,
+	ZLOG_FIELD_UINT = 2,
+	ZLOG_FIELD_DOUBLE = 3,
+	ZLOG_FIELD_STR = 4,
+	ZLOG_FIELD_BOOL = 5
+} zlog_field_type;
+
+typedef struct zlog_field_s {
+	const char *key;
+	int type;
+	union {
+		long long i;
+		unsigned long long u;
+		double d;
+		const char *s;
+	} v;
+} zlog_field_t;
+
+void zlog_kv_array(zlog_category_t * category,
+	const char *file, size_t filelen,
+	const char *func, size_t funclen,
+	long line, int level,
+	const char *msg, const zlog_field_t *fields, size_t count);
+
 int dzlog_init(const char *confpath, const char *cname);
 int dzlog_set_category(const char *cname);
 
@@ -86,6 +148,61 @@ typedef struct zlog_msg_s {
 typedef int (*zlog_record_fn)(zlog_msg_t *msg);
 int zlog_set_record(const char *rname, zlog_record_fn record);
 
+/* what zlog knew of a record, so record need not parse msg->buf again
+ * all is read only and valid during the call, strings end with '\0'
+ * event is NULL for a record kept by backtrace= or a line of how many
+ * were dropped or repeated, msg is all there is of those
+ */
+typedef struct zlog_record_event_s {
+	const char *category;
+	size_t category_len;
+	int level;
+	const char *level_name;		/* as in conf, upper case */
+	long time_sec;
+	long time_usec;
+	const char *file;
+	size_t file_len;
+	const char *func;
+	size_t func_len;
+	long line;
+	long pid;
+	unsigned long tid;
+	long ktid;
+	const char *host;
+	size_t host_len;
+	const char *usr_msg;		/* %m, the dump of hzlog too */
+	size_t usr_msg_len;
+	const zlog_field_t *fields;	/* of zlog_kv, usr_msg is its message alone */
+	size_t field_count;
+} zlog_record_event_t;
+
+typedef int (*zlog_record_event_fn)(zlog_msg_t *msg, const zlog_record_event_t *event);
+int zlog_set_record_event(const char *rname, zlog_record_event_fn record);
+
+/* records of $rname are copied and given to record in batches, by a
+ * thread of zlog, when batch_size of them are there or latency_ms after
+ * the first of them came, a writer waits when two batches are taken
+ * record may log by other rules, but not while zlog_fini waits for it
+ * with the records left
+ */
+typedef int (*zlog_record_batch_fn)(zlog_msg_t *msgs, size_t count);
+int zlog_set_record_batch(const char *rname, zlog_record_batch_fn record,
+	size_t batch_size, long latency_ms);
+
+/* reader of a >shm ring, in another process, records are not copied
+ * *rec stays valid until zlog_shm_done, one reader for a ring at a time
+ * zlog_shm_next returns 1 for a record, 0 when there is none yet, -1 on fail
+ * zlog_shm_done gives all read so far back to the writers
+ * a record whose writer process died while copying it in is skipped and
+ * counted in zlog_shm_dropped
+ */
+typedef struct zlog_shm_reader_s zlog_shm_reader_t;
+zlog_shm_reader_t *zlog_shm_open(const char *path);
+int zlog_shm_next(zlog_shm_reader_t *reader, const char **rec, size_t *len);
+void zlog_shm_done(zlog_shm_reader_t *reader);
+unsigned long zlog_shm_dropped(zlog_shm_reader_t *reader);
+void zlog_shm_close(zlog_shm_reader_t *reader);
+
 const char *zlog_version(void);
 
 /******* useful macros, can be redefined at user's h file **********/
@@ -268,6 +385,22 @@ typedef enum {
 	hdzlog(__FILE__, sizeof(__FILE__)-1, __func__, sizeof(__func__)-1, __LINE__, \
 	ZLOG_LEVEL_DEBUG, buf, buf_len)
 
+/* zlog_kv macros, the fields are an array on the stack of the caller
+ * zlog_kv(zc, ZLOG_LEVEL_INFO, "login", ZLOG_STR("user", u), ZLOG_INT("us", t));
+ */
+#if defined __STDC_VERSION__ && __STDC_VERSION__ >= 199901L
+#define ZLOG_INT(k, x)		{ (k), ZLOG_FIELD_INT, { .i = (x) } }
+#define ZLOG_UINT(k, x)		{ (k), ZLOG_FIELD_UINT, { .u = (x) } }
+#define ZLOG_DOUBLE(k, x)	{ (k), ZLOG_FIELD_DOUBLE, { .d = (x) } }
+#define ZLOG_STR(k, x)		{ (k), ZLOG_FIELD_STR, { .s = (x) } }
+#define ZLOG_BOOL(k, x)		{ (k), ZLOG_FIELD_BOOL, { .i = !!(x) } }
+#define zlog_kv(cat, level, msg, ...) do { \
+	const zlog_field_t zlog_kv_fields_[] = { __VA_ARGS__ }; \
+	zlog_kv_array(cat, __FILE__, sizeof(__FILE__)-1, __func__, sizeof(__func__)-1, __LINE__, \
+	level, msg, zlog_kv_fields_, sizeof(zlog_kv_fields_) / sizeof(zlog_kv_fields_[0])); \
+} while (0)
+#endif
+
 /* enabled macros */
 #define zlog_fatal_enabled(zc) zlog_level_enabled(zc, ZLOG_LEVEL_FATAL)
 #define zlog_error_enabled(zc) zlog_level_enabled(zc, ZLOG_LEVEL_ERROR)
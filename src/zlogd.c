@@ -0,0 +1,270 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include "fmacros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+#include "zlog.h"
+#include "zlogd.h"
+#include "version.h"
+
+#define ZLOGD_MAX_CLIENTS	1024
+#define ZLOGD_BUF_SIZE		(64 * 1024)
+
+/* a writer process, and what it sent which is not a whole frame yet */
+typedef struct zlogd_client_s {
+	char *buf;
+	size_t size;
+	size_t len;
+	char cname[256];		/* category of the last record */
+	zlog_category_t *category;
+} zlogd_client_t;
+
+static volatile sig_atomic_t zlogd_stop;
+static volatile sig_atomic_t zlogd_reload;
+
+static struct pollfd zlogd_fds[ZLOGD_MAX_CLIENTS + 1];
+static zlogd_client_t zlogd_clients[ZLOGD_MAX_CLIENTS + 1];
+static int zlogd_nfds;
+
+static void zlogd_on_signal(int sig)
+{
+	if (sig == SIGHUP) {
+		zlogd_reload = 1;
+	} else {
+		zlogd_stop = 1;
+	}
+}
+
+static int zlogd_listen(const char *path)
+{
+	int fd;
+	struct sockaddr_un addr;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "socket path[%s] is too long\n", path);
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	unlink(path);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 128)) {
+		fprintf(stderr, "listen on [%s] fail, errno[%d]\n", path, errno);
+		if (fd >= 0) close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void zlogd_add(int fd)
+{
+	zlogd_client_t *a_client;
+
+	if (zlogd_nfds > ZLOGD_MAX_CLIENTS) {
+		fprintf(stderr, "too many clients, one is closed\n");
+		close(fd);
+		return;
+	}
+	a_client = &zlogd_clients[zlogd_nfds];
+	memset(a_client, 0, sizeof(*a_client));
+	a_client->size = ZLOGD_BUF_SIZE;
+	a_client->buf = malloc(a_client->size);
+	if (!a_client->buf) {
+		fprintf(stderr, "malloc fail, errno[%d]\n", errno);
+		close(fd);
+		return;
+	}
+	zlogd_fds[zlogd_nfds].fd = fd;
+	zlogd_fds[zlogd_nfds].events = POLLIN;
+	zlogd_nfds++;
+}
+
+static void zlogd_del(int i)
+{
+	close(zlogd_fds[i].fd);
+	free(zlogd_clients[i].buf);
+	zlogd_nfds--;
+	zlogd_fds[i] = zlogd_fds[zlogd_nfds];
+	zlogd_clients[i] = zlogd_clients[zlogd_nfds];
+}
+
+/* one frame, level, category name and record */
+static void zlogd_log(zlogd_client_t * a_client, const char *frame, size_t len)
+{
+	int level;
+	size_t n;
+
+	if (len < 2 || len < 2 + (size_t)(unsigned char)frame[1]) {
+		fprintf(stderr, "frame of [%ld] bytes is cut\n", (long)len);
+		return;
+	}
+	level = (unsigned char)frame[0];
+	n = (unsigned char)frame[1];
+
+	/* a client sends mostly to one category, do not look it up each time */
+	if (!a_client->category || strlen(a_client->cname) != n
+		|| memcmp(a_client->cname, frame + 2, n)) {
+		memcpy(a_client->cname, frame + 2, n);
+		a_client->cname[n] = '\0';
+		a_client->category = zlog_get_category(a_client->cname);
+		if (!a_client->category) return;
+	}
+
+	frame += 2 + n;
+	len -= 2 + n;
+	if (len > 0 && frame[len - 1] == '\n') len--;
+	zlog(a_client->category, __FILE__, sizeof(__FILE__) - 1, "", 0, 0,
+		level, "%.*s", (int)len, frame);
+}
+
+/* return -1 when the client is gone */
+static int zlogd_read(zlogd_client_t * a_client, int fd)
+{
+	ssize_t nread;
+	uint32_t n;
+	char *p;
+	char *end;
+	char *buf;
+
+	if (a_client->len == a_client->size) {
+		buf = realloc(a_client->buf, a_client->size * 2);
+		if (!buf) {
+			fprintf(stderr, "realloc fail, errno[%d]\n", errno);
+			return -1;
+		}
+		a_client->buf = buf;
+		a_client->size *= 2;
+	}
+
+	nread = read(fd, a_client->buf + a_client->len, a_client->size - a_client->len);
+	if (nread < 0 && errno == EINTR) return 0;
+	if (nread <= 0) return -1;
+	a_client->len += nread;
+
+	p = a_client->buf;
+	end = a_client->buf + a_client->len;
+	while (end - p >= 4) {
+		memcpy(&n, p, 4);
+		n = ntohl(n);
+		if ((size_t)(end - p) < 4 + (size_t)n) break;
+		zlogd_log(a_client, p + 4, n);
+		p += 4 + n;
+	}
+	a_client->len = end - p;
+	memmove(a_client->buf, p, a_client->len);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int op;
+	int i;
+	int fd;
+	int rc;
+	const char *conf = NULL;
+	const char *path = ZLOGD_DEFAULT_PATH;
+	struct sigaction sa;
+	static const char *help =
+		"usage: zlogd -c conf [-s socket]\n"
+		"\ttake records of >zlogd rules from all processes, and log them\n"
+		"\tby conf, which owns the files, rotation and fsync of them\n"
+		"\t-c,\tconf file of zlogd\n"
+		"\t-s,\tunix socket to listen on, " ZLOGD_DEFAULT_PATH " by default\n"
+		"\t-h,\tshow help message\n"
+		"\tSIGHUP reloads conf, SIGTERM or SIGINT writes all out and exits\n"
+		"zlog version: " ZLOG_VERSION "\n";
+
+	while((op = getopt(argc, argv, "c:s:h")) > 0) {
+		if (op == 'c') {
+			conf = optarg;
+		} else if (op == 's') {
+			path = optarg;
+		} else if (op == 'h') {
+			fputs(help, stdout);
+			return 0;
+		} else {
+			fputs(help, stderr);
+			return -1;
+		}
+	}
+	if (!conf) {
+		fputs(help, stderr);
+		return -1;
+	}
+
+	setenv("ZLOG_PROFILE_ERROR", "/dev/stderr", 0);
+	if (zlog_init(conf)) {
+		fprintf(stderr, "zlog_init [%s] fail, see error message above\n", conf);
+		return 2;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = zlogd_on_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGHUP, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	fd = zlogd_listen(path);
+	if (fd < 0) {
+		zlog_fini();
+		return 3;
+	}
+	zlogd_fds[0].fd = fd;
+	zlogd_fds[0].events = POLLIN;
+	zlogd_nfds = 1;
+
+	while (!zlogd_stop) {
+		if (zlogd_reload) {
+			zlogd_reload = 0;
+			/* categories stay valid, the ones of clients too */
+			if (zlog_reload(conf)) {
+				fprintf(stderr, "zlog_reload [%s] fail, old conf goes on\n", conf);
+			}
+		}
+
+		rc = poll(zlogd_fds, zlogd_nfds, -1);
+		if (rc <= 0) continue;
+
+		for (i = zlogd_nfds - 1; i >= 1; i--) {
+			if (!zlogd_fds[i].revents) continue;
+			if (zlogd_read(&zlogd_clients[i], zlogd_fds[i].fd)) zlogd_del(i);
+		}
+		if (zlogd_fds[0].revents) {
+			fd = accept(zlogd_fds[0].fd, NULL, NULL);
+			if (fd >= 0) zlogd_add(fd);
+		}
+	}
+
+	/* what clients sent is logged first */
+	for (i = zlogd_nfds - 1; i >= 1; i--) {
+		while (poll(&zlogd_fds[i], 1, 0) > 0
+			&& zlogd_read(&zlogd_clients[i], zlogd_fds[i].fd) == 0);
+		zlogd_del(i);
+	}
+	close(zlogd_fds[0].fd);
+	unlink(path);
+
+	zlog_fini();
+	return 0;
+}
@@ -0,0 +1,27 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#ifndef __zlogd_h
+#define __zlogd_h
+
+/* >zlogd "/run/zlogd.sock" sends each record on a unix stream socket,
+ * after 4 bytes of its length in network order, as
+ *   0    level, 1 byte
+ *   1    n, length of the category name, 1 byte
+ *   2    category name, n bytes
+ *   2+n  the record as the format of the rule made it
+ * zlogd logs the record, without its last newline, at that level to
+ * the category of that name of its own conf
+ */
+#define ZLOGD_DEFAULT_PATH	"/run/zlogd.sock"
+#define ZLOGD_TAG_MAX		(2 + 255)
+
+/* zlogd gets how many records a client dropped in this category */
+#define ZLOGD_REPORT_CATEGORY	"zlogd"
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "zlog.h"
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long loop_count;
+	zlog_category_t *zc;
+
+	if (argc != 2) {
+		fprintf(stderr, "test_backtrace nloop\n");
+		exit(1);
+	}
+	loop_count = atol(argv[1]);
+
+	rc = zlog_init("test_backtrace.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	for (i = 0; i < loop_count; i++) {
+		zlog_debug(zc, "debug %ld, kept in memory", i);
+		if (i % 100 == 99) {
+			zlog_error(zc, "error %ld, the last 5 debug records are written ahead", i);
+		}
+	}
+
+	zlog_fini();
+
+	printf("cat test_backtrace.log, 6 lines for each 100 of nloop\n");
+	return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "zlog.h"
+
+static zlog_category_t *zc;
+static long loop_count;
+
+void * work(void *ptr)
+{
+	long j = loop_count;
+	while(j-- > 0) {
+		zlog_info(zc, "loglog %ld, gathered in the block of this thread", j);
+		if (j % 10000 == 0) {
+			zlog_error(zc, "error %ld, written before zlog_error returns", j);
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long thread_count;
+
+	if (argc != 3) {
+		fprintf(stderr, "test_buffer nthreads nloop\n");
+		exit(1);
+	}
+
+	rc = zlog_init("test_buffer.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	/* in the block of main, an error of another thread writes it too */
+	zlog_info(zc, "main, in the block of the main thread");
+
+	thread_count = atol(argv[1]);
+	loop_count = atol(argv[2]);
+	{
+		pthread_t tid[thread_count];
+		for (i = 0; i < thread_count; i++) {
+			pthread_create(&(tid[i]), NULL, work, NULL);
+		}
+		for (i = 0; i < thread_count; i++) {
+			pthread_join(tid[i], NULL);
+		}
+	}
+
+	{
+		FILE *fp;
+		char line[1024];
+		int found = 0;
+
+		fp = fopen("test_buffer.log", "r");
+		while (fp && fgets(line, sizeof(line), fp)) {
+			if (strstr(line, "main, in the block")) found = 1;
+		}
+		if (fp) fclose(fp);
+		printf("record of main before the errors of others: %s\n", found ? "yes" : "no");
+	}
+
+	/* no zlog_fini, what is left in blocks is written at exit */
+	printf("wc -l test_buffer.log, nthreads * (nloop + nloop / 10000) lines\n");
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+
+#include "zlog.h"
+
+static void log_all(const char *step, zlog_category_t *eth0, zlog_category_t *lo,
+	zlog_category_t *app)
+{
+	printf("--- %s\n", step);
+	fflush(stdout);
+	zlog_debug(eth0, "debug");
+	zlog_info(eth0, "info");
+	zlog_error(eth0, "error");
+	zlog_debug(lo, "debug");
+	zlog_info(lo, "info");
+	zlog_debug(app, "debug");
+	zlog_info(app, "info");
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	zlog_category_t *eth0;
+	zlog_category_t *lo;
+	zlog_category_t *app;
+
+	rc = zlog_init("test_category_level.conf");
+	if (rc) {
+		printf("init failed\n");
+		return -1;
+	}
+
+	eth0 = zlog_get_category("net_eth0");
+	lo = zlog_get_category("net_lo");
+	app = zlog_get_category("app");
+	if (!eth0 || !lo || !app) {
+		printf("get cat fail\n");
+		zlog_fini();
+		return -2;
+	}
+	log_all("as conf", eth0, lo, app);
+
+	/* debug of one subsystem in an incident, net_eth0.ERROR still takes
+	 * errors only, and net_eth0.=INFO infos only
+	 */
+	zlog_set_category_level(eth0, ZLOG_LEVEL_DEBUG);
+	log_all("net_eth0 at debug", eth0, lo, app);
+
+	/* all of net_, and the ones made later */
+	zlog_set_category_level_match("net_*", ZLOG_LEVEL_DEBUG);
+	zlog_set_category_level(app, ZLOG_LEVEL_ERROR);
+	log_all("net_* at debug, app at error", eth0, lo, app);
+	zlog_debug(zlog_get_category("net_wifi"), "debug of a new category");
+
+	zlog_reload("test_category_level.conf");
+	log_all("after reload", eth0, lo, app);
+
+	zlog_set_category_level_match("*", -1);
+	log_all("back to conf", eth0, lo, app);
+	zlog_debug(zlog_get_category("net_wlan"), "debug of a new category, not shown");
+
+	zlog_fini();
+
+	return 0;
+}
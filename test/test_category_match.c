@@ -0,0 +1,49 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+
+#include "zlog.h"
+
+static const char *names[] = {
+	"net_eth0_rx",		/* net_*_rx */
+	"net_lo_rx",		/* net_*_rx */
+	"net_eth0_tx",		/* net_eth?_tx */
+	"net_eth10_tx",		/* none, ! */
+	"app",			/* app_ */
+	"app_db",		/* app_ and app_db */
+	"app1_db",		/* none, ! */
+};
+
+int main(int argc, char** argv)
+{
+	int rc;
+	int i;
+	zlog_category_t *zc;
+
+	rc = zlog_init("test_category_match.conf");
+	if (rc) {
+		printf("init failed\n");
+		return -1;
+	}
+
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		zc = zlog_get_category(names[i]);
+		if (!zc) {
+			printf("get cat fail\n");
+			zlog_fini();
+			return -2;
+		}
+		zlog_debug(zc, "hello, zlog - debug");
+		zlog_info(zc, "hello, zlog - info");
+	}
+
+	zlog_fini();
+
+	return 0;
+}
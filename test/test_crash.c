@@ -0,0 +1,63 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "zlog.h"
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long loop_count;
+	pid_t pid;
+	int status;
+	zlog_category_t *zc;
+
+	if (argc != 2) {
+		fprintf(stderr, "test_crash nloop\n");
+		exit(1);
+	}
+	loop_count = atol(argv[1]);
+
+	/* the child crashes, blocks are never full and flush is 1h */
+	pid = fork();
+	if (pid == 0) {
+		rc = zlog_init("test_crash.conf");
+		if (rc) {
+			printf("init failed\n");
+			return 2;
+		}
+
+		zc = zlog_get_category("my_cat");
+		if (!zc) {
+			printf("get cat failed\n");
+			zlog_fini();
+			return 3;
+		}
+
+		for (i = 0; i < loop_count; i++) {
+			zlog_info(zc, "loglog %ld, written by the crash handler", i);
+		}
+		abort();
+	}
+
+	waitpid(pid, &status, 0);
+	if (WIFSIGNALED(status)) {
+		printf("child killed by signal %d\n", WTERMSIG(status));
+	}
+
+	/* the reader of the pipe is still asleep */
+	sleep(2);
+	printf("wc -l test_crash.log test_crash.p.log; ../src/zlog-cat test_crash.z.log | wc -l, nloop lines each\n");
+	return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "zlog.h"
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	zlog_category_t *zc;
+
+	rc = zlog_init("test_dedup.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	/* one line, then a count of 999 */
+	for (i = 0; i < 1000; i++) {
+		zlog_warn(zc, "connect to %s fail, retry", "127.0.0.1:80");
+	}
+	zlog_info(zc, "connected");
+
+	/* window is 1s, a line each 4 or 5 */
+	for (i = 0; i < 10; i++) {
+		zlog_warn(zc, "connect to %s fail, retry", "127.0.0.1:80");
+		usleep(250 * 1000);
+	}
+	zlog_info(zc, "connected");
+
+	zlog_fini();
+
+	printf("cat test_dedup.log, repeats are counted\n");
+	return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "zlog.h"
+
+#define SOCK_PATH "test_devlog.sock"
+
+static volatile int stop;
+static volatile int nrecv;
+
+/* a daemon stand-in, binds the path and prints what comes */
+static int bind_sock(void)
+{
+	int fd;
+	struct sockaddr_un addr;
+	struct timeval tv = { 0, 100 * 1000 };
+
+	unlink(SOCK_PATH);
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, SOCK_PATH);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		perror("bind");
+		exit(1);
+	}
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	return fd;
+}
+
+void * daemon_run(void *arg)
+{
+	int fd = *(int *)arg;
+	char buf[4096];
+	ssize_t n;
+
+	while (!stop) {
+		n = recv(fd, buf, sizeof(buf) - 1, 0);
+		if (n <= 0) continue;
+		buf[n] = '\0';
+		printf("%s\n", buf);
+		nrecv++;
+	}
+	close(fd);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	int fd;
+	long i;
+	pthread_t tid;
+	zlog_category_t *zc;
+
+	fd = bind_sock();
+	pthread_create(&tid, NULL, daemon_run, &fd);
+
+	rc = zlog_init("test_devlog.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	for (i = 0; i < 3; i++) {
+		zlog_info(zc, "loglog %ld, to the first daemon", i);
+	}
+
+	/* the daemon is restarted, the client connects to the new one */
+	usleep(200 * 1000);
+	stop = 1;
+	pthread_join(tid, NULL);
+	stop = 0;
+	fd = bind_sock();
+	pthread_create(&tid, NULL, daemon_run, &fd);
+	sleep(1);
+
+	for (i = 0; i < 3; i++) {
+		zlog_error(zc, "loglog %ld, to the second daemon", i);
+	}
+
+	usleep(200 * 1000);
+	stop = 1;
+	pthread_join(tid, NULL);
+	unlink(SOCK_PATH);
+
+	zlog_fini();
+
+	printf("%d records received, 12 expected, 6 for each rule\n", nrecv);
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "zlog.h"
+
+static zlog_category_t *zc;
+static long loop_count;
+
+void * work(void *ptr)
+{
+	long j = loop_count;
+	while(j-- > 0) {
+		zlog_debug(zc, "loglog %ld, copied into the ring", j);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long thread_count;
+
+	if (argc != 3) {
+		fprintf(stderr, "test_flight nthreads nloop\n");
+		exit(1);
+	}
+
+	rc = zlog_init("test_flight.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	thread_count = atol(argv[1]);
+	loop_count = atol(argv[2]);
+	{
+		pthread_t tid[thread_count];
+		for (i = 0; i < thread_count; i++) {
+			pthread_create(&(tid[i]), NULL, work, NULL);
+		}
+		for (i = 0; i < thread_count; i++) {
+			pthread_join(tid[i], NULL);
+		}
+	}
+
+	/* the ring is in the file without zlog_fini, or even after a crash */
+	printf("../src/zlog-cat test_flight.ring | tail, the last records of each thread\n");
+	return 0;
+}
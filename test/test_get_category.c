@@ -0,0 +1,85 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "zlog.h"
+
+#define NTHREAD	4
+
+static const char *names[] = { "my_cat", "my_cat_db", "my_cat_net", "my_cat_rpc" };
+static zlog_category_t *first[4];
+static int nloop = 100000;
+static int nbad;
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* a module gets its category for each request */
+static void *work(void *arg)
+{
+	int i;
+	zlog_category_t *zc;
+
+	for (i = 0; i < nloop; i++) {
+		zc = zlog_get_category(names[i % 4]);
+		if (zc != first[i % 4]) __sync_fetch_and_add(&nbad, 1);
+	}
+	return NULL;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	int i;
+	double t;
+	zlog_category_t *zc;
+	pthread_t tids[NTHREAD];
+
+	if (argc == 2) nloop = atoi(argv[1]);
+
+	rc = zlog_init("test_get_category.conf");
+	if (rc) {
+		printf("init failed\n");
+		return -1;
+	}
+
+	for (i = 0; i < 4; i++) first[i] = zlog_get_category(names[i]);
+
+	t = now();
+	for (i = 0; i < NTHREAD; i++) pthread_create(&tids[i], NULL, work, NULL);
+	for (i = 0; i < NTHREAD; i++) pthread_join(tids[i], NULL);
+	printf("%d threads, zlog_get_category: %.0f ns, other category got: %d\n",
+		NTHREAD, (now() - t) * 1e9 / nloop, nbad);
+	fflush(stdout);
+
+	/* the same category after reload */
+	zlog_reload("test_get_category.conf");
+	zc = zlog_get_category("my_cat");
+	printf("same after reload: %s\n", zc == first[0] ? "yes" : "no");
+	fflush(stdout);
+	zlog_info(zc, "after reload");
+
+	/* after fini the one got before is not given again */
+	zlog_fini();
+	if (zlog_get_category("my_cat")) printf("got a category after fini\n");
+	zlog_init("test_get_category.conf");
+	zc = zlog_get_category("my_cat");
+	zlog_info(zc, "after init again");
+
+	zlog_fini();
+	return 0;
+}
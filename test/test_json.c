@@ -0,0 +1,85 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "zlog.h"
+
+static int null_output(zlog_msg_t *msg)
+{
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* formatting only, the records go to a record which does nothing */
+static void bench(zlog_category_t *zc, const char *name, const char *msg, long nloop)
+{
+	long i;
+	double start;
+
+	start = now();
+	for (i = 0; i < nloop; i++) {
+		zlog_info(zc, "%s %ld", msg, i);
+	}
+	printf("%-6s %-6s %8.1f ns/record\n", name,
+		strchr(msg, '"') ? "escape" : "clean",
+		(now() - start) * 1e9 / nloop);
+}
+
+int main(int argc, char** argv)
+{
+	long nloop;
+	zlog_category_t *show;
+	zlog_category_t *text;
+	zlog_category_t *json;
+	static const char clean[] = "user 1234 logged in from 10.0.0.1 after 3 tries, session kept";
+	static const char dirty[] = "user \"bob\"\tsaid: C:\\path\\to\\file\nsecond line \x01";
+
+	if (argc != 2) {
+		printf("test_json nloop\n");
+		return -1;
+	}
+	nloop = atol(argv[1]);
+
+	if (zlog_init("test_json.conf")) {
+		printf("init failed\n");
+		return -2;
+	}
+	zlog_set_record("null", null_output);
+
+	show = zlog_get_category("show");
+	text = zlog_get_category("text");
+	json = zlog_get_category("json");
+	if (!show || !text || !json) {
+		printf("get cat fail\n");
+		zlog_fini();
+		return -3;
+	}
+
+	zlog_info(show, "%s", clean);
+	zlog_warn(show, "%s", dirty);
+	zlog_error(show, "utf-8 goes as it is: \xc3\xa9t\xc3\xa9");
+
+	bench(text, "text", clean, nloop);
+	bench(json, "json", clean, nloop);
+	bench(text, "text", dirty, nloop);
+	bench(json, "json", dirty, nloop);
+
+	zlog_fini();
+	return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "zlog.h"
+
+static int null_output(zlog_msg_t *msg)
+{
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	long i;
+	long nloop = 0;
+	double start;
+	zlog_category_t *show;
+	zlog_category_t *bench;
+
+	if (argc == 2) nloop = atol(argv[1]);
+
+	if (zlog_init("test_kv.conf")) {
+		printf("init failed\n");
+		return -1;
+	}
+	zlog_set_record("null", null_output);
+
+	show = zlog_get_category("show");
+	bench = zlog_get_category("bench");
+	if (!show || !bench) {
+		printf("get cat fail\n");
+		zlog_fini();
+		return -2;
+	}
+
+	zlog_kv(show, ZLOG_LEVEL_INFO, "request done",
+		ZLOG_STR("user", "bob"), ZLOG_INT("latency_us", 1234),
+		ZLOG_INT("delta", -5), ZLOG_UINT("bytes", 18446744073709551615ULL),
+		ZLOG_DOUBLE("ratio", 0.25), ZLOG_BOOL("cached", 1));
+	zlog_kv(show, ZLOG_LEVEL_WARN, "quoted",
+		ZLOG_STR("user", "bob \"the\" builder"), ZLOG_STR("empty", ""),
+		ZLOG_STR("none", NULL));
+	zlog_info(show, "a printf record has no fields");
+
+	if (nloop) {
+		start = now();
+		for (i = 0; i < nloop; i++) {
+			zlog_info(bench, "request done user=%s latency_us=%ld bytes=%lu",
+				"bob", i, (unsigned long)i * 3);
+		}
+		printf("printf %8.1f ns/record\n", (now() - start) * 1e9 / nloop);
+
+		start = now();
+		for (i = 0; i < nloop; i++) {
+			zlog_kv(bench, ZLOG_LEVEL_INFO, "request done", ZLOG_STR("user", "bob"),
+				ZLOG_INT("latency_us", i), ZLOG_UINT("bytes", i * 3));
+		}
+		printf("kv     %8.1f ns/record\n", (now() - start) * 1e9 / nloop);
+	}
+
+	zlog_fini();
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "zlog.h"
+
+static zlog_category_t *zc;
+static long seconds;
+
+void * work(void *ptr)
+{
+	long i = 0;
+	struct timeval start, now;
+
+	gettimeofday(&start, NULL);
+	do {
+		zlog_info(zc, "loglog %ld, a noisy path", i);
+		if (i++ % 10 == 0) {
+			zlog_info(zc, "loglog %ld, a quieter path", i);
+		}
+		gettimeofday(&now, NULL);
+	} while (now.tv_sec - start.tv_sec < seconds);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long thread_count;
+
+	if (argc != 3) {
+		fprintf(stderr, "test_limit nthreads nseconds\n");
+		exit(1);
+	}
+
+	rc = zlog_init("test_limit.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	thread_count = atol(argv[1]);
+	seconds = atol(argv[2]);
+	{
+		pthread_t tid[thread_count];
+		for (i = 0; i < thread_count; i++) {
+			pthread_create(&(tid[i]), NULL, work, NULL);
+		}
+		for (i = 0; i < thread_count; i++) {
+			pthread_join(tid[i], NULL);
+		}
+	}
+
+	zlog_fini();
+
+	printf("grep -c path test_limit.log, about (20 + 100 * nseconds) lines of each path\n");
+	return 0;
+}
@@ -17,6 +17,9 @@
 int main(int argc, char** argv)
 {
 	int rc;
+	int i;
+	char key[32];
+	char *name;
 	zlog_category_t *zc;
 
 	rc = zlog_init("test_mdc.conf");
@@ -43,6 +46,39 @@ int main(int argc, char** argv)
 
 	zlog_info(zc, "3.hello, zlog");
 
+	/* a request puts a few keys and removes them again */
+	zlog_put_mdc("req", "1001");
+	zlog_put_mdc("myname", "Wang");
+	zlog_remove_mdc("req");
+	zlog_info(zc, "4.hello, zlog");
+
+	zlog_remove_mdc("myname");
+	zlog_info(zc, "5.hello, zlog");
+
+	/* mdc of the thread is still there after reload */
+	zlog_put_mdc("myname", "Zhao");
+	zlog_reload("test_mdc.conf");
+	zlog_info(zc, "6.hello, zlog");
+
+	/* a value stays while other keys are put and removed, keys past
+	 * the interned ones are still put
+	 */
+	name = zlog_get_mdc("myname");
+	for (i = 0; i < 1100; i++) {
+		sprintf(key, "key%d", i);
+		if (zlog_put_mdc(key, key)) {
+			printf("put mdc[%s] fail\n", key);
+			zlog_fini();
+			return -3;
+		}
+	}
+	zlog_remove_mdc("key0");
+	zlog_remove_mdc("key1050");
+	zlog_info(zc, "7.hello, zlog, %s", name);
+
+	zlog_put_mdc("myname", zlog_get_mdc("key1099"));
+	zlog_info(zc, "8.hello, zlog, %s", zlog_get_mdc("key1050") ? "key1050" : "removed");
+
 	zlog_fini();
 	
 	return 0;
@@ -0,0 +1,115 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "zlog.h"
+
+static zlog_category_t *zc;
+
+/* a task of the request goes on in a thread of the pool */
+static void *work(void *arg)
+{
+	zlog_mdc_snapshot_t *snap = arg;
+
+	zlog_mdc_restore(snap);
+	zlog_info(zc, "2.task in the pool");
+
+	/* the pool thread changes its copy, not the snapshot */
+	zlog_put_mdc("user", "pool");
+	zlog_info(zc, "3.task in the pool, user put");
+
+	zlog_mdc_restore(NULL);
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	int i;
+	int nloop;
+	double t;
+	pthread_t tid;
+	zlog_mdc_snapshot_t *snap;
+
+	rc = zlog_init("test_mdc_snapshot.conf");
+	if (rc) {
+		printf("init failed\n");
+		return -1;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat fail\n");
+		zlog_fini();
+		return -2;
+	}
+
+	zlog_put_mdc("req", "1001");
+	zlog_put_mdc("user", "zhang");
+	zlog_info(zc, "1.request comes");
+
+	snap = zlog_mdc_snapshot();
+	pthread_create(&tid, NULL, work, snap);
+	pthread_join(tid, NULL);
+	zlog_mdc_release(snap);
+	zlog_info(zc, "4.request goes on, user is the same");
+
+	/* nested contexts */
+	zlog_mdc_push();
+	zlog_put_mdc("req", "1001.1");
+	zlog_info(zc, "5.sub request");
+	zlog_mdc_push();
+	zlog_remove_mdc("user");
+	zlog_info(zc, "6.sub sub request, no user");
+	zlog_mdc_pop();
+	zlog_info(zc, "7.back to sub request");
+	zlog_mdc_pop();
+	zlog_info(zc, "8.back to request");
+	if (zlog_mdc_pop() == 0) printf("pop of nothing should fail\n");
+
+	if (argc == 2) {
+		nloop = atoi(argv[1]);
+
+		/* a task hops to a thread, the way it is without snapshots */
+		t = now();
+		for (i = 0; i < nloop; i++) {
+			zlog_clean_mdc();
+			zlog_put_mdc("req", "1001");
+			zlog_put_mdc("user", "zhang");
+			zlog_put_mdc("trace", "4bf92f3577b34da6");
+			zlog_put_mdc("span", "00f067aa0ba902b7");
+		}
+		printf("put 4 keys: %.0f ns\n", (now() - t) * 1e9 / nloop);
+
+		snap = zlog_mdc_snapshot();
+		t = now();
+		for (i = 0; i < nloop; i++) {
+			zlog_mdc_restore(NULL);
+			zlog_mdc_restore(snap);
+		}
+		printf("restore: %.0f ns\n", (now() - t) * 1e9 / nloop);
+		zlog_mdc_release(snap);
+	}
+
+	zlog_fini();
+
+	return 0;
+}
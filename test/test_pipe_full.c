@@ -0,0 +1,58 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "zlog.h"
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	double start;
+	zlog_category_t *drop_cat;
+	zlog_category_t *spill_cat;
+
+	rc = zlog_init("test_pipe_full.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	drop_cat = zlog_get_category("drop_cat");
+	spill_cat = zlog_get_category("spill_cat");
+	if (!drop_cat || !spill_cat) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	/* the readers sleep 2s first, writers must not wait for them */
+	start = now();
+	for (i = 0; i < 100000; i++) {
+		zlog_info(drop_cat, "drop %ld", i);
+		zlog_info(spill_cat, "spill %ld", i);
+	}
+	printf("200000 records in %.3fs\n", now() - start);
+
+	zlog_fini();
+
+	printf("cat test_pipe_full.log, a line tells how many were dropped\n");
+	printf("cat test_pipe_full.s.log test_pipe_full.spill, all records are in one of them\n");
+	return 0;
+}
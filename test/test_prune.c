@@ -0,0 +1,83 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <glob.h>
+
+#include "zlog.h"
+
+static zlog_category_t *zc;
+static long loop_count;
+
+void * work(void *ptr)
+{
+	long j = loop_count;
+	while(j-- > 0) {
+		zlog_info(zc, "loglog %ld, the oldest archives are removed when all of them are over budget", j);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long thread_count;
+
+	if (argc != 3) {
+		fprintf(stderr, "test_prune nthreads nloop\n");
+		exit(1);
+	}
+
+	rc = zlog_init("test_prune.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	thread_count = atol(argv[1]);
+	loop_count = atol(argv[2]);
+	{
+		pthread_t tid[thread_count];
+		for (i = 0; i < thread_count; i++) {
+			pthread_create(&(tid[i]), NULL, work, NULL);
+		}
+		for (i = 0; i < thread_count; i++) {
+			pthread_join(tid[i], NULL);
+		}
+	}
+
+	/* a few rotations, then nothing, its archives still age out */
+	zc = zlog_get_category("quiet_cat");
+	for (i = 0; i < 100; i++) {
+		zlog_info(zc, "quiet %ld, archives older than 2s are removed without a rotation", i);
+	}
+
+	/* give the background prune a chance before fini */
+	sleep(5);
+	zlog_fini();
+
+	{
+		glob_t g;
+		if (glob("test_prune_quiet.[0-9]*", 0, NULL, &g)) g.gl_pathc = 0;
+		printf("quiet archives left: %ld, only the newest stays\n", (long)g.gl_pathc);
+		if (g.gl_pathc) globfree(&g);
+	}
+	printf("archives: du -cb test_prune.*, total stays under 256KB\n");
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "zlog.h"
+
+#define NTHREAD		4
+#define NLOOP		20000
+#define BATCH		64
+
+static zlog_category_t *zc;
+static long nrecords;
+static long nbatches;
+static long nbad;
+
+/* called by one thread of zlog, nothing to lock here */
+int output(zlog_msg_t *msgs, size_t count)
+{
+	size_t i;
+
+	if (count == 0 || count > BATCH) nbad++;
+	for (i = 0; i < count; i++) {
+		if (strncmp(msgs[i].buf, "loglog ", 7) || strlen(msgs[i].buf) != msgs[i].len
+			|| !msgs[i].path || strcmp(msgs[i].path, " mypath my_cat")) {
+			nbad++;
+		}
+	}
+	nrecords += count;
+	nbatches++;
+	return 0;
+}
+
+void * work(void *ptr)
+{
+	long j;
+
+	for (j = 0; j < NLOOP; j++) {
+		zlog_info(zc, "loglog %ld", j);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int i;
+	pid_t pid;
+	pthread_t tid[NTHREAD];
+
+	if (zlog_init("test_record_batch.conf")) {
+		printf("init failed\n");
+		return -1;
+	}
+
+	if (zlog_set_record_batch("mybatch", output, BATCH, 50)) {
+		printf("set record batch fail\n");
+		zlog_fini();
+		return -2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat fail\n");
+		zlog_fini();
+		return -3;
+	}
+
+	for (i = 0; i < NTHREAD; i++) {
+		pthread_create(&tid[i], NULL, work, NULL);
+	}
+	for (i = 0; i < NTHREAD; i++) {
+		pthread_join(tid[i], NULL);
+	}
+
+	/* less than a batch goes after the latency */
+	zlog_info(zc, "loglog last");
+	usleep(300 * 1000);
+	printf("records[%ld], expect[%d], batches[%ld], bad[%ld]\n",
+		nrecords, NTHREAD * NLOOP + 1, nbatches, nbad);
+
+	/* a child gives its records by a thread of its own */
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0) {
+		nrecords = nbatches = nbad = 0;
+		work(NULL);
+		zlog_fini();
+		printf("child records[%ld], expect[%d], bad[%ld]\n", nrecords, NLOOP, nbad);
+		return 0;
+	}
+	waitpid(pid, NULL, 0);
+
+	zlog_fini();
+	return 0;
+}
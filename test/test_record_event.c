@@ -0,0 +1,60 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "zlog.h"
+
+/* fields as they are, no parsing of msg->buf */
+int output(zlog_msg_t *msg, const zlog_record_event_t *ev)
+{
+	if (!ev) {
+		printf("[kept]:[%s]\n", msg->buf);
+		return 0;
+	}
+	printf("[%s][%d:%s][%s:%ld %s][pid %s][usr_msg %s][%ld]\n",
+		ev->category, ev->level, ev->level_name,
+		strrchr(ev->file, '/') ? strrchr(ev->file, '/') + 1 : ev->file,
+		ev->line, ev->func,
+		ev->pid == getpid() ? "ok" : "bad",
+		ev->usr_msg, (long)ev->usr_msg_len);
+	if (strstr(msg->buf, ev->usr_msg) == NULL) printf("usr_msg not in msg\n");
+	if (ev->time_sec == 0) printf("no time\n");
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	zlog_category_t *zc;
+
+	if (zlog_init("test_record_event.conf")) {
+		printf("init failed\n");
+		return -1;
+	}
+
+	if (zlog_set_record_event("myevent", output)) {
+		printf("set record event fail\n");
+		zlog_fini();
+		return -2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat fail\n");
+		zlog_fini();
+		return -3;
+	}
+
+	zlog_info(zc, "hello, zlog %d", 1);
+	zlog_error(zc, "%s", "an error");
+	hzlog_debug(zc, "0123456789", 10);
+	zlog_fini();
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "zlog.h"
+
+#define NPROCESS	4
+#define NTHREAD		4
+#define NLOOP		50000
+
+static zlog_category_t *zc;
+
+void * work(void *ptr)
+{
+	long j;
+
+	for (j = 0; j < NLOOP; j++) {
+		zlog_info(zc, "pid %d loglog %ld", getpid(), j);
+	}
+	return 0;
+}
+
+/* forked writers, as test_press_zlog, all in one ring */
+static void writer(void)
+{
+	long j;
+	pthread_t tid[NTHREAD];
+
+	for (j = 0; j < NTHREAD; j++) {
+		pthread_create(&(tid[j]), NULL, work, NULL);
+	}
+	for (j = 0; j < NTHREAD; j++) {
+		pthread_join(tid[j], NULL);
+	}
+	exit(0);
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long nread = 0;
+	long nbad = 0;
+	int nalive = NPROCESS;
+	const char *rec;
+	size_t len;
+	zlog_shm_reader_t *reader;
+
+	unlink("test_shm.ring");
+	rc = zlog_init("test_shm.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	for (i = 0; i < NPROCESS; i++) {
+		if (fork() == 0) writer();
+	}
+
+	/* the shipper, here in the parent, any process may open the ring */
+	reader = zlog_shm_open("test_shm.ring");
+	if (!reader) {
+		printf("open ring failed\n");
+		return 4;
+	}
+	for (;;) {
+		while ((rc = zlog_shm_next(reader, &rec, &len)) == 1) {
+			if (len < 2 || rec[len - 1] != '\n' || !memmem(rec, len, " loglog ", 8)) nbad++;
+			nread++;
+		}
+		if (rc < 0) break;
+		zlog_shm_done(reader);
+		if (!nalive) break;
+		if (waitpid(-1, NULL, WNOHANG) > 0) {
+			nalive--;
+			continue;
+		}
+		usleep(1000);
+	}
+
+	printf("%ld records read, %lu dropped, %ld bad, %d written\n",
+		nread, zlog_shm_dropped(reader), nbad, NPROCESS * NTHREAD * NLOOP);
+
+	/* the ring is in use, it is not made over to another size */
+	rc = zlog_reload("test_shm_resize.conf");
+	printf("reload to another size %s\n", rc ? "refused" : "done, wrong");
+	zlog_shm_close(reader);
+	zlog_fini();
+	return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "zlog.h"
+
+#define UNIX_PATH	"test_socket.sock"
+#define DGRAM_PATH	"test_socket.dgram"
+#define PORT		15140
+
+#define UNIX_PEER	0	/* stream, each record after its length */
+#define TCP_PEER	1	/* stream, records end by \n */
+#define UDP_PEER	2
+#define DGRAM_PEER	3
+
+#define MAX_FDS		16
+
+typedef struct peer_s {
+	int kind;
+	int listening;
+	char buf[64 * 1024];
+	size_t len;
+} peer_t;
+
+static struct pollfd fds[MAX_FDS];
+static peer_t peers[MAX_FDS];
+static int nfds;
+static int nrecv[4];
+
+static volatile int stop;
+static volatile int unix_down;		/* 1 asks to close, 2 is closed */
+
+/* a collector stand-in, listens on all four and counts records */
+static void add_fd(int fd, int kind, int listening)
+{
+	fds[nfds].fd = fd;
+	fds[nfds].events = POLLIN;
+	peers[nfds].kind = kind;
+	peers[nfds].listening = listening;
+	peers[nfds].len = 0;
+	nfds++;
+}
+
+static void del_fd(int i)
+{
+	close(fds[i].fd);
+	nfds--;
+	fds[i] = fds[nfds];
+	peers[i] = peers[nfds];
+}
+
+static int bind_unix(const char *path, int type)
+{
+	int fd;
+	struct sockaddr_un addr;
+
+	unlink(path);
+	fd = socket(AF_UNIX, type, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr))
+		|| (type == SOCK_STREAM && listen(fd, 8))) {
+		perror("bind");
+		exit(1);
+	}
+	return fd;
+}
+
+static int bind_inet(int type)
+{
+	int fd;
+	int on = 1;
+	struct sockaddr_in addr;
+
+	fd = socket(AF_INET, type, 0);
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr))
+		|| (type == SOCK_STREAM && listen(fd, 8))) {
+		perror("bind");
+		exit(1);
+	}
+	return fd;
+}
+
+/* count whole records at the head of the buffer */
+static void parse(peer_t * a_peer)
+{
+	char *p = a_peer->buf;
+	char *end = a_peer->buf + a_peer->len;
+	char *q;
+	uint32_t n;
+
+	for (;;) {
+		if (a_peer->kind == UNIX_PEER) {
+			if (end - p < 4) break;
+			memcpy(&n, p, 4);
+			n = ntohl(n);
+			if (end - p < 4 + (long)n) break;
+			if (p[4 + n - 1] != '\n') printf("bad frame\n");
+			p += 4 + n;
+		} else {
+			q = memchr(p, '\n', end - p);
+			if (!q) break;
+			p = q + 1;
+		}
+		nrecv[a_peer->kind]++;
+	}
+	a_peer->len = end - p;
+	memmove(a_peer->buf, p, a_peer->len);
+}
+
+static void unix_close(void)
+{
+	int i;
+
+	for (i = nfds - 1; i >= 0; i--) {
+		if (peers[i].kind == UNIX_PEER) del_fd(i);
+	}
+}
+
+void * collector_run(void *arg)
+{
+	int i;
+	ssize_t n;
+
+	while (!stop) {
+		if (unix_down == 1) {
+			unix_close();
+			unix_down = 2;
+		}
+		if (poll(fds, nfds, 100) <= 0) continue;
+
+		for (i = nfds - 1; i >= 0; i--) {
+			if (!fds[i].revents) continue;
+			if (peers[i].listening) {
+				add_fd(accept(fds[i].fd, NULL, NULL), peers[i].kind, 0);
+				continue;
+			}
+			n = recv(fds[i].fd, peers[i].buf + peers[i].len,
+				sizeof(peers[i].buf) - peers[i].len, 0);
+			if (n <= 0) {
+				del_fd(i);
+				continue;
+			}
+			if (peers[i].kind == UDP_PEER || peers[i].kind == DGRAM_PEER) {
+				nrecv[peers[i].kind]++;
+				continue;
+			}
+			peers[i].len += n;
+			parse(&peers[i]);
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	pthread_t tid;
+	zlog_category_t *unix_cat;
+	zlog_category_t *tcp_cat;
+	zlog_category_t *udp_cat;
+	zlog_category_t *dgram_cat;
+
+	add_fd(bind_unix(UNIX_PATH, SOCK_STREAM), UNIX_PEER, 1);
+	add_fd(bind_inet(SOCK_STREAM), TCP_PEER, 1);
+	add_fd(bind_inet(SOCK_DGRAM), UDP_PEER, 0);
+	add_fd(bind_unix(DGRAM_PATH, SOCK_DGRAM), DGRAM_PEER, 0);
+	pthread_create(&tid, NULL, collector_run, NULL);
+
+	rc = zlog_init("test_socket.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	unix_cat = zlog_get_category("unix_cat");
+	tcp_cat = zlog_get_category("tcp_cat");
+	udp_cat = zlog_get_category("udp_cat");
+	dgram_cat = zlog_get_category("dgram_cat");
+	if (!unix_cat || !tcp_cat || !udp_cat || !dgram_cat) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	for (i = 0; i < 1000; i++) {
+		zlog_info(unix_cat, "unix %ld", i);
+		zlog_info(tcp_cat, "tcp %ld", i);
+		zlog_info(udp_cat, "udp %ld", i);
+		zlog_info(dgram_cat, "dgram %ld", i);
+		if (i % 100 == 0) usleep(1000);
+	}
+
+	/* the collector of unix_cat goes away, records wait in the backlog */
+	usleep(200 * 1000);
+	unix_down = 1;
+	while (unix_down != 2) usleep(1000);
+	for (i = 1000; i < 2000; i++) {
+		zlog_info(unix_cat, "unix %ld", i);
+	}
+	sleep(1);
+
+	/* and is back, the sender connects again */
+	stop = 1;
+	pthread_join(tid, NULL);
+	stop = 0;
+	add_fd(bind_unix(UNIX_PATH, SOCK_STREAM), UNIX_PEER, 1);
+	pthread_create(&tid, NULL, collector_run, NULL);
+
+	zlog_fini();
+
+	usleep(200 * 1000);
+	stop = 1;
+	pthread_join(tid, NULL);
+	unlink(UNIX_PATH);
+	unlink(DGRAM_PATH);
+
+	printf("unix[%d] tcp[%d] udp[%d] unixgram[%d] received, "
+		"2000 1000 1000 1000 expected\n",
+		nrecv[UNIX_PEER], nrecv[TCP_PEER], nrecv[UDP_PEER], nrecv[DGRAM_PEER]);
+	return 0;
+}
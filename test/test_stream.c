@@ -0,0 +1,71 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "zlog.h"
+
+static zlog_category_t *zc;
+static long loop_count;
+
+void * work(void *ptr)
+{
+	long j = loop_count;
+	while(j-- > 0) {
+		zlog_info(zc, "loglog %ld, written in compressed blocks", j);
+		if (j % 10000 == 0) {
+			zlog_error(zc, "error %ld, written at once with the block before it", j);
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	long thread_count;
+
+	if (argc != 3) {
+		fprintf(stderr, "test_stream nthreads nloop\n");
+		exit(1);
+	}
+
+	rc = zlog_init("test_stream.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	thread_count = atol(argv[1]);
+	loop_count = atol(argv[2]);
+	{
+		pthread_t tid[thread_count];
+		for (i = 0; i < thread_count; i++) {
+			pthread_create(&(tid[i]), NULL, work, NULL);
+		}
+		for (i = 0; i < thread_count; i++) {
+			pthread_join(tid[i], NULL);
+		}
+	}
+
+	zlog_fini();
+
+	printf("read by: ../src/zlog-cat test_stream.log\n");
+	return 0;
+}
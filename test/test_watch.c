@@ -0,0 +1,43 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "zlog.h"
+
+int main(int argc, char** argv)
+{
+	int rc;
+	zlog_category_t *zc;
+
+	rc = zlog_init("test_watch.conf");
+	if (rc) {
+		printf("init failed\n");
+		return -1;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat fail\n");
+		zlog_fini();
+		return -2;
+	}
+
+	zlog_info(zc, "before move, in test_watch.log.1");
+
+	/* as logrotate does, the watcher thread sees it at once */
+	rename("test_watch.log", "test_watch.log.1");
+	usleep(100000);
+
+	zlog_info(zc, "after move, in a new test_watch.log");
+
+	zlog_fini();
+
+	printf("cat test_watch.log.1 test_watch.log, one line in each\n");
+	return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * This file is part of the zlog Library.
+ *
+ * Copyright (C) 2018 by mikewy0527
+ *
+ * Licensed under the LGPL v2.1, see the file COPYING in base directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "zlog.h"
+
+#define NPROCESS	4
+#define NTHREAD		4
+#define NLOOP		10000
+
+static zlog_category_t *zc;
+
+void * work(void *ptr)
+{
+	long j;
+
+	for (j = 0; j < NLOOP; j++) {
+		zlog_info(zc, "loglog %ld", j);
+	}
+	return 0;
+}
+
+/* forked writers, as test_press_zlog, zlogd alone writes and rotates */
+static void writer(void)
+{
+	long j;
+	pthread_t tid[NTHREAD];
+
+	for (j = 0; j < NTHREAD; j++) {
+		pthread_create(&(tid[j]), NULL, work, NULL);
+	}
+	for (j = 0; j < NTHREAD; j++) {
+		pthread_join(tid[j], NULL);
+	}
+	zlog_fini();
+	exit(0);
+}
+
+int main(int argc, char** argv)
+{
+	int rc;
+	long i;
+	pid_t daemon_pid;
+
+	system("rm -f test_zlogd.log*");
+	daemon_pid = fork();
+	if (daemon_pid == 0) {
+		execl("../src/zlogd", "zlogd", "-c", "test_zlogd.d.conf", "-s", "test_zlogd.sock", NULL);
+		perror("exec zlogd");
+		exit(1);
+	}
+
+	rc = zlog_init("test_zlogd.conf");
+	if (rc) {
+		printf("init failed\n");
+		return 2;
+	}
+
+	zc = zlog_get_category("my_cat");
+	if (!zc) {
+		printf("get cat failed\n");
+		zlog_fini();
+		return 3;
+	}
+
+	for (i = 0; i < NPROCESS; i++) {
+		if (fork() == 0) writer();
+	}
+	for (i = 0; i < NPROCESS; i++) {
+		wait(NULL);
+	}
+	zlog_fini();
+
+	usleep(200 * 1000);
+	kill(daemon_pid, SIGTERM);
+	waitpid(daemon_pid, NULL, 0);
+
+	printf("cat test_zlogd.log*, %d lines expected\n", NPROCESS * NTHREAD * NLOOP);
+	return 0;
+}